@@ -17,6 +17,7 @@
 
 struct LoggerConfig {
   int loglevel{2};
+  bool async{false};
   void updateFromPropertyTree(const boost::property_tree::ptree& pt);
   void writeToStream(std::ostream& out_stream) const;
 };
@@ -72,6 +73,9 @@ struct UptaneConfig {
   bool force_install_completion{false};
   boost::filesystem::path secondary_config_file;
   uint64_t secondary_preinstall_wait_sec{600U};
+  uint64_t max_parallel_downloads{4U};
+  uint64_t max_parallel_verifications{1U};
+  uint64_t max_parallel_secondaries{8U};
 
   void updateFromPropertyTree(const boost::property_tree::ptree& pt);
   void writeToStream(std::ostream& out_stream) const;
@@ -96,6 +100,7 @@ struct PackageConfig {
   std::string ostree_server;
   boost::filesystem::path images_path{"/var/sota/images"};
   boost::filesystem::path packages_file{"/usr/package.manifest"};
+  uint64_t download_segments{1U};
 
   // Options for simulation
   bool fake_need_reboot{false};
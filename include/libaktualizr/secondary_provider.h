@@ -20,6 +20,8 @@ class SecondaryProvider {
   bool getImageRepoMetadata(Uptane::MetaBundle* meta_bundle, const Uptane::Target& target) const;
   std::string getTreehubCredentials() const;
   std::ifstream getTargetFileHandle(const Uptane::Target& target) const;
+  // Path of the downloaded target image, or an empty string if there is none
+  std::string getTargetFilePath(const Uptane::Target& target) const;
 
  private:
   SecondaryProvider(Config& config_in, std::shared_ptr<const INvStorage> storage_in,
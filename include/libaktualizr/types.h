@@ -3,6 +3,7 @@
 /** \file */
 
 #include <algorithm>
+#include <memory>
 #include <stdexcept>
 #include <unordered_map>
 
@@ -156,8 +157,13 @@ class PublicKey {
   // std::string can be implicitly converted to a Json::Value. Make sure that
   // the Json::Value constructor is not called accidentally.
   PublicKey(std::string);  // NOLINT(google-explicit-constructor, hicpp-explicit-conversions)
+  struct Parsed;
+  void parse();
   std::string value_;
   KeyType type_{KeyType::kUnknown};
+  // Key in the form the verification routines use. Set by the constructors
+  // and never modified afterwards, so copies can share it.
+  std::shared_ptr<const Parsed> parsed_;
 };
 
 /**
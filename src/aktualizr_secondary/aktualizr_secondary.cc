@@ -1,6 +1,7 @@
 #include "aktualizr_secondary.h"
 
 #include <sys/types.h>
+#include <algorithm>
 #include <memory>
 
 #include <boost/lexical_cast.hpp>
@@ -241,17 +242,22 @@ void AktualizrSecondary::uptaneInitialize() {
 }
 
 void AktualizrSecondary::registerHandlers() {
+  // Queries are answered even while an update is being received or installed
   registerHandler(AKIpUptaneMes_PR_getInfoReq,
-                  std::bind(&AktualizrSecondary::getInfoHdlr, this, std::placeholders::_1, std::placeholders::_2));
+                  std::bind(&AktualizrSecondary::getInfoHdlr, this, std::placeholders::_1, std::placeholders::_2),
+                  Access::kQuery);
 
   registerHandler(AKIpUptaneMes_PR_versionReq,
-                  std::bind(&AktualizrSecondary::versionHdlr, std::placeholders::_1, std::placeholders::_2));
+                  std::bind(&AktualizrSecondary::versionHdlr, std::placeholders::_1, std::placeholders::_2),
+                  Access::kQuery);
 
   registerHandler(AKIpUptaneMes_PR_manifestReq,
-                  std::bind(&AktualizrSecondary::getManifestHdlr, this, std::placeholders::_1, std::placeholders::_2));
+                  std::bind(&AktualizrSecondary::getManifestHdlr, this, std::placeholders::_1, std::placeholders::_2),
+                  Access::kQuery);
 
   registerHandler(AKIpUptaneMes_PR_rootVerReq,
-                  std::bind(&AktualizrSecondary::getRootVerHdlr, this, std::placeholders::_1, std::placeholders::_2));
+                  std::bind(&AktualizrSecondary::getRootVerHdlr, this, std::placeholders::_1, std::placeholders::_2),
+                  Access::kQuery);
 
   registerHandler(AKIpUptaneMes_PR_putRootReq,
                   std::bind(&AktualizrSecondary::putRootHdlr, this, std::placeholders::_1, std::placeholders::_2));
@@ -260,7 +266,8 @@ void AktualizrSecondary::registerHandlers() {
                   std::bind(&AktualizrSecondary::putMetaHdlr, this, std::placeholders::_1, std::placeholders::_2));
 
   registerHandler(AKIpUptaneMes_PR_installReq,
-                  std::bind(&AktualizrSecondary::installHdlr, this, std::placeholders::_1, std::placeholders::_2));
+                  std::bind(&AktualizrSecondary::installHdlr, this, std::placeholders::_1, std::placeholders::_2),
+                  Access::kUpdate);
 }
 
 MsgHandler::ReturnCode AktualizrSecondary::getInfoHdlr(Asn1Message& in_msg, Asn1Message& out_msg) const {
@@ -279,19 +286,21 @@ MsgHandler::ReturnCode AktualizrSecondary::getInfoHdlr(Asn1Message& in_msg, Asn1
 }
 
 MsgHandler::ReturnCode AktualizrSecondary::versionHdlr(Asn1Message& in_msg, Asn1Message& out_msg) {
-  const uint32_t version = 2;
+  const uint32_t version = 5;
   auto version_req = in_msg.versionReq();
   const auto primary_version = static_cast<uint32_t>(version_req->version);
   if (primary_version < version) {
-    LOG_ERROR << "Primary protocol version is " << primary_version << " but Secondary version is " << version
-              << "! Communication will most likely fail!";
+    LOG_INFO << "Primary protocol version is " << primary_version << " but Secondary version is " << version
+             << ". Using version " << primary_version << ".";
   } else if (primary_version > version) {
     LOG_INFO << "Primary protocol version is " << primary_version << " but Secondary version is " << version
              << ". Please consider upgrading the Secondary.";
   }
 
+  // Newer Secondaries still implement the older protocol versions: agree on
+  // the latest one both sides support.
   auto m = out_msg.present(AKIpUptaneMes_PR_versionResp).versionResp();
-  m->version = version;
+  m->version = std::min(version, primary_version);
 
   return ReturnCode::kOk;
 }
@@ -408,6 +417,21 @@ void AktualizrSecondary::copyMetadata(Uptane::MetaBundle& meta_bundle, const Upt
   meta_bundle.emplace(key, std::move(json));
 }
 
+void AktualizrSecondary::copyStoredMetadata(Uptane::MetaBundle& meta_bundle, const Uptane::RepositoryType repo,
+                                            const Uptane::Role& role) const {
+  auto key = std::make_pair(repo, role);
+  if (meta_bundle.count(key) > 0) {
+    return;
+  }
+  std::string json;
+  const bool loaded = role == Uptane::Role::Root() ? storage_->loadLatestRoot(&json, repo)
+                                                   : storage_->loadNonRoot(&json, repo, role);
+  if (loaded) {
+    LOG_DEBUG << "Using the stored " << repo << " " << role << " metadata";
+    meta_bundle.emplace(key, std::move(json));
+  }
+}
+
 AktualizrSecondary::ReturnCode AktualizrSecondary::putMetaHdlr(Asn1Message& in_msg, Asn1Message& out_msg) {
   LOG_INFO << "Received a put metadata request message; verifying contents...";
   auto md = in_msg.putMetaReq2();
@@ -456,6 +480,17 @@ AktualizrSecondary::ReturnCode AktualizrSecondary::putMetaHdlr(Asn1Message& in_m
     }
   }
 
+  // Since protocol v5 the Primary leaves out what it sent in the previous
+  // request, so use the copies that were verified and stored back then.
+  if (config_.uptane.verification_type == VerificationType::kFull) {
+    copyStoredMetadata(meta_bundle, Uptane::RepositoryType::Director(), Uptane::Role::Root());
+    copyStoredMetadata(meta_bundle, Uptane::RepositoryType::Director(), Uptane::Role::Targets());
+  }
+  copyStoredMetadata(meta_bundle, Uptane::RepositoryType::Image(), Uptane::Role::Root());
+  copyStoredMetadata(meta_bundle, Uptane::RepositoryType::Image(), Uptane::Role::Timestamp());
+  copyStoredMetadata(meta_bundle, Uptane::RepositoryType::Image(), Uptane::Role::Snapshot());
+  copyStoredMetadata(meta_bundle, Uptane::RepositoryType::Image(), Uptane::Role::Targets());
+
   size_t expected_items;
   if (config_.uptane.verification_type == VerificationType::kTuf) {
     expected_items = 4;
@@ -50,6 +50,7 @@ class AktualizrSecondary : public MsgDispatcher {
  private:
   static void copyMetadata(Uptane::MetaBundle& meta_bundle, Uptane::RepositoryType repo, const Uptane::Role& role,
                            std::string& json);
+  void copyStoredMetadata(Uptane::MetaBundle& meta_bundle, Uptane::RepositoryType repo, const Uptane::Role& role) const;
   data::InstallationResult verifyMetadata(const Uptane::SecondaryMetadata& metadata);
   data::InstallationResult findTargets();
   void uptaneInitialize();
@@ -1,5 +1,7 @@
 #include "aktualizr_secondary_file.h"
 
+#include <array>
+
 #include "storage/invstorage.h"
 #include "update_agent_file.h"
 
@@ -12,8 +14,18 @@ AktualizrSecondaryFile::AktualizrSecondaryFile(const AktualizrSecondaryConfig& c
                                                std::shared_ptr<INvStorage> storage,
                                                std::shared_ptr<FileUpdateAgent> update_agent)
     : AktualizrSecondary(config, std::move(storage)), update_agent_{std::move(update_agent)} {
-  registerHandler(AKIpUptaneMes_PR_uploadDataReq, std::bind(&AktualizrSecondaryFile::uploadDataHdlr, this,
-                                                            std::placeholders::_1, std::placeholders::_2));
+  registerHandler(AKIpUptaneMes_PR_uploadDataReq,
+                  std::bind(&AktualizrSecondaryFile::uploadDataHdlr, this, std::placeholders::_1,
+                            std::placeholders::_2),
+                  Access::kUpdate);
+  registerHandler(AKIpUptaneMes_PR_uploadDataReq2,
+                  std::bind(&AktualizrSecondaryFile::uploadData2Hdlr, this, std::placeholders::_1,
+                            std::placeholders::_2),
+                  Access::kUpdate);
+  registerRawHandler(AKIpUptaneMes_PR_uploadRawReq,
+                     std::bind(&AktualizrSecondaryFile::uploadRawHdlr, this, std::placeholders::_1,
+                               std::placeholders::_2, std::placeholders::_3),
+                     Access::kUpdate);
   if (!update_agent_) {
     std::string current_target_name;
 
@@ -83,3 +95,78 @@ MsgHandler::ReturnCode AktualizrSecondaryFile::uploadDataHdlr(Asn1Message& in_ms
 
   return ReturnCode::kOk;
 }
+
+MsgHandler::ReturnCode AktualizrSecondaryFile::uploadData2Hdlr(Asn1Message& in_msg, Asn1Message& out_msg) {
+  auto req = in_msg.uploadDataReq2();
+  auto result = data::InstallationResult(data::ResultCode::Numeric::kOk, "");
+
+  // A request without data only asks how much has been received so far
+  if (req->data.size < 0 || req->data.size > MaxUploadChunkSize || req->offset < 0) {
+    LOG_ERROR << "Invalid data upload request: offset " << req->offset << ", size " << req->data.size;
+    result = data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed, "Invalid data upload request");
+  } else if (req->data.size > 0) {
+    if (req->offset == 0) {
+      LOG_INFO << "Received an initial data upload request message; attempting to receive data...";
+      update_agent_->resetReceivedData();
+    }
+    const uint64_t received = update_agent_->receivedDataSize();
+    if (static_cast<uint64_t>(req->offset) != received) {
+      LOG_ERROR << "Unexpected data upload offset: " << req->offset << " != " << received;
+      result = data::InstallationResult(
+          data::ResultCode::Numeric::kDownloadFailed,
+          "Unexpected data upload offset: " + std::to_string(req->offset) + " != " + std::to_string(received));
+    } else {
+      result = receiveData(req->data.buf, static_cast<size_t>(req->data.size));
+    }
+  }
+
+  auto m = out_msg.present(AKIpUptaneMes_PR_uploadDataResp2).uploadDataResp2();
+  m->result = static_cast<AKInstallationResultCode_t>(result.result_code.num_code);
+  SetString(&m->description, result.description);
+  m->received = static_cast<long>(update_agent_->receivedDataSize());
+  m->maxChunkSize = MaxUploadChunkSize;
+
+  return ReturnCode::kOk;
+}
+
+MsgHandler::ReturnCode AktualizrSecondaryFile::uploadRawHdlr(Asn1Message& in_msg, Asn1Message& out_msg,
+                                                             const PayloadReader& payload) {
+  auto req = in_msg.uploadRawReq();
+  auto result = data::InstallationResult(data::ResultCode::Numeric::kOk, "");
+
+  if (req->offset < 0 || req->length < 0) {
+    LOG_ERROR << "Invalid raw data upload request: offset " << req->offset << ", length " << req->length;
+    result = data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed, "Invalid data upload request");
+  } else if (req->length > 0) {
+    if (req->offset == 0) {
+      LOG_INFO << "Received an initial raw data upload request message; attempting to receive data...";
+      update_agent_->resetReceivedData();
+    }
+    const uint64_t received = update_agent_->receivedDataSize();
+    if (static_cast<uint64_t>(req->offset) != received) {
+      LOG_ERROR << "Unexpected data upload offset: " << req->offset << " != " << received;
+      result = data::InstallationResult(
+          data::ResultCode::Numeric::kDownloadFailed,
+          "Unexpected data upload offset: " + std::to_string(req->offset) + " != " + std::to_string(received));
+    } else {
+      // The data still has to pass through the hasher, so it can't be
+      // spliced into the file; read it in pieces straight off the socket.
+      std::array<uint8_t, 64 * 1024> buf{};
+      ssize_t read_bytes = 0;
+      while (result.isSuccess() && (read_bytes = payload(buf.data(), buf.size())) > 0) {
+        result = receiveData(buf.data(), static_cast<size_t>(read_bytes));
+      }
+      if (result.isSuccess() && read_bytes < 0) {
+        result = data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed, "Failed to read data upload");
+      }
+    }
+  }
+
+  auto m = out_msg.present(AKIpUptaneMes_PR_uploadDataResp2).uploadDataResp2();
+  m->result = static_cast<AKInstallationResultCode_t>(result.result_code.num_code);
+  SetString(&m->description, result.description);
+  m->received = static_cast<long>(update_agent_->receivedDataSize());
+  m->maxChunkSize = MaxUploadChunkSize;
+
+  return ReturnCode::kOk;
+}
@@ -10,6 +10,8 @@ class FileUpdateAgent;
 class AktualizrSecondaryFile : public AktualizrSecondary {
  public:
   static const std::string FileUpdateDefaultFile;
+  // Largest chunk of image data accepted in a streaming (v3) upload request
+  static constexpr long MaxUploadChunkSize{1024 * 1024};
 
   explicit AktualizrSecondaryFile(const AktualizrSecondaryConfig& config);
   AktualizrSecondaryFile(const AktualizrSecondaryConfig& config, std::shared_ptr<INvStorage> storage,
@@ -26,6 +28,8 @@ class AktualizrSecondaryFile : public AktualizrSecondary {
   void completeInstall() override;
 
   ReturnCode uploadDataHdlr(Asn1Message& in_msg, Asn1Message& out_msg);
+  ReturnCode uploadData2Hdlr(Asn1Message& in_msg, Asn1Message& out_msg);
+  ReturnCode uploadRawHdlr(Asn1Message& in_msg, Asn1Message& out_msg, const PayloadReader& payload);
 
  private:
   std::shared_ptr<FileUpdateAgent> update_agent_;
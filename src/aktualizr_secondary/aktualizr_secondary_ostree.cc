@@ -8,8 +8,14 @@ AktualizrSecondaryOstree::AktualizrSecondaryOstree(const AktualizrSecondaryConfi
 AktualizrSecondaryOstree::AktualizrSecondaryOstree(const AktualizrSecondaryConfig& config,
                                                    const std::shared_ptr<INvStorage>& storage)
     : AktualizrSecondary(config, storage) {
-  registerHandler(AKIpUptaneMes_PR_downloadOstreeRevReq, std::bind(&AktualizrSecondaryOstree::downloadOstreeRev, this,
-                                                                   std::placeholders::_1, std::placeholders::_2));
+  registerHandler(AKIpUptaneMes_PR_downloadOstreeRevReq,
+                  std::bind(&AktualizrSecondaryOstree::downloadOstreeRev, this, std::placeholders::_1,
+                            std::placeholders::_2),
+                  Access::kUpdate);
+  // The manifest is built from the deployments in the sysroot, which an
+  // installation rewrites, and OstreeManager does not guard against reading
+  // them while another thread deploys. So no manifest during an update.
+  setHandlerAccess(AKIpUptaneMes_PR_manifestReq, Access::kExclusive);
 
   std::shared_ptr<OstreeManager> pack_man =
       std::make_shared<OstreeManager>(config.pacman, config.bootloader, AktualizrSecondary::storage(), nullptr);
@@ -1,6 +1,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <sys/resource.h>
+
+#include <csignal>
+
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/string_file.hpp>
 #include <boost/optional/optional_io.hpp>
@@ -523,6 +527,143 @@ INSTANTIATE_TEST_SUITE_P(SecondaryTestTufVersions, SecondaryTestTuf,
                                            std::make_pair(std::vector<std::string>{"invalid1", "invalid2"},
                                                           boost::none)));
 
+/* Limits the size of the files written by the process, as if the disk filled
+ * up. Writes past the limit fail with EFBIG instead of raising SIGXFSZ. */
+class FileSizeLimit {
+ public:
+  explicit FileSizeLimit(rlim_t size) : old_handler_{signal(SIGXFSZ, SIG_IGN)} {
+    getrlimit(RLIMIT_FSIZE, &old_limit_);
+    rlimit limit = old_limit_;
+    limit.rlim_cur = size;
+    setrlimit(RLIMIT_FSIZE, &limit);
+  }
+  ~FileSizeLimit() {
+    setrlimit(RLIMIT_FSIZE, &old_limit_);
+    signal(SIGXFSZ, old_handler_);
+  }
+  FileSizeLimit(const FileSizeLimit&) = delete;
+  FileSizeLimit& operator=(const FileSizeLimit&) = delete;
+
+ private:
+  sighandler_t old_handler_;
+  rlimit old_limit_{};
+};
+
+/* The file update agent on its own, receiving an image in chunks the way the
+ * upload handlers pass it on. */
+class FileUpdateAgentTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  FileUpdateAgentTest() {
+    image_.resize(3 * kChunkSize);
+    for (auto& c : image_) {
+      c = static_cast<char>(rand());
+    }
+    target_ = Uptane::Target("firmware.bin", Uptane::EcuMap{}, {Hash::generate(Hash::Type::kSha256, image_)},
+                             image_.size());
+  }
+
+  std::unique_ptr<FileUpdateAgent> createAgent() const { return std_::make_unique<FileUpdateAgent>(target_path_, ""); }
+
+  data::InstallationResult send(FileUpdateAgent& agent, size_t from, size_t to) const {
+    return agent.receiveData(target_, reinterpret_cast<const uint8_t*>(image_.data()) + from, to - from);
+  }
+
+  TemporaryDirectory temp_dir_;
+  const boost::filesystem::path target_path_{temp_dir_ / "firmware.txt"};
+  const boost::filesystem::path new_target_path_{target_path_.string() + ".newtarget"};
+  std::string image_;
+  Uptane::Target target_{Uptane::Target::Unknown()};
+};
+
+/* After a write that only partly made it to the disk, the upload resumes from
+ * what receivedDataSize() reports. */
+TEST_F(FileUpdateAgentTest, ResumeAfterShortWrite) {
+  auto agent = createAgent();
+  ASSERT_TRUE(send(*agent, 0, kChunkSize).isSuccess());
+  {
+    FileSizeLimit limit(kChunkSize + 1000);
+    EXPECT_EQ(send(*agent, kChunkSize, 2 * kChunkSize).result_code.num_code,
+              data::ResultCode::Numeric::kDownloadFailed);
+  }
+
+  const uint64_t received = agent->receivedDataSize();
+  EXPECT_GE(received, kChunkSize);
+  EXPECT_LT(received, 2 * kChunkSize);
+  ASSERT_TRUE(send(*agent, received, image_.size()).isSuccess());
+  EXPECT_TRUE(agent->install(target_).isSuccess());
+  EXPECT_EQ(Utils::readFile(target_path_), image_);
+}
+
+/* resetReceivedData() drops what a failed upload left behind, so that the
+ * image can be sent again from the start. */
+TEST_F(FileUpdateAgentTest, StartOverAfterShortWrite) {
+  auto agent = createAgent();
+  {
+    FileSizeLimit limit(kChunkSize + 1000);
+    EXPECT_FALSE(send(*agent, 0, 2 * kChunkSize).isSuccess());
+  }
+  EXPECT_GT(agent->receivedDataSize(), 0);
+
+  agent->resetReceivedData();
+  EXPECT_EQ(agent->receivedDataSize(), 0);
+  EXPECT_FALSE(boost::filesystem::exists(new_target_path_));
+  for (size_t offset = 0; offset < image_.size(); offset += kChunkSize) {
+    ASSERT_TRUE(send(*agent, offset, offset + kChunkSize).isSuccess());
+  }
+  EXPECT_TRUE(agent->install(target_).isSuccess());
+  EXPECT_EQ(Utils::readFile(target_path_), image_);
+}
+
+/* An agent created after a restart picks up the partial image and hashes what
+ * is already on the disk. */
+TEST_F(FileUpdateAgentTest, ResumeAfterRestart) {
+  const size_t part = kChunkSize + 100;
+  ASSERT_TRUE(send(*createAgent(), 0, part).isSuccess());
+
+  auto agent = createAgent();
+  EXPECT_EQ(agent->receivedDataSize(), part);
+  ASSERT_TRUE(send(*agent, part, image_.size()).isSuccess());
+  EXPECT_TRUE(agent->install(target_).isSuccess());
+  EXPECT_EQ(Utils::readFile(target_path_), image_);
+}
+
+/* The data from before the restart is read back for the hash rather than
+ * trusted, so damage to it is noticed. */
+TEST_F(FileUpdateAgentTest, DamagedPartialImage) {
+  const size_t part = kChunkSize + 100;
+  ASSERT_TRUE(send(*createAgent(), 0, part).isSuccess());
+  {
+    std::fstream file(new_target_path_.string(), std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    file.seekp(10);
+    file.put(static_cast<char>(~image_[10]));
+  }
+
+  auto agent = createAgent();
+  ASSERT_TRUE(send(*agent, part, image_.size()).isSuccess());
+  EXPECT_EQ(agent->install(target_).result_code.num_code, data::ResultCode::Numeric::kDownloadFailed);
+  EXPECT_FALSE(boost::filesystem::exists(target_path_));
+}
+
+/* Data still buffered by the open image file is flushed before the checks of
+ * install(), and the last chunk of the image leaves all of it on the disk. */
+TEST_F(FileUpdateAgentTest, FlushBeforeCheck) {
+  auto agent = createAgent();
+  // Small enough to stay in the stdio buffer unless it is flushed
+  ASSERT_TRUE(send(*agent, 0, 100).isSuccess());
+  auto result = agent->install(target_);
+  EXPECT_EQ(result.result_code.num_code, data::ResultCode::Numeric::kDownloadFailed);
+  EXPECT_EQ(result.description, "Received image size does not match the size specified in Target metadata: 100 != " +
+                                    std::to_string(image_.size()));
+
+  ASSERT_TRUE(send(*agent, 0, image_.size() - 100).isSuccess());
+  ASSERT_TRUE(send(*agent, image_.size() - 100, image_.size()).isSuccess());
+  EXPECT_EQ(boost::filesystem::file_size(new_target_path_), image_.size());
+  EXPECT_EQ(Utils::readFile(new_target_path_), image_);
+  EXPECT_TRUE(agent->install(target_).isSuccess());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
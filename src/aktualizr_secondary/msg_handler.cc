@@ -2,10 +2,28 @@
 
 #include "logging/logging.h"
 
-void MsgDispatcher::clearHandlers() { handler_map_.clear(); }
+void MsgDispatcher::clearHandlers() {
+  handler_map_.clear();
+  raw_handler_map_.clear();
+}
+
+void MsgDispatcher::registerHandler(AKIpUptaneMes_PR msg_id, Handler handler, Access access) {
+  handler_map_[msg_id] = Entry<Handler>{std::move(handler), access};
+}
 
-void MsgDispatcher::registerHandler(AKIpUptaneMes_PR msg_id, Handler handler) {
-  handler_map_[msg_id] = std::move(handler);
+void MsgDispatcher::registerRawHandler(AKIpUptaneMes_PR msg_id, RawHandler handler, Access access) {
+  raw_handler_map_[msg_id] = Entry<RawHandler>{std::move(handler), access};
+}
+
+void MsgDispatcher::setHandlerAccess(AKIpUptaneMes_PR msg_id, Access access) {
+  auto handler_it = handler_map_.find(msg_id);
+  if (handler_it != handler_map_.end()) {
+    handler_it->second.access = access;
+  }
+  auto raw_handler_it = raw_handler_map_.find(msg_id);
+  if (raw_handler_it != raw_handler_map_.end()) {
+    raw_handler_it->second.access = access;
+  }
 }
 
 MsgHandler::ReturnCode MsgDispatcher::handleMsg(const Asn1Message::Ptr& in_msg, Asn1Message::Ptr& out_msg) {
@@ -14,7 +32,8 @@ MsgHandler::ReturnCode MsgDispatcher::handleMsg(const Asn1Message::Ptr& in_msg,
     return MsgHandler::kUnkownMsg;
   }
   LOG_TRACE << "Found a handler for the request, processing it...";
-  auto handle_status_code = find_res_it->second(*in_msg, *out_msg);
+  auto handle_status_code =
+      dispatch(find_res_it->second.access, [&]() { return find_res_it->second.handler(*in_msg, *out_msg); });
   LOG_TRACE << "Request handler returned a response: " << out_msg->toStr();
 
   // Track the last message to help cut down on repetitive logging. Ignore the
@@ -24,3 +43,37 @@ MsgHandler::ReturnCode MsgDispatcher::handleMsg(const Asn1Message::Ptr& in_msg,
   }
   return handle_status_code;
 }
+
+MsgHandler::ReturnCode MsgDispatcher::handleRawMsg(const Asn1Message::Ptr& in_msg, Asn1Message::Ptr& out_msg,
+                                                   const PayloadReader& payload) {
+  auto find_res_it = raw_handler_map_.find(in_msg->present());
+  if (find_res_it == raw_handler_map_.end()) {
+    return MsgHandler::kUnkownMsg;
+  }
+  auto handle_status_code = dispatch(find_res_it->second.access,
+                                     [&]() { return find_res_it->second.handler(*in_msg, *out_msg, payload); });
+  LOG_TRACE << "Request handler returned a response: " << out_msg->toStr();
+
+  last_msg_ = in_msg->present();
+  return handle_status_code;
+}
+
+MsgHandler::ReturnCode MsgDispatcher::dispatch(Access access, const std::function<ReturnCode()>& call) {
+  switch (access) {
+    case Access::kQuery: {
+      std::shared_lock<std::shared_mutex> state_lock(state_mutex_);
+      return call();
+    }
+    case Access::kUpdate: {
+      std::lock_guard<std::mutex> update_lock(update_mutex_);
+      std::shared_lock<std::shared_mutex> state_lock(state_mutex_);
+      return call();
+    }
+    case Access::kExclusive:
+    default: {
+      std::lock_guard<std::mutex> update_lock(update_mutex_);
+      std::unique_lock<std::shared_mutex> state_lock(state_mutex_);
+      return call();
+    }
+  }
+}
@@ -1,7 +1,14 @@
 #ifndef MSG_HANDLER_H
 #define MSG_HANDLER_H
 
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include "AKIpUptaneMes.h"
@@ -10,6 +17,9 @@
 class MsgHandler {
  public:
   enum ReturnCode { kUnkownMsg = -1, kOk, kRebootRequired };
+  // Reads up to len bytes of the raw payload that follows a request. Returns
+  // the number of bytes read, 0 at the end of the payload or -1 on error.
+  using PayloadReader = std::function<ssize_t(uint8_t* buf, size_t len)>;
 
   MsgHandler() = default;
   virtual ~MsgHandler() = default;
@@ -19,22 +29,57 @@ class MsgHandler {
   MsgHandler& operator=(MsgHandler&&) = delete;
 
   virtual ReturnCode handleMsg(const Asn1Message::Ptr& in_msg, Asn1Message::Ptr& out_msg) = 0;
+  // Handle a request that is followed by a raw payload (uploadRawReq)
+  virtual ReturnCode handleRawMsg(const Asn1Message::Ptr& in_msg, Asn1Message::Ptr& out_msg,
+                                  const PayloadReader& payload) {
+    (void)in_msg;
+    (void)out_msg;
+    (void)payload;
+    return kUnkownMsg;
+  }
 };
 
+/* Requests from several connections can be handled at the same time. Each
+ * handler declares what else may run while it does. */
 class MsgDispatcher : public MsgHandler {
  public:
   using Handler = std::function<ReturnCode(Asn1Message&, Asn1Message&)>;
+  using RawHandler = std::function<ReturnCode(Asn1Message&, Asn1Message&, const PayloadReader&)>;
+
+  enum class Access {
+    kExclusive,  // runs alone, e.g. because it changes the metadata
+    kUpdate,     // runs one at a time, but alongside kQuery handlers
+    kQuery,      // only reads; runs alongside anything but kExclusive handlers
+  };
 
-  void registerHandler(AKIpUptaneMes_PR msg_id, Handler handler);
+  void registerHandler(AKIpUptaneMes_PR msg_id, Handler handler, Access access = Access::kExclusive);
+  void registerRawHandler(AKIpUptaneMes_PR msg_id, RawHandler handler, Access access = Access::kExclusive);
   ReturnCode handleMsg(const Asn1Message::Ptr& in_msg, Asn1Message::Ptr& out_msg) override;
+  ReturnCode handleRawMsg(const Asn1Message::Ptr& in_msg, Asn1Message::Ptr& out_msg,
+                          const PayloadReader& payload) override;
 
  protected:
   void clearHandlers();
+  // Change what may run alongside an already registered handler
+  void setHandlerAccess(AKIpUptaneMes_PR msg_id, Access access);
 
-  unsigned int last_msg_ = 0;
+  std::atomic<unsigned int> last_msg_{0};
 
  private:
-  std::unordered_map<unsigned int, Handler> handler_map_;
+  template <typename T>
+  struct Entry {
+    T handler;
+    Access access;
+  };
+
+  ReturnCode dispatch(Access access, const std::function<ReturnCode()>& call);
+
+  std::unordered_map<unsigned int, Entry<Handler>> handler_map_;
+  std::unordered_map<unsigned int, Entry<RawHandler>> raw_handler_map_;
+  // Held by kExclusive and kUpdate handlers
+  std::mutex update_mutex_;
+  // Held exclusively by kExclusive handlers and shared by the others
+  std::shared_mutex state_mutex_;
 };
 
 #endif  // MSG_HANDLER_H
@@ -1,3 +1,8 @@
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
 #include <thread>
 
 #include <gtest/gtest.h>
@@ -14,16 +19,17 @@
 #include "secondary_tcp_server.h"
 #include "storage/invstorage.h"
 #include "test_utils.h"
+#include "utilities/dequeue_buffer.h"
 
-enum class HandlerVersion { kV1, kV2, kV2Failure };
+enum class HandlerVersion { kV1, kV2, kV2Failure, kV3, kV4, kV5 };
 
 /* This class allows us to divert messages from the regular handlers in
  * AktualizrSecondary to our own test functions. This lets us test only what was
  * received by the Secondary but not how it was processed.
  *
- * It also has handlers for both the old/v1 and new/v2 versions of the RPC
- * protocol, so this is how we prove that the Primary is still
- * backwards-compatible with older/v1 Secondaries. */
+ * It also has handlers for the old/v1, v2, streaming/v3 and raw upload/v4
+ * versions of the RPC protocol, so this is how we prove that the Primary is still
+ * backwards-compatible with older Secondaries. */
 class SecondaryMock : public MsgDispatcher {
  public:
   SecondaryMock(const Uptane::EcuSerial& serial, const Uptane::HardwareIdentifier& hdw_id, const PublicKey& pub_key,
@@ -50,6 +56,10 @@ class SecondaryMock : public MsgDispatcher {
   const PublicKey& publicKey() const { return pub_key_; }
   const Uptane::Manifest& manifest() const { return manifest_; }
   const Uptane::MetaBundle& metadata() const { return meta_bundle_; }
+  // Number of metadata files in the last putMetaReq2
+  size_t receivedMetaCount() const { return received_meta_count_; }
+  // Act as if the stored metadata had been lost
+  void forgetMetadata() { meta_bundle_.clear(); }
   HandlerVersion handlerVersion() const { return handler_version_; }
   void setHandlerVersion(HandlerVersion handler_version_in) { handler_version_ = handler_version_in; }
   void registerHandlers() {
@@ -58,12 +68,22 @@ class SecondaryMock : public MsgDispatcher {
       registerV1Handlers();
     } else if (handler_version_ == HandlerVersion::kV2) {
       registerV2Handlers();
+    } else if (handler_version_ == HandlerVersion::kV3) {
+      registerV2Handlers();
+      registerV3Handlers();
+    } else if (handler_version_ == HandlerVersion::kV4 || handler_version_ == HandlerVersion::kV5) {
+      // v5 only changes what putMetaReq2 may leave out
+      registerV2Handlers();
+      registerV3Handlers();
+      registerV4Handlers();
     } else {
       registerV2FailureHandlers();
     }
   }
 
   void resetImageHash() const { hasher_->reset(); }
+  // Drop the connection instead of storing the next chunk of a streaming upload
+  void interruptNextUpload() { interrupt_upload_ = true; }
   Hash getReceivedImageHash() const { return hasher_->getHash(); }
   size_t getReceivedImageSize() const { return boost::filesystem::file_size(image_filepath_); }
 
@@ -111,6 +131,19 @@ class SecondaryMock : public MsgDispatcher {
                     std::bind(&SecondaryMock::putRootHdlr, this, std::placeholders::_1, std::placeholders::_2));
   }
 
+  // Used by protocol v3 on top of the v2 handlers:
+  void registerV3Handlers() {
+    registerHandler(AKIpUptaneMes_PR_uploadDataReq2,
+                    std::bind(&SecondaryMock::uploadData2Hdlr, this, std::placeholders::_1, std::placeholders::_2));
+  }
+
+  // Used by protocol v4 on top of the v3 handlers:
+  void registerV4Handlers() {
+    registerRawHandler(AKIpUptaneMes_PR_uploadRawReq,
+                       std::bind(&SecondaryMock::uploadRawHdlr, this, std::placeholders::_1, std::placeholders::_2,
+                                 std::placeholders::_3));
+  }
+
   // Procotol v2 handlers that fail in predictable ways.
   void registerV2FailureHandlers() {
     registerHandler(AKIpUptaneMes_PR_putMetaReq2,
@@ -148,6 +181,12 @@ class SecondaryMock : public MsgDispatcher {
     auto m = out_msg.present(AKIpUptaneMes_PR_versionResp).versionResp();
     if (handler_version_ == HandlerVersion::kV1) {
       m->version = 1;
+    } else if (handler_version_ == HandlerVersion::kV3) {
+      m->version = 3;
+    } else if (handler_version_ == HandlerVersion::kV4) {
+      m->version = 4;
+    } else if (handler_version_ == HandlerVersion::kV5) {
+      m->version = 5;
     } else {
       m->version = 2;
     }
@@ -199,7 +238,9 @@ class SecondaryMock : public MsgDispatcher {
     if (vtype_ == VerificationType::kFull) {
       // NOLINTNEXTLINE(cppcoreguidelines-pro-type-union-access)
       const int director_meta_count = md->directorRepo.choice.collection.list.count;
-      EXPECT_EQ(director_meta_count, 2);
+      if (handler_version_ != HandlerVersion::kV5) {
+        EXPECT_EQ(director_meta_count, 2);
+      }
       for (int i = 0; i < director_meta_count; i++) {
         // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic, cppcoreguidelines-pro-type-union-access)
         const AKMetaJson_t object = *md->directorRepo.choice.collection.list.array[i];
@@ -218,7 +259,9 @@ class SecondaryMock : public MsgDispatcher {
     EXPECT_EQ(md->imageRepo.present, imageRepo_PR_collection);
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-union-access)
     const int image_meta_count = md->imageRepo.choice.collection.list.count;
-    EXPECT_EQ(image_meta_count, 4);
+    if (handler_version_ != HandlerVersion::kV5) {
+      EXPECT_EQ(image_meta_count, 4);
+    }
     for (int i = 0; i < image_meta_count; i++) {
       // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic, cppcoreguidelines-pro-type-union-access)
       const AKMetaJson_t object = *md->imageRepo.choice.collection.list.array[i];
@@ -236,7 +279,19 @@ class SecondaryMock : public MsgDispatcher {
       }
     }
 
-    data::InstallationResult result = putMetadata2(meta_bundle);
+    received_meta_count_ = meta_bundle.size();
+    data::InstallationResult result;
+    if (handler_version_ == HandlerVersion::kV5) {
+      // Whatever was left out must be the same as in the previous request
+      for (const auto& meta : meta_bundle_) {
+        meta_bundle.emplace(meta);
+      }
+    }
+    if (meta_bundle.size() != (vtype_ == VerificationType::kFull ? 6 : 4)) {
+      result = data::InstallationResult(data::ResultCode::Numeric::kVerificationFailed, verification_failure);
+    } else {
+      result = putMetadata2(meta_bundle);
+    }
 
     auto m = out_msg.present(AKIpUptaneMes_PR_putMetaResp2).putMetaResp2();
     m->result = static_cast<AKInstallationResultCode_t>(result.result_code.num_code);
@@ -308,6 +363,69 @@ class SecondaryMock : public MsgDispatcher {
     return ReturnCode::kOk;
   }
 
+  MsgHandler::ReturnCode uploadData2Hdlr(Asn1Message& in_msg, Asn1Message& out_msg) {
+    auto req = in_msg.uploadDataReq2();
+    auto result = data::InstallationResult(data::ResultCode::Numeric::kOk, "");
+    if (req->data.size > 0) {
+      if (interrupt_upload_ && req->offset > 0) {
+        interrupt_upload_ = false;
+        return ReturnCode::kUnkownMsg;
+      }
+      if (req->offset == 0) {
+        boost::filesystem::remove(image_filepath_);
+        hasher_->reset();
+      }
+      EXPECT_LE(req->data.size, kMaxChunkSize);
+      EXPECT_EQ(req->offset, receivedImageSize());
+      result = receiveImageData(req->data.buf, static_cast<size_t>(req->data.size));
+    }
+
+    auto m = out_msg.present(AKIpUptaneMes_PR_uploadDataResp2).uploadDataResp2();
+    m->result = static_cast<AKInstallationResultCode_t>(result.result_code.num_code);
+    SetString(&m->description, result.description);
+    m->received = receivedImageSize();
+    m->maxChunkSize = kMaxChunkSize;
+
+    return ReturnCode::kOk;
+  }
+
+  MsgHandler::ReturnCode uploadRawHdlr(Asn1Message& in_msg, Asn1Message& out_msg, const PayloadReader& payload) {
+    auto req = in_msg.uploadRawReq();
+    auto result = data::InstallationResult(data::ResultCode::Numeric::kOk, "");
+    if (req->length > 0) {
+      if (interrupt_upload_ && req->offset > 0) {
+        interrupt_upload_ = false;
+        return ReturnCode::kUnkownMsg;
+      }
+      if (req->offset == 0) {
+        boost::filesystem::remove(image_filepath_);
+        hasher_->reset();
+      }
+      EXPECT_EQ(req->offset, receivedImageSize());
+      std::vector<uint8_t> data(static_cast<size_t>(req->length));
+      size_t total = 0;
+      ssize_t read_bytes;
+      while ((read_bytes = payload(data.data() + total, data.size() - total)) > 0) {
+        total += static_cast<size_t>(read_bytes);
+      }
+      EXPECT_EQ(read_bytes, 0);
+      EXPECT_EQ(total, data.size());
+      result = receiveImageData(data.data(), total);
+    }
+
+    auto m = out_msg.present(AKIpUptaneMes_PR_uploadDataResp2).uploadDataResp2();
+    m->result = static_cast<AKInstallationResultCode_t>(result.result_code.num_code);
+    SetString(&m->description, result.description);
+    m->received = receivedImageSize();
+    m->maxChunkSize = kMaxChunkSize;
+
+    return ReturnCode::kOk;
+  }
+
+  long receivedImageSize() const {
+    return boost::filesystem::exists(image_filepath_) ? static_cast<long>(getReceivedImageSize()) : 0;
+  }
+
   MsgHandler::ReturnCode uploadDataFailureHdlr(Asn1Message& in_msg, Asn1Message& out_msg) {
     (void)in_msg;
 
@@ -436,6 +554,9 @@ class SecondaryMock : public MsgDispatcher {
   std::string received_firmware_data_;
   VerificationType vtype_;
   HandlerVersion handler_version_;
+  bool interrupt_upload_{false};
+  size_t received_meta_count_{0};
+  static constexpr long kMaxChunkSize{64 * 1024};
 };
 
 class TargetFile {
@@ -747,7 +868,17 @@ INSTANTIATE_TEST_SUITE_P(SecondaryRpcTestCases, SecondaryRpcTest,
                                            std::make_tuple(1024 - 1, HandlerVersion::kV1, VerificationType::kFull),
                                            std::make_tuple(1024 + 1, HandlerVersion::kV1, VerificationType::kFull),
                                            std::make_tuple(1024 * 10 + 1, HandlerVersion::kV1, VerificationType::kFull),
-                                           std::make_tuple(1024, HandlerVersion::kV2Failure, VerificationType::kFull)));
+                                           std::make_tuple(1024, HandlerVersion::kV2Failure, VerificationType::kFull),
+                                           std::make_tuple(1, HandlerVersion::kV3, VerificationType::kFull),
+                                           std::make_tuple(1024 * 10 + 1, HandlerVersion::kV3, VerificationType::kFull),
+                                           std::make_tuple(1024 * 1025, HandlerVersion::kV3, VerificationType::kFull),
+                                           std::make_tuple(1024 * 1025, HandlerVersion::kV3, VerificationType::kTuf),
+                                           std::make_tuple(1, HandlerVersion::kV4, VerificationType::kFull),
+                                           std::make_tuple(1024 * 10 + 1, HandlerVersion::kV4, VerificationType::kFull),
+                                           std::make_tuple(1024 * 1025, HandlerVersion::kV4, VerificationType::kFull),
+                                           std::make_tuple(1024 * 1025, HandlerVersion::kV4, VerificationType::kTuf),
+                                           std::make_tuple(1024 + 1, HandlerVersion::kV5, VerificationType::kFull),
+                                           std::make_tuple(1024 + 1, HandlerVersion::kV5, VerificationType::kTuf)));
 
 class SecondaryRpcUpgrade : public SecondaryRpcCommon {
  protected:
@@ -775,6 +906,75 @@ TEST_F(SecondaryRpcUpgrade, VersionUpgrade) {
   installOstreeRev();
 }
 
+class SecondaryRpcStreaming : public SecondaryRpcCommon {
+ protected:
+  SecondaryRpcStreaming() : SecondaryRpcCommon(1024 * 1024, HandlerVersion::kV3, VerificationType::kFull) {}
+};
+
+/* A streaming upload resumes from the last stored byte after the connection
+ * to the Secondary breaks. */
+TEST_F(SecondaryRpcStreaming, ResumeUpload) {
+  ASSERT_TRUE(ip_secondary_ != nullptr) << "Failed to create IP Secondary";
+
+  secondary_.interruptNextUpload();
+  sendAndInstallBinaryImage();
+  EXPECT_EQ(secondary_.getReceivedImageSize(), 1024 * 1024);
+
+  // A second upload starts over rather than appending to the first one
+  sendAndInstallBinaryImage();
+  EXPECT_EQ(secondary_.getReceivedImageSize(), 1024 * 1024);
+}
+
+class SecondaryRpcRawUpload : public SecondaryRpcCommon {
+ protected:
+  SecondaryRpcRawUpload() : SecondaryRpcCommon(1024 * 1024, HandlerVersion::kV4, VerificationType::kFull) {}
+};
+
+/* The same holds for raw payloads sent straight from the image file. */
+TEST_F(SecondaryRpcRawUpload, ResumeUpload) {
+  ASSERT_TRUE(ip_secondary_ != nullptr) << "Failed to create IP Secondary";
+
+  secondary_.interruptNextUpload();
+  sendAndInstallBinaryImage();
+  EXPECT_EQ(secondary_.getReceivedImageSize(), 1024 * 1024);
+}
+
+class SecondaryRpcChangedMetadata : public SecondaryRpcCommon {
+ protected:
+  SecondaryRpcChangedMetadata() : SecondaryRpcCommon(1024, HandlerVersion::kV5, VerificationType::kFull) {}
+};
+
+/* Protocol v5 only sends the metadata that changed since the Secondary last
+ * accepted it. */
+TEST_F(SecondaryRpcChangedMetadata, SendChangedOnly) {
+  ASSERT_TRUE(ip_secondary_ != nullptr) << "Failed to create IP Secondary";
+  Uptane::Target target = image_file_.createTarget(package_manager_);
+
+  EXPECT_TRUE(ip_secondary_->putMetadata(target).isSuccess());
+  EXPECT_EQ(secondary_.receivedMetaCount(), 6);
+
+  EXPECT_TRUE(ip_secondary_->putMetadata(target).isSuccess());
+  EXPECT_EQ(secondary_.receivedMetaCount(), 0);
+  verifyMetadata(secondary_.metadata());
+
+  storage_->storeNonRoot("director-targets-v2", Uptane::RepositoryType::Director(), Uptane::Role::Targets());
+  EXPECT_TRUE(ip_secondary_->putMetadata(target).isSuccess());
+  EXPECT_EQ(secondary_.receivedMetaCount(), 1);
+  EXPECT_EQ(Uptane::getMetaFromBundle(secondary_.metadata(), Uptane::RepositoryType::Director(),
+                                      Uptane::Role::Targets()),
+            "director-targets-v2");
+
+  // A new Root makes the Secondary drop the other metadata
+  EXPECT_TRUE(ip_secondary_->putRoot(image_root_v2_, false).isSuccess());
+  EXPECT_TRUE(ip_secondary_->putMetadata(target).isSuccess());
+  EXPECT_EQ(secondary_.receivedMetaCount(), 6);
+
+  // Everything is sent again if the Secondary unexpectedly fails
+  secondary_.forgetMetadata();
+  EXPECT_TRUE(ip_secondary_->putMetadata(target).isSuccess());
+  EXPECT_EQ(secondary_.receivedMetaCount(), 6);
+}
+
 TEST(SecondaryTcpServer, TestIpSecondaryIfSecondaryIsNotRunning) {
   in_port_t secondary_port = TestUtils::getFreePortAsInt();
   SecondaryInterface::Ptr ip_secondary;
@@ -857,16 +1057,40 @@ class SecondaryRpcTestPositive : public ::testing::Test, public MsgHandler {
   std::thread secondary_server_thread_;
 };
 
-/* This test fails because the Secondary TCP server implementation is a
- * single-threaded, synchronous and blocking hence it cannot accept any new
- * connections until the current one is closed. Therefore, if a client/Primary
- * does not close its socket for some reason then Secondary becomes
- * "unavailable" */
-// TEST_F(SecondaryRpcTestPositive, primaryNotClosingSocket) {
-//  ConnectionSocket con_sock{"127.0.0.1", secondary_server_.port()};
-//  con_sock.connect();
-//  ASSERT_EQ(sendInstallMsg(), AKIpUptaneMes_PR_installResp);
-//}
+/* A client/Primary that does not close its socket doesn't make the Secondary
+ * unavailable, as each connection is served by its own thread. */
+TEST_F(SecondaryRpcTestPositive, primaryNotClosingSocket) {
+  ConnectionSocket con_sock{"127.0.0.1", secondary_server_.port()};
+  con_sock.connect();
+  ASSERT_EQ(sendInstallMsg(), AKIpUptaneMes_PR_installResp);
+}
+
+/* Connections beyond the limit are closed straight away, and served again once
+ * an earlier connection has gone. */
+TEST_F(SecondaryRpcTestPositive, tooManyConnections) {
+  std::list<ConnectionSocket> idle;
+  for (size_t i = 0; i < SecondaryTcpServer::kMaxConnections; ++i) {
+    idle.emplace_back("127.0.0.1", secondary_server_.port());
+    ASSERT_EQ(idle.back().connect(), 0);
+  }
+
+  ConnectionSocket extra{"127.0.0.1", secondary_server_.port()};
+  ASSERT_EQ(extra.connect(), 0);
+  timeval timeout{10, 0};
+  setsockopt(*extra, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  uint8_t byte = 0;
+  EXPECT_EQ(recv(*extra, &byte, 1, 0), 0);
+  EXPECT_EQ(sendInstallMsg(), AKIpUptaneMes_PR_NOTHING);
+
+  // The server notices the closed connections in the background
+  idle.clear();
+  AKIpUptaneMes_PR resp = AKIpUptaneMes_PR_NOTHING;
+  for (int attempt = 0; attempt < 100 && resp == AKIpUptaneMes_PR_NOTHING; ++attempt) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    resp = sendInstallMsg();
+  }
+  EXPECT_EQ(resp, AKIpUptaneMes_PR_installResp);
+}
 
 TEST_F(SecondaryRpcTestPositive, primaryConnectAndDisconnect) {
   ConnectionSocket{"127.0.0.1", secondary_server_.port()}.connect();
@@ -913,6 +1137,123 @@ TEST_F(SecondaryRpcTestPositive, primaryConnectAndSendGarbage) {
   ASSERT_EQ(sendInstallMsg(), AKIpUptaneMes_PR_installResp);
 }
 
+/* A bare Secondary that serves one connection at a time and can misbehave in
+ * ways that SecondaryTcpServer never does. It answers every request with its
+ * info and counts the connections, so that the tests can tell whether
+ * IpUptaneSecondary reused its session or opened a new one. */
+class SecondaryRpcSession : public ::testing::Test {
+ protected:
+  enum class Reply { kNormal, kGarbage, kCloseAfterReply };
+
+  SecondaryRpcSession() {
+    if (listen(*listen_socket_, SOMAXCONN) < 0) {
+      throw std::system_error(errno, std::system_category(), "listen");
+    }
+    server_thread_ = std::thread([this]() { run(); });
+    ip_secondary_ = std_::make_unique<Uptane::IpUptaneSecondary>(
+        "localhost", listen_socket_.port(), VerificationType::kFull, Uptane::EcuSerial("serial"),
+        Uptane::HardwareIdentifier("hwid"), PublicKey("key", KeyType::kED25519));
+  }
+
+  ~SecondaryRpcSession() override {
+    stop_ = true;
+    // Closes the session, if any, and then gets the server out of accept()
+    ip_secondary_.reset();
+    ::shutdown(*listen_socket_, SHUT_RDWR);
+    server_thread_.join();
+  }
+
+  int connections() const { return connections_; }
+
+  bool waitForClosedConnections(int count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return closed_cv_.wait_for(lock, std::chrono::seconds(10), [this, count]() { return closed_ >= count; });
+  }
+
+  std::atomic<Reply> next_reply_{Reply::kNormal};
+  std::unique_ptr<Uptane::IpUptaneSecondary> ip_secondary_;
+
+ private:
+  void run() {
+    while (!stop_) {
+      const int con_fd = accept4(*listen_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (con_fd < 0) {
+        break;
+      }
+      ++connections_;
+      serve(con_fd);
+      ::close(con_fd);
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++closed_;
+      closed_cv_.notify_all();
+    }
+  }
+
+  void serve(int con_fd) {
+    DequeueBuffer buffer;
+    for (;;) {
+      Asn1Message::Ptr req = Asn1Receive(con_fd, buffer);
+      if (req->present() == AKIpUptaneMes_PR_NOTHING) {
+        return;
+      }
+      const Reply reply = next_reply_.exchange(Reply::kNormal);
+      if (reply == Reply::kGarbage) {
+        // A complete element that is not a valid message, while the connection stays open
+        const std::array<uint8_t, 2> garbage{0x05, 0x00};
+        if (send(con_fd, garbage.data(), garbage.size(), MSG_NOSIGNAL) < 0) {
+          return;
+        }
+        continue;
+      }
+
+      Asn1Message::Ptr resp = Asn1Message::Empty();
+      resp->present(AKIpUptaneMes_PR_getInfoResp);
+      auto info_resp = resp->getInfoResp();
+      SetString(&info_resp->ecuSerial, "serial");
+      SetString(&info_resp->hwId, "hwid");
+      info_resp->keyType = static_cast<AKIpUptaneKeyType_t>(KeyType::kED25519);
+      SetString(&info_resp->key, "key");
+      if (!Asn1Send(resp, con_fd) || reply == Reply::kCloseAfterReply) {
+        return;
+      }
+    }
+  }
+
+  ListenSocket listen_socket_{0};
+  std::thread server_thread_;
+  std::atomic<bool> stop_{false};
+  std::atomic<int> connections_{0};
+  std::mutex mutex_;
+  std::condition_variable closed_cv_;
+  int closed_{0};
+};
+
+/* A reply that cannot be decoded leaves the session out of sync, so it is
+ * dropped and the next request goes over a new connection. */
+TEST_F(SecondaryRpcSession, ReconnectAfterBadReply) {
+  EXPECT_TRUE(ip_secondary_->ping());
+  EXPECT_TRUE(ip_secondary_->ping());
+  EXPECT_EQ(connections(), 1);
+
+  next_reply_ = Reply::kGarbage;
+  EXPECT_FALSE(ip_secondary_->ping());
+  EXPECT_TRUE(ip_secondary_->ping());
+  EXPECT_EQ(connections(), 2);
+}
+
+/* A connection that the Secondary closed while it was idle, e.g. because it was
+ * restarted, is noticed before the next request is sent on it. */
+TEST_F(SecondaryRpcSession, ReconnectAfterIdleClose) {
+  next_reply_ = Reply::kCloseAfterReply;
+  EXPECT_TRUE(ip_secondary_->ping());
+  ASSERT_TRUE(waitForClosedConnections(1));
+
+  EXPECT_TRUE(ip_secondary_->ping());
+  EXPECT_EQ(connections(), 2);
+  EXPECT_TRUE(ip_secondary_->ping());
+  EXPECT_EQ(connections(), 2);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -1,6 +1,13 @@
 #include "secondary_tcp_server.h"
 
 #include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
 
 #include "AKInstallationResultCode.h"
 #include "AKIpUptaneMes.h"
@@ -15,7 +22,11 @@ SecondaryTcpServer::SecondaryTcpServer(MsgHandler &msg_handler, const std::strin
       listen_socket_(port),
       keep_running_(true),
       reboot_after_install_(reboot_after_install),
+      wakeup_fd_(eventfd(0, EFD_CLOEXEC)),
       is_running_(false) {
+  if (wakeup_fd_ < 0) {
+    throw std::system_error(errno, std::system_category(), "eventfd");
+  }
   if (primary_ip.empty()) {
     return;
   }
@@ -29,12 +40,27 @@ SecondaryTcpServer::SecondaryTcpServer(MsgHandler &msg_handler, const std::strin
   }
 }
 
+SecondaryTcpServer::~SecondaryTcpServer() { ::close(wakeup_fd_); }
+
 void SecondaryTcpServer::run() {
   if (listen(*listen_socket_, SOMAXCONN) < 0) {
     throw std::system_error(errno, std::system_category(), "listen");
   }
   LOG_INFO << "Secondary TCP server listening on " << listen_socket_.ToString();
 
+  Socket epoll_fd(epoll_create1(EPOLL_CLOEXEC));
+  if (*epoll_fd < 0) {
+    throw std::system_error(errno, std::system_category(), "epoll_create1");
+  }
+  for (int fd : {*listen_socket_, wakeup_fd_}) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(*epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      throw std::system_error(errno, std::system_category(), "epoll_ctl");
+    }
+  }
+
   {
     std::unique_lock<std::mutex> lock(running_condition_mutex_);
     is_running_ = true;
@@ -44,11 +70,26 @@ void SecondaryTcpServer::run() {
   bool first_connection = true;
 
   while (keep_running_.load()) {
+    std::array<epoll_event, 2> events{};
+    const int count = epoll_wait(*epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR << "Failed to wait for connections: " << strerror(errno);
+      break;
+    }
+    // A wake-up only means that keep_running_ has to be checked again
+    if (!keep_running_.load() ||
+        std::none_of(events.begin(), events.begin() + count,
+                     [this](const epoll_event &event) { return event.data.fd == *listen_socket_; })) {
+      continue;
+    }
+
     sockaddr_storage peer_sa{};
     socklen_t peer_sa_size = sizeof(sockaddr_storage);
 
-    LOG_DEBUG << "Waiting for connection from Primary...";
-    int con_fd = accept(*listen_socket_, reinterpret_cast<sockaddr *>(&peer_sa), &peer_sa_size);
+    int con_fd = accept4(*listen_socket_, reinterpret_cast<sockaddr *>(&peer_sa), &peer_sa_size, SOCK_CLOEXEC);
     if (con_fd == -1) {
       // Accept can fail if a client closes connection/client socket before a TCP handshake completes or
       // a network connection goes down in the middle of a TCP handshake procedure. At first glance it looks like
@@ -61,17 +102,32 @@ void SecondaryTcpServer::run() {
       break;
     }
 
+    if (!startConnection(con_fd)) {
+      LOG_WARNING << "Already serving " << kMaxConnections << " connections, refusing a new one.";
+      ::close(con_fd);
+      continue;
+    }
     if (first_connection) {
       LOG_INFO << "Primary connected.";
       first_connection = false;
     } else {
       LOG_DEBUG << "Primary reconnected.";
     }
-    auto continue_running = HandleOneConnection(*Socket(con_fd));
-    if (!continue_running) {
-      keep_running_.store(false);
+  }
+
+  // Unblock the remaining connections and wait for them to finish
+  std::list<Connection> connections;
+  {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    for (auto &connection : connections_) {
+      if (connection.socket != -1) {
+        ::shutdown(connection.socket, SHUT_RDWR);
+      }
     }
-    LOG_DEBUG << "Primary disconnected.";
+    connections.splice(connections.end(), connections_);
+  }
+  for (auto &connection : connections) {
+    connection.thread.join();
   }
 
   {
@@ -83,65 +139,123 @@ void SecondaryTcpServer::run() {
   LOG_INFO << "Secondary TCP server exiting.";
 }
 
+bool SecondaryTcpServer::startConnection(int socket) {
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  for (auto it = connections_.begin(); it != connections_.end();) {
+    if (it->done) {
+      it->thread.join();
+      it = connections_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (connections_.size() >= kMaxConnections) {
+    return false;
+  }
+
+  connections_.emplace_back(socket);
+  Connection &connection = connections_.back();
+  connection.thread = std::thread([this, &connection, socket]() {
+    const bool continue_running = HandleOneConnection(socket);
+    {
+      // Don't let stop() shut down whatever gets this descriptor next
+      std::lock_guard<std::mutex> connection_lock(connections_mutex_);
+      ::close(connection.socket);
+      connection.socket = -1;
+      connection.done = true;
+    }
+    LOG_DEBUG << "Primary disconnected.";
+    if (!continue_running) {
+      keep_running_.store(false);
+      wakeUp();
+    }
+  });
+  return true;
+}
+
 void SecondaryTcpServer::stop() {
   LOG_DEBUG << "Stopping Secondary TCP server...";
   keep_running_.store(false);
-  // unblock accept
-  ConnectionSocket("localhost", listen_socket_.port()).connect();
+  {
+    // unblock the connected Primaries
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    for (auto &connection : connections_) {
+      if (connection.socket != -1) {
+        ::shutdown(connection.socket, SHUT_RDWR);
+      }
+    }
+  }
+  wakeUp();
+}
+
+void SecondaryTcpServer::wakeUp() {
+  const uint64_t one = 1;
+  if (write(wakeup_fd_, &one, sizeof(one)) < 0) {
+    LOG_ERROR << "Failed to wake up the Secondary TCP server: " << strerror(errno);
+  }
 }
 
 in_port_t SecondaryTcpServer::port() const { return listen_socket_.port(); }
-SecondaryTcpServer::ExitReason SecondaryTcpServer::exit_reason() const { return exit_reason_; }
+SecondaryTcpServer::ExitReason SecondaryTcpServer::exit_reason() const { return exit_reason_.load(); }
 
 static bool sendResponseMessage(int socket_fd, const Asn1Message::Ptr &resp_msg);
+static bool skipPayload(const MsgHandler::PayloadReader &payload);
 
 bool SecondaryTcpServer::HandleOneConnection(int socket) {
-  // Outside the message loop, because one recv() may have parts of 2 messages
-  // Note that one recv() call returning 2+ messages doesn't work at the
-  // moment. This shouldn't be a problem until we have messages that aren't
-  // strictly request/response
+  // Outside the message loop, because one recv() may have parts of 2 messages:
+  // the Primary can send several upload requests before waiting for replies.
   DequeueBuffer buffer;
   bool keep_running_server = true;
   bool keep_running_current_session = true;
 
   while (keep_running_current_session) {  // Keep reading until we get an error
-    // Read an incoming message
-    AKIpUptaneMes_t *m = nullptr;
-    asn_dec_rval_t res{};
-    asn_codec_ctx_s context{};
-    ssize_t received;
-
-    do {
-      received = recv(socket, buffer.Tail(), buffer.TailSpace(), 0);
-      if (received < 0) {
-        LOG_ERROR << "Failed to read data from a server socket: " << strerror(errno);
-        break;
-      }
-      buffer.HaveEnqueued(static_cast<size_t>(received));
-      res = ber_decode(&context, &asn_DEF_AKIpUptaneMes, reinterpret_cast<void **>(&m), buffer.Head(), buffer.Size());
-      buffer.Consume(res.consumed);
-    } while (res.code == RC_WMORE && received > 0);
-    // Note that ber_decode allocates *m even on failure, so this must always be done
-    Asn1Message::Ptr request_msg = Asn1Message::FromRaw(&m);
-
-    if (received == 0) {
-      LOG_TRACE << "Primary has closed a connection socket";
-      break;
-    }
-
-    if (received < 0) {
-      LOG_ERROR << "Error while reading message data from a socket: " << strerror(errno);
-      break;
-    }
-
-    if (res.code != RC_OK) {
-      LOG_ERROR << "Failed to decode a message received from Primary";
+    // Read an incoming message. Asn1Receive() has logged why if this fails.
+    Asn1Message::Ptr request_msg = Asn1Receive(socket, buffer);
+    if (request_msg->present() == AKIpUptaneMes_PR_NOTHING) {
       break;
     }
 
     LOG_DEBUG << "Received a request from Primary: " << request_msg->toStr();
     Asn1Message::Ptr response_msg = Asn1Message::Empty();
-    MsgHandler::ReturnCode handle_status_code = msg_handler_.handleMsg(request_msg, response_msg);
+    MsgHandler::ReturnCode handle_status_code;
+    if (request_msg->present() == AKIpUptaneMes_PR_uploadRawReq) {
+      const long length = request_msg->uploadRawReq()->length;
+      if (length < 0) {
+        LOG_ERROR << "Invalid raw payload length: " << length;
+        break;
+      }
+      // The payload follows the message: hand out what recv() already put in
+      // the buffer, then read the rest directly into the caller's memory.
+      auto remaining = static_cast<size_t>(length);
+      MsgHandler::PayloadReader payload = [&buffer, &remaining, socket](uint8_t *buf, size_t len) -> ssize_t {
+        len = std::min(len, remaining);
+        if (len == 0) {
+          return 0;
+        }
+        ssize_t read_bytes;
+        if (buffer.Size() > 0) {
+          read_bytes = static_cast<ssize_t>(std::min(len, buffer.Size()));
+          memcpy(buf, buffer.Head(), static_cast<size_t>(read_bytes));
+          buffer.Consume(static_cast<size_t>(read_bytes));
+        } else {
+          read_bytes = recv(socket, buf, len, 0);
+          if (read_bytes <= 0) {
+            LOG_ERROR << "Failed to read a raw payload from a server socket: "
+                      << (read_bytes == 0 ? "connection closed" : strerror(errno));
+            return -1;
+          }
+        }
+        remaining -= static_cast<size_t>(read_bytes);
+        return read_bytes;
+      };
+      handle_status_code = msg_handler_.handleRawMsg(request_msg, response_msg, payload);
+      // Whatever the handler left unread must not be taken for the next message
+      if (handle_status_code != MsgHandler::ReturnCode::kUnkownMsg && !skipPayload(payload)) {
+        break;
+      }
+    } else {
+      handle_status_code = msg_handler_.handleMsg(request_msg, response_msg);
+    }
 
     switch (handle_status_code) {
       case MsgHandler::ReturnCode::kRebootRequired: {
@@ -193,3 +307,13 @@ bool sendResponseMessage(int socket_fd, const Asn1Message::Ptr &resp_msg) {
 
   return true;
 }
+
+bool skipPayload(const MsgHandler::PayloadReader &payload) {
+  std::array<uint8_t, 4096> scratch{};
+  for (;;) {
+    const ssize_t read_bytes = payload(scratch.data(), scratch.size());
+    if (read_bytes <= 0) {
+      return read_bytes == 0;
+    }
+  }
+}
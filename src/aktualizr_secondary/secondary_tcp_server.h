@@ -3,7 +3,9 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <list>
 #include <mutex>
+#include <thread>
 
 #include "utilities/utils.h"
 
@@ -11,7 +13,9 @@ class MsgHandler;
 
 /**
  * Listens on a socket, decodes calls (ASN.1) and forwards them to an Uptane Secondary
- * implementation
+ * implementation. Each connection is served by its own thread, so that e.g. a
+ * health check can be answered while the Primary's session is busy with an
+ * installation. Connections beyond kMaxConnections are closed right away.
  */
 class SecondaryTcpServer {
  public:
@@ -21,9 +25,12 @@ class SecondaryTcpServer {
     kUnkown,
   };
 
+  // Each connection costs a thread and a receive buffer of up to 16 MiB
+  static constexpr size_t kMaxConnections = 4;
+
   SecondaryTcpServer(MsgHandler& msg_handler, const std::string& primary_ip, in_port_t primary_port, in_port_t port = 0,
                      bool reboot_after_install = false);
-  ~SecondaryTcpServer() = default;
+  ~SecondaryTcpServer();
   SecondaryTcpServer(const SecondaryTcpServer&) = delete;
   SecondaryTcpServer(SecondaryTcpServer&&) = delete;
   SecondaryTcpServer& operator=(const SecondaryTcpServer&) = delete;
@@ -41,13 +48,29 @@ class SecondaryTcpServer {
   ExitReason exit_reason() const;
 
  private:
+  struct Connection {
+    explicit Connection(int socket_in) : socket(socket_in) {}
+    int socket;  // -1 once closed
+    bool done{false};
+    std::thread thread;
+  };
+
   bool HandleOneConnection(int socket);
+  bool startConnection(int socket);
+  void wakeUp();
 
   MsgHandler& msg_handler_;
   ListenSocket listen_socket_;
   std::atomic<bool> keep_running_;
   bool reboot_after_install_;
-  ExitReason exit_reason_{ExitReason::kNotApplicable};
+  std::atomic<ExitReason> exit_reason_{ExitReason::kNotApplicable};
+  // eventfd that gets run() out of epoll_wait()
+  int wakeup_fd_;
+
+  // The Primary keeps its connections open between requests, so stop() has to
+  // shut them down to get their threads out of HandleOneConnection().
+  std::mutex connections_mutex_;
+  std::list<Connection> connections_;
 
   bool is_running_;
   std::mutex running_condition_mutex_;
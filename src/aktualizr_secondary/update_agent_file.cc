@@ -1,7 +1,10 @@
 #include "update_agent_file.h"
 
+#include <unistd.h>
+
 #include <boost/filesystem.hpp>
 
+#include <array>
 #include <fstream>
 #include "crypto/crypto.h"
 #include "logging/logging.h"
@@ -12,12 +15,13 @@
 bool FileUpdateAgent::isTargetSupported(const Uptane::Target& target) const { return target.type() != "OSTREE"; }
 
 bool FileUpdateAgent::getInstalledImageInfo(Uptane::InstalledImageInfo& installed_image_info) const {
-  if (boost::filesystem::exists(target_filepath_)) {
-    auto file_content = Utils::readFile(target_filepath_);
-
+  uint64_t len = 0;
+  std::string hash;
+  if (installed_image_info_.get(&len, &hash)) {
+    std::lock_guard<std::mutex> lock(current_target_mutex_);
     installed_image_info.name = current_target_name_;
-    installed_image_info.len = file_content.size();
-    installed_image_info.hash = Uptane::ManifestIssuer::generateVersionHashStr(file_content);
+    installed_image_info.len = len;
+    installed_image_info.hash = hash;
   } else {
     // mimic the Primary's fake package manager behavior
     auto unknown_target = Uptane::Target::Unknown();
@@ -30,6 +34,13 @@ bool FileUpdateAgent::getInstalledImageInfo(Uptane::InstalledImageInfo& installe
 }
 
 data::InstallationResult FileUpdateAgent::install(const Uptane::Target& target) {
+  if (!closeNewTarget()) {
+    LOG_ERROR << "Failed to store the new target image";
+    new_target_hasher_.reset();
+    return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
+                                    "Failed to store the new target image");
+  }
+
   if (!boost::filesystem::exists(new_target_filepath_)) {
     LOG_ERROR << "The target image has not been received";
     return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
@@ -68,8 +79,15 @@ data::InstallationResult FileUpdateAgent::install(const Uptane::Target& target)
                                     "The target image has not been installed");
   }
 
-  current_target_name_ = target.filename();
+  {
+    std::lock_guard<std::mutex> lock(current_target_mutex_);
+    current_target_name_ = target.filename();
+  }
   new_target_hasher_.reset();
+  // The image has been verified, so the manifest can use its hash from the metadata
+  if (!target.sha256Hash().empty()) {
+    installed_image_info_.set(target.sha256Hash());
+  }
   return data::InstallationResult(data::ResultCode::Numeric::kOk, "");
 }
 
@@ -82,64 +100,111 @@ data::InstallationResult FileUpdateAgent::applyPendingInstall(const Uptane::Targ
 }
 
 data::InstallationResult FileUpdateAgent::receiveData(const Uptane::Target& target, const uint8_t* data, size_t size) {
-  std::ofstream target_file(new_target_filepath_.c_str(),
-                            std::ofstream::out | std::ofstream::binary | std::ofstream::app);
-
-  if (!target_file.good()) {
-    LOG_ERROR << "Failed to open a new target image file";
-    return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
-                                    "Failed to open a new target image file");
+  if (!new_target_file_) {
+    auto open_result = openNewTarget(target);
+    if (!open_result.isSuccess()) {
+      return open_result;
+    }
   }
 
-  auto current_new_image_size = target_file.tellp();
-  if (-1 == current_new_image_size) {
-    LOG_ERROR << "Failed to obtain a size of the new target image that is being uploaded";
-    target_file.close();
-    return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
-                                    "Failed to obtain a size of the new target image that is being uploaded");
-  }
-
-  if (static_cast<uint64_t>(current_new_image_size) >= target.length()) {
-    LOG_ERROR << "The size of the received image data exceeds the expected Target image size: "
-              << current_new_image_size << " != " << target.length();
-    target_file.close();
+  if (new_target_size_ >= target.length()) {
+    LOG_ERROR << "The size of the received image data exceeds the expected Target image size: " << new_target_size_
+              << " != " << target.length();
     return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
                                     "The size of the received image data exceeds the expected Target image size: " +
-                                        std::to_string(current_new_image_size) +
-                                        " != " + std::to_string(target.length()));
-  }
-
-  if (current_new_image_size == 0) {
-    new_target_hasher_ = MultiPartHasher::create(getTargetHash(target).type());
+                                        std::to_string(new_target_size_) + " != " + std::to_string(target.length()));
   }
 
-  target_file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
-  auto written_data_size = target_file.tellp() - current_new_image_size;
-
-  if (written_data_size < 0 || static_cast<size_t>(written_data_size) != size) {
+  const size_t written_data_size = fwrite(data, 1, size, new_target_file_.get());
+  if (written_data_size != size) {
     LOG_ERROR << "The size of data written is not equal to the received data size: " << written_data_size
               << " != " << size;
-    target_file.close();
+    // Start again from whatever made it to the disk
+    closeNewTarget();
+    new_target_hasher_.reset();
     return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
                                     "The size of data written is not equal to the received data size: " +
                                         std::to_string(written_data_size) + " != " + std::to_string(size));
   }
+  new_target_size_ += size;
+  new_target_hasher_->update(data, size);
 
-  target_file.close();
-
-  auto total_size = current_new_image_size + written_data_size;
   LOG_DEBUG << "Received and stored data of a new target image."
                " Received in this request (bytes): "
-            << size << "; total received so far: " << total_size << "; expected total: " << target.length();
-  if (static_cast<uint64_t>(total_size) == target.length()) {
-    LOG_INFO << "Successfully received and stored new target image of " << total_size << " bytes.";
+            << size << "; total received so far: " << new_target_size_ << "; expected total: " << target.length();
+  if (new_target_size_ == target.length()) {
+    if (!closeNewTarget()) {
+      LOG_ERROR << "Failed to store the new target image";
+      new_target_hasher_.reset();
+      return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
+                                      "Failed to store the new target image");
+    }
+    LOG_INFO << "Successfully received and stored new target image of " << new_target_size_ << " bytes.";
   }
 
-  new_target_hasher_->update(data, size);
+  return data::InstallationResult(data::ResultCode::Numeric::kOk, "");
+}
+
+data::InstallationResult FileUpdateAgent::openNewTarget(const Uptane::Target& target) {
+  new_target_file_.reset(fopen(new_target_filepath_.c_str(), "abe"));
+  if (!new_target_file_ || fseeko(new_target_file_.get(), 0, SEEK_END) != 0) {
+    LOG_ERROR << "Failed to open a new target image file";
+    new_target_file_.reset();
+    return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
+                                    "Failed to open a new target image file");
+  }
+
+  const off_t current_new_image_size = ftello(new_target_file_.get());
+  if (current_new_image_size < 0) {
+    LOG_ERROR << "Failed to obtain a size of the new target image that is being uploaded";
+    new_target_file_.reset();
+    return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
+                                    "Failed to obtain a size of the new target image that is being uploaded");
+  }
+  new_target_size_ = static_cast<uint64_t>(current_new_image_size);
+
+  if (new_target_size_ == 0) {
+    new_target_hasher_ = MultiPartHasher::create(getTargetHash(target).type());
+  } else if (new_target_hasher_ == nullptr) {
+    // Resuming an upload started before a restart: hash what is already there
+    new_target_hasher_ = MultiPartHasher::create(getTargetHash(target).type());
+    std::ifstream received_file(new_target_filepath_.c_str(), std::ifstream::in | std::ifstream::binary);
+    std::array<char, 4096> buf{};
+    while (received_file.read(buf.data(), buf.size()) || received_file.gcount() > 0) {
+      new_target_hasher_->update(reinterpret_cast<const unsigned char*>(buf.data()),
+                                 static_cast<uint64_t>(received_file.gcount()));
+    }
+  }
 
   return data::InstallationResult(data::ResultCode::Numeric::kOk, "");
 }
 
+bool FileUpdateAgent::closeNewTarget() {
+  if (!new_target_file_) {
+    return true;
+  }
+  // Only sync once the whole image is there rather than after every chunk
+  bool stored = fflush(new_target_file_.get()) == 0 && fsync(fileno(new_target_file_.get())) == 0;
+  stored = fclose(new_target_file_.release()) == 0 && stored;
+  return stored;
+}
+
+uint64_t FileUpdateAgent::receivedDataSize() const {
+  // Part of the data may still be buffered
+  if (new_target_file_) {
+    return new_target_size_;
+  }
+  boost::system::error_code ec;
+  const auto size = boost::filesystem::file_size(new_target_filepath_, ec);
+  return ec ? 0 : size;
+}
+
+void FileUpdateAgent::resetReceivedData() {
+  new_target_file_.reset();
+  boost::filesystem::remove(new_target_filepath_);
+  new_target_hasher_.reset();
+}
+
 Hash FileUpdateAgent::getTargetHash(const Uptane::Target& target) {
   // TODO(OTA-4831): check target.hashes() size.
   return target.hashes()[0];
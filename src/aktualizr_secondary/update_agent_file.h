@@ -1,19 +1,29 @@
 #ifndef AKTUALIZR_SECONDARY_UPDATE_AGENT_FILE_H
 #define AKTUALIZR_SECONDARY_UPDATE_AGENT_FILE_H
 
+#include <cstdio>
+#include <mutex>
+
 #include "update_agent.h"
+#include "uptane/manifest.h"
+#include "utilities/utils.h"
 
 class FileUpdateAgent : public UpdateAgent {
  public:
   FileUpdateAgent(boost::filesystem::path target_filepath, std::string target_name)
       : target_filepath_{std::move(target_filepath)},
         new_target_filepath_{target_filepath_.string() + ".newtarget"},
-        current_target_name_{std::move(target_name)} {}
+        current_target_name_{std::move(target_name)},
+        installed_image_info_{target_filepath_} {}
 
   bool isTargetSupported(const Uptane::Target& target) const override;
   bool getInstalledImageInfo(Uptane::InstalledImageInfo& installed_image_info) const override;
 
   virtual data::InstallationResult receiveData(const Uptane::Target& target, const uint8_t* data, size_t size);
+  // Number of bytes of the new image received so far
+  uint64_t receivedDataSize() const;
+  // Drop a partially received image, to start the upload over
+  void resetReceivedData();
   data::InstallationResult install(const Uptane::Target& target) override;
 
   void completeInstall() override;
@@ -21,11 +31,20 @@ class FileUpdateAgent : public UpdateAgent {
 
  private:
   static Hash getTargetHash(const Uptane::Target& target);
+  data::InstallationResult openNewTarget(const Uptane::Target& target);
+  // Flush the new image to disk and close it; true on success
+  bool closeNewTarget();
 
   const boost::filesystem::path target_filepath_;
   const boost::filesystem::path new_target_filepath_;
+  // Manifests can be requested while an image is being installed
+  mutable std::mutex current_target_mutex_;
   std::string current_target_name_;
+  Uptane::ImageFileInfoCache installed_image_info_;
   std::shared_ptr<MultiPartHasher> new_target_hasher_;
+  // Kept open while an image is being received, and its size so far
+  StructGuardInt<FILE> new_target_file_{nullptr, fclose};
+  uint64_t new_target_size_{0};
 };
 
 #endif  // AKTUALIZR_SECONDARY_UPDATE_AGENT_FILE_H
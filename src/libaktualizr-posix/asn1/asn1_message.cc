@@ -3,6 +3,8 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 
+#include <algorithm>
+
 #include "asn1_message.h"
 #include "logging/logging.h"
 #include "utilities/dequeue_buffer.h"
@@ -52,8 +54,8 @@ void SetString(OCTET_STRING_t* dest, const std::string& str) {
   OCTET_STRING_fromBuf(dest, str.c_str(), static_cast<int>(str.size()));
 }
 
-Asn1Message::Ptr Asn1Rpc(const Asn1Message::Ptr& tx, int con_fd) {
-  der_encode(&asn_DEF_AKIpUptaneMes, &tx->msg_, Asn1SocketWriteCallback, &con_fd);
+bool Asn1Send(const Asn1Message::Ptr& tx, int con_fd) {
+  asn_enc_rval_t res = der_encode(&asn_DEF_AKIpUptaneMes, &tx->msg_, Asn1SocketWriteCallback, &con_fd);
 
   // Bounce TCP_NODELAY to flush the TCP send buffer
   int no_delay = 1;
@@ -61,34 +63,135 @@ Asn1Message::Ptr Asn1Rpc(const Asn1Message::Ptr& tx, int con_fd) {
   no_delay = 0;
   setsockopt(con_fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(int));
 
+  return res.encoded != -1;
+}
+
+/**
+ * Length of the BER encoding that starts at `data`, worked out from its tag
+ * and length octets. Returns 0 if more bytes are needed to tell, and -1 if
+ * the length is indefinite or implausibly large.
+ */
+static int64_t BerEncodedLength(const uint8_t* data, size_t size) {
+  size_t pos = 0;
+  auto next = [data, size, &pos](uint8_t* octet) {
+    if (pos == size) {
+      return false;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    *octet = data[pos++];
+    return true;
+  };
+
+  uint8_t octet;
+  if (!next(&octet)) {
+    return 0;
+  }
+  if ((octet & 0x1FU) == 0x1FU) {
+    // High tag number form: more octets follow while bit 8 is set
+    do {
+      if (!next(&octet)) {
+        return 0;
+      }
+    } while ((octet & 0x80U) != 0);
+  }
+  if (!next(&octet)) {
+    return 0;
+  }
+  if ((octet & 0x80U) == 0) {
+    return static_cast<int64_t>(pos + octet);
+  }
+  const size_t octets = octet & 0x7FU;
+  if (octets == 0 || octets > 4) {
+    return -1;
+  }
+  uint64_t length = 0;
+  for (size_t i = 0; i < octets; ++i) {
+    if (!next(&octet)) {
+      return 0;
+    }
+    length = (length << 8U) | octet;
+  }
+  return static_cast<int64_t>(pos + length);
+}
+
+/**
+ * recv() into the free space of `buffer`. Returns false if the connection was
+ * closed or failed.
+ */
+static bool Asn1ReceiveMore(int con_fd, DequeueBuffer& buffer) {
+  if (!buffer.Reserve(1)) {
+    LOG_ERROR << "Message does not fit into " << buffer.MaxSize() << " bytes";
+    return false;
+  }
+  char* tail = buffer.Tail();
+  ssize_t received = recv(con_fd, tail, buffer.TailSpace(), 0);
+  if (received < 0) {
+    LOG_ERROR << "Failed to read data from a connection socket: " << strerror(errno);
+    return false;
+  }
+  if (received == 0) {
+    if (buffer.Size() == 0) {
+      LOG_TRACE << "Connection closed by the peer";
+    } else {
+      LOG_ERROR << "Connection closed in the middle of a message";
+    }
+    return false;
+  }
+  LOG_TRACE << "Asn1Rpc read " << Utils::toBase64(std::string(tail, static_cast<size_t>(received)));
+  buffer.HaveEnqueued(static_cast<size_t>(received));
+  return true;
+}
+
+Asn1Message::Ptr Asn1Receive(int con_fd, DequeueBuffer& buffer) {
   AKIpUptaneMes_t* m = nullptr;
-  asn_dec_rval_t res;
+  asn_dec_rval_t res{RC_WMORE, 0};
   asn_codec_ctx_s context{};
-  DequeueBuffer buffer;
-  ssize_t received;
-  do {
-    res.code = RC_FAIL;
-    received = recv(con_fd, buffer.Tail(), buffer.TailSpace(), 0);
-    if (received < 0) {
-      LOG_ERROR << "Failed to read data from a connection socket: " << strerror(errno);
-      break;
+  // A previous recv() may already have returned (part of) this message.
+  // Wait for the tag and length to learn how big the message is.
+  int64_t length;
+  bool connected = true;
+  while ((length = BerEncodedLength(reinterpret_cast<const uint8_t*>(buffer.Head()), buffer.Size())) == 0 &&
+         (connected = Asn1ReceiveMore(con_fd, buffer))) {
+  }
+  const auto message_size = static_cast<size_t>(std::max<int64_t>(length, 0));
+  const size_t missing = message_size > buffer.Size() ? message_size - buffer.Size() : 0;
+
+  if (connected && length > 0 && buffer.Reserve(missing)) {
+    // The whole message fits: receive all of it, then decode it in one pass
+    while (buffer.Size() < message_size && (connected = Asn1ReceiveMore(con_fd, buffer))) {
+    }
+    if (connected) {
+      res = ber_decode(&context, &asn_DEF_AKIpUptaneMes, reinterpret_cast<void**>(&m), buffer.Head(), message_size);
+      buffer.Consume(res.consumed);
     }
-    LOG_TRACE << "Asn1Rpc read " << Utils::toBase64(std::string(buffer.Tail(), static_cast<size_t>(received)));
-    buffer.HaveEnqueued(static_cast<size_t>(received));
+  } else if (connected) {
+    // Indefinite length or too big for the buffer: decode as the bytes arrive
     res = ber_decode(&context, &asn_DEF_AKIpUptaneMes, reinterpret_cast<void**>(&m), buffer.Head(), buffer.Size());
     buffer.Consume(res.consumed);
-  } while (res.code == RC_WMORE && received > 0);
+    while (res.code == RC_WMORE && (connected = Asn1ReceiveMore(con_fd, buffer))) {
+      res = ber_decode(&context, &asn_DEF_AKIpUptaneMes, reinterpret_cast<void**>(&m), buffer.Head(), buffer.Size());
+      buffer.Consume(res.consumed);
+    }
+  }
   // Note that ber_decode allocates *m even on failure, so this must always be done
   Asn1Message::Ptr msg = Asn1Message::FromRaw(&m);
 
   if (res.code != RC_OK) {
-    LOG_DEBUG << "Asn1Rpc decoding failed";
+    if (connected) {
+      LOG_ERROR << "Failed to decode a received message";
+    }
     msg->present(AKIpUptaneMes_PR_NOTHING);
   }
 
   return msg;
 }
 
+Asn1Message::Ptr Asn1Rpc(const Asn1Message::Ptr& tx, int con_fd) {
+  Asn1Send(tx, con_fd);
+  DequeueBuffer buffer;
+  return Asn1Receive(con_fd, buffer);
+}
+
 Asn1Message::Ptr Asn1Rpc(const Asn1Message::Ptr& tx, const std::pair<std::string, uint16_t>& addr) {
   ConnectionSocket connection(addr.first, addr.second);
 
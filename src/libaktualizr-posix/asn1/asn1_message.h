@@ -6,6 +6,7 @@
 #include "AKTlsConfig.h"
 
 class Asn1Message;
+class DequeueBuffer;
 
 template <typename T>
 class Asn1Sub {
@@ -99,6 +100,10 @@ class Asn1Message {
   ASN1_MESSAGE_DEFINE_ACCESSOR(AKPutRootReqMes_t, putRootReq);
   ASN1_MESSAGE_DEFINE_ACCESSOR(AKPutRootRespMes_t, putRootResp);
 
+  ASN1_MESSAGE_DEFINE_ACCESSOR(AKUploadDataReq2Mes_t, uploadDataReq2);
+  ASN1_MESSAGE_DEFINE_ACCESSOR(AKUploadDataResp2Mes_t, uploadDataResp2);
+  ASN1_MESSAGE_DEFINE_ACCESSOR(AKUploadRawReqMes_t, uploadRawReq);
+
 #define ASN1_MESSAGE_DEFINE_STR_NAME(MessageID) \
   case MessageID:                               \
     return #MessageID;
@@ -132,6 +137,10 @@ class Asn1Message {
         ASN1_MESSAGE_DEFINE_STR_NAME(AKIpUptaneMes_PR_rootVerResp);
         ASN1_MESSAGE_DEFINE_STR_NAME(AKIpUptaneMes_PR_putRootReq);
         ASN1_MESSAGE_DEFINE_STR_NAME(AKIpUptaneMes_PR_putRootResp);
+
+        ASN1_MESSAGE_DEFINE_STR_NAME(AKIpUptaneMes_PR_uploadDataReq2);
+        ASN1_MESSAGE_DEFINE_STR_NAME(AKIpUptaneMes_PR_uploadDataResp2);
+        ASN1_MESSAGE_DEFINE_STR_NAME(AKIpUptaneMes_PR_uploadRawReq);
     }
     return "Unknown";
   };
@@ -176,6 +185,22 @@ std::string ToString(const OCTET_STRING_t& octet_str);
 
 void SetString(OCTET_STRING_t* dest, const std::string& str);
 
+/**
+ * Send a message over a connected socket. Returns false if it could not be
+ * written completely.
+ */
+bool Asn1Send(const Asn1Message::Ptr& tx, int con_fd);
+
+/**
+ * Read one message from a connected socket. Bytes received past the end of
+ * the message are left in `buffer` for the next call, so that several
+ * requests can be outstanding on the same connection.
+ * Messages of known length that fit into the buffer are received completely
+ * and then decoded in one pass; others are decoded as they arrive.
+ * The message is empty (AKIpUptaneMes_PR_NOTHING) on failure.
+ */
+Asn1Message::Ptr Asn1Receive(int con_fd, DequeueBuffer& buffer);
+
 /**
  * Open a TCP connection to client; send a message and wait for a
  * response.
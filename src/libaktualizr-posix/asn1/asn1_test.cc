@@ -4,6 +4,11 @@
 
 #include <gtest/gtest.h>
 
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <string>
 
@@ -12,6 +17,7 @@
 #include "asn1-cerstream.h"
 #include "asn1_message.h"
 #include "der_encoder.h"
+#include "utilities/dequeue_buffer.h"
 #include "utilities/utils.h"
 
 asn1::Serializer& operator<<(asn1::Serializer& ser, CryptoSource cs) {
@@ -269,6 +275,64 @@ TEST(asn1_common, Asn1MessageFromRawNull) {
   Asn1Message::FromRaw(&m);
 }
 
+static Asn1Message::Ptr GetInfoResp(const std::string& serial, const std::string& key) {
+  Asn1Message::Ptr msg(Asn1Message::Empty());
+  msg->present(AKIpUptaneMes_PR_getInfoResp);
+  Asn1Message::SubPtr<AKGetInfoRespMes> resp = msg->getInfoResp();
+  SetString(&resp->ecuSerial, serial);
+  SetString(&resp->hwId, "hd-id-001");
+  SetString(&resp->key, key);
+  return msg;
+}
+
+/* A message larger than the initial receive buffer arrives in several recv()
+ * calls and is decoded in one piece. */
+TEST(asn1_common, Asn1ReceiveLarge) {
+  std::array<int, 2> fds{};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()), 0);
+  const std::string key(4 * DequeueBuffer::kInitialSize, 'k');
+  std::string encoded;
+  der_encode(&asn_DEF_AKIpUptaneMes, &GetInfoResp("serial1234", key)->msg_, Asn1StringAppendCallback, &encoded);
+  ASSERT_GT(encoded.size(), DequeueBuffer::kInitialSize);
+
+  // Send it in small pieces, so that the receiver sees it grow
+  for (size_t pos = 0; pos < encoded.size(); pos += 1000) {
+    const size_t len = std::min<size_t>(1000, encoded.size() - pos);
+    ASSERT_EQ(send(fds[0], encoded.data() + pos, len, 0), static_cast<ssize_t>(len));
+  }
+
+  DequeueBuffer buffer;
+  Asn1Message::Ptr msg = Asn1Receive(fds[1], buffer);
+  ASSERT_EQ(msg->present(), AKIpUptaneMes_PR_getInfoResp);
+  EXPECT_EQ(ToString(msg->getInfoResp()->ecuSerial), "serial1234");
+  EXPECT_EQ(ToString(msg->getInfoResp()->key), key);
+  EXPECT_EQ(buffer.Size(), 0);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+/* Several messages received in one recv() are returned one after the other. */
+TEST(asn1_common, Asn1ReceiveBackToBack) {
+  std::array<int, 2> fds{};
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()), 0);
+  std::string encoded;
+  for (const auto& serial : {"first", "second", "third"}) {
+    der_encode(&asn_DEF_AKIpUptaneMes, &GetInfoResp(serial, "key")->msg_, Asn1StringAppendCallback, &encoded);
+  }
+  ASSERT_EQ(send(fds[0], encoded.data(), encoded.size(), 0), static_cast<ssize_t>(encoded.size()));
+  close(fds[0]);
+
+  DequeueBuffer buffer;
+  for (const auto& serial : {"first", "second", "third"}) {
+    Asn1Message::Ptr msg = Asn1Receive(fds[1], buffer);
+    ASSERT_EQ(msg->present(), AKIpUptaneMes_PR_getInfoResp);
+    EXPECT_EQ(ToString(msg->getInfoResp()->ecuSerial), serial);
+  }
+  // The peer has gone after the last message
+  EXPECT_EQ(Asn1Receive(fds[1], buffer)->present(), AKIpUptaneMes_PR_NOTHING);
+  close(fds[1]);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -2,21 +2,36 @@
 
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
 
+#include <algorithm>
 #include <array>
+#include <csignal>
+#include <cstdio>
 #include <fstream>
+#include <limits>
 #include <memory>
+#include <vector>
 
 #include "asn1/asn1_message.h"
+#include "crypto/crypto.h"
 #include "der_encoder.h"
 #include "libaktualizr/secondary_provider.h"
 #include "logging/logging.h"
 #include "uptane/tuf.h"
+#include "utilities/dequeue_buffer.h"
 #include "utilities/flow_control.h"
 #include "utilities/utils.h"
 
 namespace Uptane {
 
+// Streaming upload (protocol v3)
+static constexpr size_t kUploadChunkSize = 256 * 1024;
+static constexpr size_t kUploadWindow = 4;
+static constexpr int kUploadMaxRetries = 3;
+
 SecondaryInterface::Ptr IpUptaneSecondary::connectAndCreate(const std::string& address, unsigned short port,
                                                             VerificationType verification_type) {
   LOG_INFO << "Connecting to and getting info about IP Secondary: " << address << ":" << port << "...";
@@ -108,6 +123,56 @@ IpUptaneSecondary::IpUptaneSecondary(const std::string& address, unsigned short
       hw_id_{std::move(hw_id)},
       pub_key_{std::move(pub_key)} {}
 
+IpUptaneSecondary::~IpUptaneSecondary() = default;
+
+// Check that the peer has not closed an idle connection, e.g. because the
+// Secondary has been restarted since the last request.
+static bool isSessionOpen(int con_fd) {
+  char c;
+  const ssize_t received = recv(con_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (received >= 0) {
+    // Either closed, or unexpected data that would be taken as the next response
+    return false;
+  }
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+int IpUptaneSecondary::sessionSocket() const {
+  if (session_ != nullptr && !isSessionOpen(**session_)) {
+    LOG_DEBUG << "Connection to Secondary " << getSerial() << " was closed, reconnecting";
+    session_.reset();
+  }
+
+  if (session_ == nullptr) {
+    auto connection = std_::make_unique<ConnectionSocket>(addr_.first, addr_.second);
+    if (connection->connect() < 0) {
+      LOG_ERROR << "Failed to connect to the Secondary ( " << addr_.first << ":" << addr_.second
+                << "): " << std::strerror(errno);
+      return -1;
+    }
+    session_ = std::move(connection);
+    // The Secondary may have been restarted or replaced in the meantime
+    sent_meta_hashes_.clear();
+  }
+  return **session_;
+}
+
+Asn1Message::Ptr IpUptaneSecondary::sessionRpc(const Asn1Message::Ptr& req) const {
+  std::lock_guard<std::mutex> lock(session_mutex_);
+
+  const int con_fd = sessionSocket();
+  if (con_fd < 0) {
+    return Asn1Message::Empty();
+  }
+
+  auto resp = Asn1Rpc(req, con_fd);
+  if (resp->present() == AKIpUptaneMes_PR_NOTHING) {
+    // The connection is broken or out of sync, start a new one for the next request
+    session_.reset();
+  }
+  return resp;
+}
+
 /* Determine the best protocol version to use for this Secondary. This did not
  * exist for v1 and thus only works for v2 and beyond. It would be great if we
  * could just do this once, but we do not have a simple way to do that,
@@ -115,12 +180,12 @@ IpUptaneSecondary::IpUptaneSecondary(const std::string& address, unsigned short
  * installation. */
 void IpUptaneSecondary::getSecondaryVersion() const {
   LOG_DEBUG << "Negotiating the protocol version with Secondary " << getSerial();
-  const uint32_t latest_version = 2;
+  const uint32_t latest_version = 5;
   Asn1Message::Ptr req(Asn1Message::Empty());
   req->present(AKIpUptaneMes_PR_versionReq);
   auto m = req->versionReq();
   m->version = latest_version;
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   if (resp->present() != AKIpUptaneMes_PR_versionResp) {
     // Bad response probably means v1, but make sure the Secondary is actually
@@ -164,7 +229,9 @@ data::InstallationResult IpUptaneSecondary::putMetadata(const Target& target) {
 
   LOG_INFO << "Sending Uptane metadata to the Secondary";
   data::InstallationResult put_result;
-  if (protocol_version == 2) {
+  if (protocol_version >= 5) {
+    put_result = putMetadata_v5(meta_bundle);
+  } else if (protocol_version >= 2) {
     put_result = putMetadata_v2(meta_bundle);
   } else if (protocol_version == 1) {
     put_result = putMetadata_v1(meta_bundle);
@@ -207,7 +274,7 @@ data::InstallationResult IpUptaneSecondary::putMetadata_v1(const Uptane::MetaBun
   SetString(&m->image.choice.json.targets,
             getMetaFromBundle(meta_bundle, Uptane::RepositoryType::Image(), Uptane::Role::Targets()));
 
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   if (resp->present() != AKIpUptaneMes_PR_putMetaResp) {
     LOG_ERROR << "Secondary " << getSerial() << " failed to respond to a request to receive metadata.";
@@ -227,6 +294,10 @@ data::InstallationResult IpUptaneSecondary::putMetadata_v1(const Uptane::MetaBun
 
 void IpUptaneSecondary::addMetadata(const Uptane::MetaBundle& meta_bundle, const Uptane::RepositoryType repo,
                                     const Uptane::Role& role, AKMetaCollection_t& collection) {
+  if (meta_bundle.count(std::make_pair(repo, role)) == 0) {
+    // Left out on purpose, see putMetadata_v5()
+    return;
+  }
   auto* meta_json = Asn1Allocation<AKMetaJson_t>();
   SetString(&meta_json->role, role.ToString());
   SetString(&meta_json->json, getMetaFromBundle(meta_bundle, repo, role));
@@ -256,7 +327,7 @@ data::InstallationResult IpUptaneSecondary::putMetadata_v2(const Uptane::MetaBun
   // NOLINTNEXTLINE(cppcoreguidelines-pro-type-union-access)
   addMetadata(meta_bundle, Uptane::RepositoryType::Image(), Uptane::Role::Targets(), m->imageRepo.choice.collection);
 
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   if (resp->present() != AKIpUptaneMes_PR_putMetaResp2) {
     LOG_ERROR << "Secondary " << getSerial() << " failed to respond to a request to receive metadata.";
@@ -269,6 +340,43 @@ data::InstallationResult IpUptaneSecondary::putMetadata_v2(const Uptane::MetaBun
   return data::InstallationResult(static_cast<data::ResultCode::Numeric>(r->result), ToString(r->description));
 }
 
+/* Protocol v5: the Secondary uses its stored copy of any role missing from the
+ * request. Leave out the roles that have not changed since the Secondary last
+ * accepted them, which typically includes the large Image repo Targets. */
+data::InstallationResult IpUptaneSecondary::putMetadata_v5(const Uptane::MetaBundle& meta_bundle) {
+  Uptane::MetaBundle hashes;
+  Uptane::MetaBundle changed;
+  {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    for (const auto& meta : meta_bundle) {
+      auto hash = Crypto::sha256digestHex(meta.second);
+      auto sent = sent_meta_hashes_.find(meta.first);
+      if (sent == sent_meta_hashes_.end() || sent->second != hash) {
+        changed.emplace(meta);
+      }
+      hashes.emplace(meta.first, std::move(hash));
+    }
+  }
+
+  LOG_DEBUG << "Sending " << changed.size() << " of " << meta_bundle.size() << " metadata files to Secondary "
+            << getSerial();
+  auto result = putMetadata_v2(changed);
+  if (!result.isSuccess() && changed.size() < meta_bundle.size()) {
+    // The Secondary may not have the metadata we expect it to have
+    LOG_INFO << "Sending all metadata to Secondary " << getSerial() << " after it failed to verify the changed files: "
+             << result.description;
+    result = putMetadata_v2(meta_bundle);
+  }
+
+  std::lock_guard<std::mutex> lock(session_mutex_);
+  if (result.isSuccess()) {
+    sent_meta_hashes_ = std::move(hashes);
+  } else {
+    sent_meta_hashes_.clear();
+  }
+  return result;
+}
+
 int32_t IpUptaneSecondary::getRootVersion(bool director) const {
   if (director && verification_type_ == VerificationType::kTuf) {
     return 0;
@@ -283,7 +391,7 @@ int32_t IpUptaneSecondary::getRootVersion(bool director) const {
     m->repotype = AKRepoType_image;
   }
 
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
   if (resp->present() != AKIpUptaneMes_PR_rootVerResp) {
     // v1 (and v2 until this was added) Secondaries won't understand this.
     // Return 0 to indicate that this is unsupported. Sending intermediate Roots
@@ -313,7 +421,12 @@ data::InstallationResult IpUptaneSecondary::putRoot(const std::string& root, boo
   }
   SetString(&m->json, root);
 
-  auto resp = Asn1Rpc(req, getAddr());
+  {
+    // A new Root makes the Secondary drop the other metadata of the repository
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    sent_meta_hashes_.clear();
+  }
+  auto resp = sessionRpc(req);
   if (resp->present() != AKIpUptaneMes_PR_putRootResp) {
     LOG_ERROR << "Secondary " << getSerial() << " failed to respond to a request to receive Root metadata.";
     return data::InstallationResult(
@@ -332,7 +445,7 @@ Manifest IpUptaneSecondary::getManifest() const {
   Asn1Message::Ptr req(Asn1Message::Empty());
 
   req->present(AKIpUptaneMes_PR_manifestReq);
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   if (resp->present() != AKIpUptaneMes_PR_manifestResp) {
     LOG_ERROR << "Secondary " << getSerial() << " failed to respond to a manifest request.";
@@ -354,7 +467,7 @@ bool IpUptaneSecondary::ping() const {
 
   auto m = req->getInfoReq();
 
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   return resp->present() == AKIpUptaneMes_PR_getInfoResp;
 }
@@ -367,7 +480,7 @@ data::InstallationResult IpUptaneSecondary::sendFirmware(const Uptane::Target& t
     return data::InstallationResult(data::ResultCode::Numeric::kOperationCancelled, "");
   }
 
-  if (protocol_version == 2) {
+  if (protocol_version >= 2) {
     return sendFirmware_v2(target);
   }
   if (protocol_version == 1) {
@@ -397,7 +510,7 @@ data::InstallationResult IpUptaneSecondary::sendFirmware_v1(const Uptane::Target
 
   auto m = req->sendFirmwareReq();
   SetString(&m->firmware, data_to_send);
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   if (resp->present() != AKIpUptaneMes_PR_sendFirmwareResp) {
     LOG_ERROR << "Secondary " << getSerial() << " failed to respond to a request to receive firmware.";
@@ -431,7 +544,7 @@ data::InstallationResult IpUptaneSecondary::install(const Uptane::Target& target
   }
 
   data::InstallationResult install_result;
-  if (protocol_version == 2) {
+  if (protocol_version >= 2) {
     install_result = install_v2(target);
   } else if (protocol_version == 1) {
     install_result = install_v1(target);
@@ -454,7 +567,7 @@ data::InstallationResult IpUptaneSecondary::install_v1(const Uptane::Target& tar
   auto req_mes = req->installReq();
   SetString(&req_mes->hash, target.filename());
   // send request and receive response, a request-response type of RPC
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   // invalid type of an response message
   if (resp->present() != AKIpUptaneMes_PR_installResp) {
@@ -483,7 +596,7 @@ data::InstallationResult IpUptaneSecondary::downloadOstreeRev(const Uptane::Targ
 
   auto m = req->downloadOstreeRevReq();
   SetString(&m->tlsCred, tls_creds);
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   if (resp->present() != AKIpUptaneMes_PR_downloadOstreeRevResp) {
     LOG_ERROR << "Secondary " << getSerial() << " failed to respond to a request to download an OSTree commit.";
@@ -497,6 +610,11 @@ data::InstallationResult IpUptaneSecondary::downloadOstreeRev(const Uptane::Targ
 }
 
 data::InstallationResult IpUptaneSecondary::uploadFirmware(const Uptane::Target& target) {
+  // Offsets are ASN.1 INTEGERs, i.e. native longs
+  if (protocol_version >= 3 && target.length() <= static_cast<uint64_t>(std::numeric_limits<long>::max())) {
+    return uploadFirmwareStream(target);
+  }
+
   LOG_INFO << "Uploading the target image (" << target.filename() << ") "
            << "to the Secondary (" << getSerial() << ")";
 
@@ -526,13 +644,218 @@ data::InstallationResult IpUptaneSecondary::uploadFirmware(const Uptane::Target&
   return upload_result;
 }
 
+static Asn1Message::Ptr uploadDataRequest(uint64_t offset, const char* data, size_t size) {
+  Asn1Message::Ptr req(Asn1Message::Empty());
+  req->present(AKIpUptaneMes_PR_uploadDataReq2);
+
+  auto m = req->uploadDataReq2();
+  m->offset = static_cast<long>(offset);
+  OCTET_STRING_fromBuf(&m->data, data, static_cast<int>(size));
+  return req;
+}
+
+/* Unlike send(), sendfile() has no MSG_NOSIGNAL: block SIGPIPE in this thread
+ * while it runs and discard the signal raised if the Secondary has gone away. */
+class SigpipeBlocker {
+ public:
+  SigpipeBlocker() {
+    sigemptyset(&sigpipe_);
+    sigaddset(&sigpipe_, SIGPIPE);
+    sigset_t pending;
+    sigpending(&pending);
+    was_pending_ = sigismember(&pending, SIGPIPE) == 1;
+    blocked_ = pthread_sigmask(SIG_BLOCK, &sigpipe_, &old_mask_) == 0;
+  }
+  ~SigpipeBlocker() {
+    if (!blocked_) {
+      return;
+    }
+    if (!was_pending_) {
+      const timespec no_wait{};
+      sigtimedwait(&sigpipe_, nullptr, &no_wait);
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask_, nullptr);
+  }
+  SigpipeBlocker(const SigpipeBlocker&) = delete;
+  SigpipeBlocker(SigpipeBlocker&&) = delete;
+  SigpipeBlocker& operator=(const SigpipeBlocker&) = delete;
+  SigpipeBlocker& operator=(SigpipeBlocker&&) = delete;
+
+ private:
+  sigset_t sigpipe_{};
+  sigset_t old_mask_{};
+  bool was_pending_{false};
+  bool blocked_{false};
+};
+
+/* Protocol v4: send a header and let the kernel copy the data from the image
+ * file to the socket, without passing it through user space. */
+static bool uploadRawData(int con_fd, int file_fd, uint64_t offset, size_t size) {
+  Asn1Message::Ptr req(Asn1Message::Empty());
+  req->present(AKIpUptaneMes_PR_uploadRawReq);
+
+  auto m = req->uploadRawReq();
+  m->offset = static_cast<long>(offset);
+  m->length = static_cast<long>(size);
+  if (!Asn1Send(req, con_fd)) {
+    return false;
+  }
+
+  SigpipeBlocker sigpipe_blocker;
+  auto file_offset = static_cast<off_t>(offset);
+  while (size > 0) {
+    const ssize_t written = sendfile(con_fd, file_fd, &file_offset, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      LOG_ERROR << "Failed to send image data: " << (written == 0 ? "unexpected end of file" : std::strerror(errno));
+      return false;
+    }
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+/* Protocol v3: send the image in large chunks, with up to kUploadWindow of
+ * them in flight before waiting for the Secondary's acknowledgements. Each
+ * acknowledgement carries the number of bytes the Secondary has stored, so
+ * that the upload can be resumed from there if the connection breaks. From
+ * protocol v4 on, the chunks are raw payloads sent straight from the file. */
+data::InstallationResult IpUptaneSecondary::uploadFirmwareStream(const Uptane::Target& target) {
+  LOG_INFO << "Streaming the target image (" << target.filename() << ") "
+           << "to the Secondary (" << getSerial() << ")";
+
+  const uint64_t image_size = target.length();
+  // Send the data as raw payloads straight from the file if the Secondary supports it
+  StructGuardInt<FILE> image_file(nullptr, fclose);
+  if (protocol_version >= 4 && image_size <= static_cast<uint64_t>(std::numeric_limits<off_t>::max())) {
+    const std::string image_path = secondary_provider_->getTargetFilePath(target);
+    if (!image_path.empty()) {
+      image_file.reset(fopen(image_path.c_str(), "rbe"));
+    }
+  }
+  // Otherwise read the image into chunks
+  std::ifstream image_reader;
+  std::vector<char> chunk;
+  if (!image_file) {
+    image_reader = secondary_provider_->getTargetFileHandle(target);
+  }
+
+  std::lock_guard<std::mutex> lock(session_mutex_);
+  uint64_t acked = 0;
+  // Only trust the Secondary's byte count once it has acknowledged data of
+  // this upload; before that it may describe an earlier, aborted one.
+  bool resuming = false;
+  int failures = 0;
+  while (acked < image_size) {
+    if (failures > kUploadMaxRetries) {
+      return data::InstallationResult(
+          data::ResultCode::Numeric::kDownloadFailed,
+          "Secondary " + getSerial().ToString() + " failed to respond to a request to receive firmware data.");
+    }
+    if (failures > 0) {
+      LOG_WARNING << "Upload to Secondary " << getSerial() << " interrupted after " << acked << " bytes, resuming";
+    }
+
+    const int con_fd = sessionSocket();
+    if (con_fd < 0) {
+      ++failures;
+      continue;
+    }
+    DequeueBuffer buffer;
+
+    // Learn the chunk size and how much the Secondary already has
+    Asn1Send(uploadDataRequest(0, "", 0), con_fd);
+    auto resp = Asn1Receive(con_fd, buffer);
+    if (resp->present() != AKIpUptaneMes_PR_uploadDataResp2) {
+      session_.reset();
+      ++failures;
+      continue;
+    }
+    auto status = resp->uploadDataResp2();
+    if (status->result != AKInstallationResultCode_ok) {
+      return data::InstallationResult(static_cast<data::ResultCode::Numeric>(status->result),
+                                      ToString(status->description));
+    }
+    const auto chunk_size = static_cast<size_t>(
+        std::min<long>(static_cast<long>(kUploadChunkSize), std::max<long>(status->maxChunkSize, 1)));
+    // Sending data at offset 0 makes the Secondary start over
+    uint64_t sent = 0;
+    if (resuming) {
+      sent = std::min<uint64_t>(static_cast<uint64_t>(std::max<long>(status->received, 0)), image_size);
+    }
+    acked = sent;
+    if (!image_file) {
+      image_reader.clear();
+      image_reader.seekg(static_cast<std::streamoff>(sent));
+      chunk.resize(chunk_size);
+    }
+
+    size_t in_flight = 0;
+    bool broken = false;
+    while (acked < image_size) {
+      while (in_flight < kUploadWindow && sent < image_size) {
+        const auto size = static_cast<size_t>(std::min<uint64_t>(chunk_size, image_size - sent));
+        bool sent_ok;
+        if (image_file) {
+          sent_ok = uploadRawData(con_fd, fileno(image_file.get()), sent, size);
+        } else {
+          image_reader.read(chunk.data(), static_cast<std::streamsize>(size));
+          if (static_cast<size_t>(image_reader.gcount()) != size) {
+            session_.reset();
+            return data::InstallationResult(data::ResultCode::Numeric::kDownloadFailed,
+                                            "Failed to read target image");
+          }
+          sent_ok = Asn1Send(uploadDataRequest(sent, chunk.data(), size), con_fd);
+        }
+        if (!sent_ok) {
+          broken = true;
+          break;
+        }
+        sent += size;
+        ++in_flight;
+      }
+      // Nothing left to wait for although the Secondary is missing data
+      if (broken || in_flight == 0) {
+        broken = true;
+        break;
+      }
+
+      resp = Asn1Receive(con_fd, buffer);
+      if (resp->present() != AKIpUptaneMes_PR_uploadDataResp2) {
+        broken = true;
+        break;
+      }
+      --in_flight;
+      auto r = resp->uploadDataResp2();
+      if (r->result != AKInstallationResultCode_ok) {
+        // Replies to the chunks still in flight would be taken for the next responses
+        session_.reset();
+        return data::InstallationResult(static_cast<data::ResultCode::Numeric>(r->result), ToString(r->description));
+      }
+      acked = static_cast<uint64_t>(std::max<long>(r->received, 0));
+      resuming = true;
+      failures = 0;
+    }
+
+    if (broken || in_flight > 0) {
+      session_.reset();
+      ++failures;
+    }
+  }
+
+  image_reader.close();
+  return data::InstallationResult(data::ResultCode::Numeric::kOk, "");
+}
+
 data::InstallationResult IpUptaneSecondary::uploadFirmwareData(const uint8_t* data, size_t size) {
   Asn1Message::Ptr req(Asn1Message::Empty());
   req->present(AKIpUptaneMes_PR_uploadDataReq);
 
   auto m = req->uploadDataReq();
   OCTET_STRING_fromBuf(&m->data, reinterpret_cast<const char*>(data), static_cast<int>(size));
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   if (resp->present() == AKIpUptaneMes_PR_NOTHING) {
     LOG_ERROR << "Secondary " << getSerial() << " failed to respond to a request to receive firmware data.";
@@ -559,7 +882,7 @@ data::InstallationResult IpUptaneSecondary::invokeInstallOnSecondary(const Uptan
   auto req_mes = req->installReq();
   SetString(&req_mes->hash, target.filename());
   // send request and receive response, a request-response type of RPC
-  auto resp = Asn1Rpc(req, getAddr());
+  auto resp = sessionRpc(req);
 
   // invalid type of an response message
   if (resp->present() != AKIpUptaneMes_PR_installResp2) {
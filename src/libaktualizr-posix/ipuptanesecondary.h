@@ -1,11 +1,18 @@
 #ifndef UPTANE_IPUPTANESECONDARY_H_
 #define UPTANE_IPUPTANESECONDARY_H_
 
+#include <memory>
+#include <mutex>
+
+#include <boost/intrusive_ptr.hpp>
+
 #include "libaktualizr/secondaryinterface.h"
 #include "libaktualizr/types.h"
 
 struct AKMetaCollection;
 using AKMetaCollection_t = struct AKMetaCollection;
+class Asn1Message;
+class ConnectionSocket;
 
 namespace Uptane {
 
@@ -22,6 +29,11 @@ class IpUptaneSecondary : public SecondaryInterface {
 
   explicit IpUptaneSecondary(const std::string& address, unsigned short port, VerificationType verification_type,
                              EcuSerial serial, HardwareIdentifier hw_id, PublicKey pub_key);
+  ~IpUptaneSecondary() override;
+  IpUptaneSecondary(const IpUptaneSecondary&) = delete;
+  IpUptaneSecondary(IpUptaneSecondary&&) = delete;
+  IpUptaneSecondary& operator=(const IpUptaneSecondary&) = delete;
+  IpUptaneSecondary& operator=(IpUptaneSecondary&&) = delete;
 
   std::string Type() const override { return "IP"; }
   EcuSerial getSerial() const override { return serial_; };
@@ -42,9 +54,14 @@ class IpUptaneSecondary : public SecondaryInterface {
 
  private:
   const std::pair<std::string, uint16_t>& getAddr() const { return addr_; }
+  // Send a request over the session with the Secondary, (re)connecting if needed
+  boost::intrusive_ptr<Asn1Message> sessionRpc(const boost::intrusive_ptr<Asn1Message>& req) const;
+  // Socket of the session, or -1 if the Secondary is unreachable. session_mutex_ must be held.
+  int sessionSocket() const;
   void getSecondaryVersion() const;
   data::InstallationResult putMetadata_v1(const Uptane::MetaBundle& meta_bundle);
   data::InstallationResult putMetadata_v2(const Uptane::MetaBundle& meta_bundle);
+  data::InstallationResult putMetadata_v5(const Uptane::MetaBundle& meta_bundle);
   data::InstallationResult sendFirmware_v1(const Uptane::Target& target);
   data::InstallationResult sendFirmware_v2(const Uptane::Target& target);
   data::InstallationResult install_v1(const Uptane::Target& target);
@@ -54,6 +71,7 @@ class IpUptaneSecondary : public SecondaryInterface {
   data::InstallationResult invokeInstallOnSecondary(const Uptane::Target& target);
   data::InstallationResult downloadOstreeRev(const Uptane::Target& target);
   data::InstallationResult uploadFirmware(const Uptane::Target& target);
+  data::InstallationResult uploadFirmwareStream(const Uptane::Target& target);
   data::InstallationResult uploadFirmwareData(const uint8_t* data, size_t size);
 
   std::shared_ptr<SecondaryProvider> secondary_provider_;
@@ -63,6 +81,13 @@ class IpUptaneSecondary : public SecondaryInterface {
   const HardwareIdentifier hw_id_;
   const PublicKey pub_key_;
   mutable uint32_t protocol_version{0};
+  // One long-lived connection is used for all the requests to the Secondary
+  mutable std::mutex session_mutex_;
+  mutable std::unique_ptr<ConnectionSocket> session_;
+  // SHA-256 of the metadata the Secondary accepted in the last putMetadata().
+  // Protocol v5 leaves these out of the next request. Guarded by session_mutex_
+  // and cleared when the Secondary might have lost or replaced them.
+  mutable Uptane::MetaBundle sent_meta_hashes_;
 };
 
 }  // namespace Uptane
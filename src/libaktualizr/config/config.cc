@@ -94,6 +94,9 @@ void UptaneConfig::updateFromPropertyTree(const boost::property_tree::ptree& pt)
   CopyFromConfig(force_install_completion, "force_install_completion", pt);
   CopyFromConfig(secondary_config_file, "secondary_config_file", pt);
   CopyFromConfig(secondary_preinstall_wait_sec, "secondary_preinstall_wait_sec", pt);
+  CopyFromConfig(max_parallel_downloads, "max_parallel_downloads", pt);
+  CopyFromConfig(max_parallel_verifications, "max_parallel_verifications", pt);
+  CopyFromConfig(max_parallel_secondaries, "max_parallel_secondaries", pt);
 }
 
 void UptaneConfig::writeToStream(std::ostream& out_stream) const {
@@ -105,6 +108,9 @@ void UptaneConfig::writeToStream(std::ostream& out_stream) const {
   writeOption(out_stream, force_install_completion, "force_install_completion");
   writeOption(out_stream, secondary_config_file, "secondary_config_file");
   writeOption(out_stream, secondary_preinstall_wait_sec, "secondary_preinstall_wait_sec");
+  writeOption(out_stream, max_parallel_downloads, "max_parallel_downloads");
+  writeOption(out_stream, max_parallel_verifications, "max_parallel_verifications");
+  writeOption(out_stream, max_parallel_secondaries, "max_parallel_secondaries");
 }
 
 /**
@@ -23,7 +23,9 @@
 #endif
 
 PublicKey::PublicKey(const boost::filesystem::path &path)
-    : value_(Utils::readFile(path)), type_(Crypto::IdentifyRSAKeyType(value_)) {}
+    : value_(Utils::readFile(path)), type_(Crypto::IdentifyRSAKeyType(value_)) {
+  parse();
+}
 
 PublicKey::PublicKey(const Json::Value &uptane_json) {
   std::string keytype;
@@ -67,6 +69,7 @@ PublicKey::PublicKey(const Json::Value &uptane_json) {
   }
   type_ = type;
   value_ = keyvalue;
+  parse();
 }
 
 PublicKey::PublicKey(const std::string &value, KeyType type) : value_(value), type_(type) {
@@ -75,16 +78,47 @@ PublicKey::PublicKey(const std::string &value, KeyType type) : value_(value), ty
       throw std::logic_error("RSA key length is incorrect");
     }
   }
+  parse();
+}
+
+struct PublicKey::Parsed {
+  StructGuard<RSA> rsa{nullptr, RSA_free};
+  std::string ed25519;
+};
+
+void PublicKey::parse() {
+  auto parsed = std::make_shared<Parsed>();
+  switch (type_) {
+    case KeyType::kED25519:
+      try {
+        parsed->ed25519 = boost::algorithm::unhex(value_);
+      } catch (const std::exception &) {
+        // Leave the key empty, verification will fail
+        LOG_WARNING << "Invalid ED25519 public key";
+      }
+      break;
+    case KeyType::kRSA2048:
+    case KeyType::kRSA3072:
+    case KeyType::kRSA4096:
+      parsed->rsa = Crypto::parseRSAPublicKey(value_);
+      break;
+    default:
+      return;
+  }
+  parsed_ = parsed;
 }
 
 bool PublicKey::VerifySignature(const std::string &signature, const std::string &message) const {
   switch (type_) {
     case KeyType::kED25519:
-      return Crypto::ED25519Verify(boost::algorithm::unhex(value_), Utils::fromBase64(signature), message);
+      return Crypto::ED25519Verify(parsed_->ed25519, Utils::fromBase64(signature), message);
     case KeyType::kRSA2048:
     case KeyType::kRSA3072:
     case KeyType::kRSA4096:
-      return Crypto::RSAPSSVerify(value_, Utils::fromBase64(signature), message);
+      if (parsed_->rsa == nullptr) {
+        return false;
+      }
+      return Crypto::RSAPSSVerify(parsed_->rsa.get(), Utils::fromBase64(signature), message);
     default:
       return false;
   }
@@ -214,7 +248,7 @@ std::string Crypto::ED25519Sign(const std::string &private_key, const std::strin
   return std::string(reinterpret_cast<char *>(sig.data()), crypto_sign_BYTES);
 }
 
-bool Crypto::RSAPSSVerify(const std::string &public_key, const std::string &signature, const std::string &message) {
+StructGuard<RSA> Crypto::parseRSAPublicKey(const std::string &public_key) {
   StructGuard<RSA> rsa(nullptr, RSA_free);
   StructGuard<BIO> bio(BIO_new_mem_buf(const_cast<char *>(public_key.c_str()), static_cast<int>(public_key.size())),
                        BIO_vfree);
@@ -222,7 +256,7 @@ bool Crypto::RSAPSSVerify(const std::string &public_key, const std::string &sign
     RSA *r = nullptr;
     if (PEM_read_bio_RSA_PUBKEY(bio.get(), &r, nullptr, nullptr) == nullptr) {
       LOG_ERROR << "PEM_read_bio_RSA_PUBKEY failed with error " << ERR_error_string(ERR_get_error(), nullptr);
-      return false;
+      return rsa;
     }
     rsa.reset(r);
   }
@@ -232,15 +266,26 @@ bool Crypto::RSAPSSVerify(const std::string &public_key, const std::string &sign
 #else
   RSA_set_method(rsa.get(), RSA_PKCS1_OpenSSL());
 #endif
+  return rsa;
+}
+
+bool Crypto::RSAPSSVerify(const std::string &public_key, const std::string &signature, const std::string &message) {
+  StructGuard<RSA> rsa = parseRSAPublicKey(public_key);
+  if (rsa == nullptr) {
+    return false;
+  }
+  return RSAPSSVerify(rsa.get(), signature, message);
+}
 
-  const auto size = static_cast<unsigned int>(RSA_size(rsa.get()));
+bool Crypto::RSAPSSVerify(RSA *rsa, const std::string &signature, const std::string &message) {
+  const auto size = static_cast<unsigned int>(RSA_size(rsa));
   boost::scoped_array<unsigned char> pDecrypted(new unsigned char[size]);
   /* now we will verify the signature
     Start by a RAW decrypt of the signature
   */
   int status =
       RSA_public_decrypt(static_cast<int>(signature.size()), reinterpret_cast<const unsigned char *>(signature.c_str()),
-                         pDecrypted.get(), rsa.get(), RSA_NO_PADDING);
+                         pDecrypted.get(), rsa, RSA_NO_PADDING);
   if (status == -1) {
     LOG_ERROR << "RSA_public_decrypt failed with error " << ERR_error_string(ERR_get_error(), nullptr);
     return false;
@@ -249,7 +294,7 @@ bool Crypto::RSAPSSVerify(const std::string &public_key, const std::string &sign
   std::string digest = Crypto::sha256digest(message);
 
   /* verify the data */
-  status = RSA_verify_PKCS1_PSS(rsa.get(), reinterpret_cast<const unsigned char *>(digest.c_str()), EVP_sha256(),
+  status = RSA_verify_PKCS1_PSS(rsa, reinterpret_cast<const unsigned char *>(digest.c_str()), EVP_sha256(),
                                 pDecrypted.get(), -2 /* salt length recovered from signature*/);
 
   return status == 1;
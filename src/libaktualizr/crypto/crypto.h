@@ -98,6 +98,8 @@ class Crypto {
   static bool generateKeyPair(KeyType key_type, std::string *public_key, std::string *private_key);
 
   static bool RSAPSSVerify(const std::string &public_key, const std::string &signature, const std::string &message);
+  static bool RSAPSSVerify(RSA *rsa, const std::string &signature, const std::string &message);
+  static StructGuard<RSA> parseRSAPublicKey(const std::string &public_key);
   static bool ED25519Verify(const std::string &public_key, const std::string &signature, const std::string &message);
 
   static bool IsRsaKeyType(KeyType type);
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -11,6 +12,7 @@
 
 #include "crypto/crypto.h"
 #include "crypto/p11engine.h"
+#include "logging/logging.h"
 #include "utilities/utils.h"
 
 #ifdef BUILD_P11
@@ -49,6 +51,55 @@ TEST(crypto, sign_verify_rsa_file) {
   EXPECT_TRUE(signe_is_ok);
 }
 
+/* Copies of a key share its parsed form, which keeps working for both key types. */
+TEST(crypto, verify_parsed_key_copies) {
+  std::string text = "This is text for sign";
+  PublicKey pkey(fs::path("tests/test_data/public.key"));
+  std::string private_key = Utils::readFile("tests/test_data/priv.key");
+  std::string signature = Utils::toBase64(Crypto::RSAPSSSign(NULL, private_key, text));
+  EXPECT_TRUE(pkey.VerifySignature(signature, text));
+  PublicKey pkey_copy = pkey;
+  EXPECT_TRUE(pkey_copy.VerifySignature(signature, text));
+  EXPECT_FALSE(pkey_copy.VerifySignature(signature, text + "!"));
+
+  std::string ed_public;
+  std::string ed_private;
+  ASSERT_TRUE(Crypto::generateEDKeyPair(&ed_public, &ed_private));
+  PublicKey ed_pkey(ed_public, KeyType::kED25519);
+  std::string ed_signature = Utils::toBase64(Crypto::ED25519Sign(boost::algorithm::unhex(ed_private), text));
+  EXPECT_TRUE(ed_pkey.VerifySignature(ed_signature, text));
+  EXPECT_TRUE(PublicKey(ed_pkey).VerifySignature(ed_signature, text));
+  EXPECT_FALSE(ed_pkey.VerifySignature(ed_signature, text + "!"));
+}
+
+/* Compare RSA verifications per second with the key parsed on every call and
+ * with the key parsed once. Benchmark only, run it explicitly with
+ * --gtest_also_run_disabled_tests. */
+TEST(crypto, DISABLED_verify_rsa_throughput) {
+  const std::string text = "This is text for sign";
+  const std::string public_key = Utils::readFile("tests/test_data/public.key");
+  const std::string private_key = Utils::readFile("tests/test_data/priv.key");
+  const std::string signature = Crypto::RSAPSSSign(NULL, private_key, text);
+  const std::string signature_b64 = Utils::toBase64(signature);
+  PublicKey pkey(fs::path("tests/test_data/public.key"));
+  const int iterations = 1000;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < iterations; ++k) {
+    ASSERT_TRUE(Crypto::RSAPSSVerify(public_key, signature, text));
+  }
+  const std::chrono::duration<double> uncached = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int k = 0; k < iterations; ++k) {
+    ASSERT_TRUE(pkey.VerifySignature(signature_b64, text));
+  }
+  const std::chrono::duration<double> cached = std::chrono::steady_clock::now() - start;
+
+  LOG_INFO << "Key parsed per call: " << iterations / uncached.count() << " verifications/s";
+  LOG_INFO << "Parsed key reused: " << iterations / cached.count() << " verifications/s";
+}
+
 #ifdef BUILD_P11
 
 class P11Crypto : public ::testing::Test {
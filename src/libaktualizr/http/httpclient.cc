@@ -3,6 +3,8 @@
 #include <cassert>
 #include <sstream>
 
+#include <boost/algorithm/string.hpp>
+
 #include "utilities/utils.h"
 
 struct WriteStringArg {
@@ -34,6 +36,32 @@ static size_t writeString(void* contents, size_t size, size_t nmemb, void* userp
   return size * nmemb;
 }
 
+struct ResponseHeadersArg {
+  std::string etag;
+  std::string last_modified;
+};
+
+// Picks the cache validators out of the response headers
+static size_t readHeader(char* buffer, size_t size, size_t nitems, void* userp) {
+  auto* arg = static_cast<ResponseHeadersArg*>(userp);
+  const std::string line(buffer, size * nitems);
+  if (boost::algorithm::starts_with(line, "HTTP/")) {
+    // status line of a new response, e.g. after a redirect
+    *arg = ResponseHeadersArg();
+    return size * nitems;
+  }
+  const auto colon = line.find(':');
+  if (colon != std::string::npos) {
+    const std::string name = boost::algorithm::trim_copy(line.substr(0, colon));
+    if (boost::algorithm::iequals(name, "ETag")) {
+      arg->etag = boost::algorithm::trim_copy(line.substr(colon + 1));
+    } else if (boost::algorithm::iequals(name, "Last-Modified")) {
+      arg->last_modified = boost::algorithm::trim_copy(line.substr(colon + 1));
+    }
+  }
+  return size * nitems;
+}
+
 static int ProgressHandler(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
   (void)dltotal;
   (void)dlnow;
@@ -58,7 +86,58 @@ static int ProgressHandler(void* clientp, curl_off_t dltotal, curl_off_t dlnow,
   return 0;
 }
 
-HttpClient::HttpClient(const std::vector<std::string>* extra_headers) {
+CurlShare::CurlShare() {
+  share_ = curl_share_init();
+  if (share_ == nullptr) {
+    throw std::runtime_error("Could not initialize curl share");
+  }
+  curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lock);
+  curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlock);
+  curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+CurlShare::~CurlShare() {
+  for (CURL* handle : idle_) {
+    curl_easy_cleanup(handle);
+  }
+  curl_share_cleanup(share_);
+}
+
+CURL* CurlShare::takeIdle() {
+  std::lock_guard<std::mutex> guard(idle_mutex_);
+  if (idle_.empty()) {
+    return nullptr;
+  }
+  CURL* handle = idle_.back();
+  idle_.pop_back();
+  return handle;
+}
+
+void CurlShare::putIdle(CURL* handle) {
+  {
+    std::lock_guard<std::mutex> guard(idle_mutex_);
+    if (idle_.size() < kMaxIdleHandles) {
+      idle_.push_back(handle);
+      return;
+    }
+  }
+  curl_easy_cleanup(handle);
+}
+
+void CurlShare::lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userp) {
+  (void)handle;
+  (void)access;
+  static_cast<CurlShare*>(userp)->locks_.at(static_cast<size_t>(data)).lock();
+}
+
+void CurlShare::unlock(CURL* handle, curl_lock_data data, void* userp) {
+  (void)handle;
+  static_cast<CurlShare*>(userp)->locks_.at(static_cast<size_t>(data)).unlock();
+}
+
+HttpClient::HttpClient(const std::vector<std::string>* extra_headers) : share_(std::make_shared<CurlShare>()) {
   curl = curl_easy_init();
   if (curl == nullptr) {
     throw std::runtime_error("Could not initialize curl");
@@ -95,7 +174,10 @@ HttpClient::HttpClient(const std::string& socket) : HttpClient() {
 }
 
 HttpClient::HttpClient(const HttpClient& curl_in)
-    : HttpInterface(curl_in), pkcs11_key(curl_in.pkcs11_key), pkcs11_cert(curl_in.pkcs11_key) {
+    : HttpInterface(curl_in),
+      share_(std::make_shared<CurlShare>()),
+      pkcs11_key(curl_in.pkcs11_key),
+      pkcs11_cert(curl_in.pkcs11_key) {
   curl = curl_easy_duphandle(curl_in.curl);
   headers = curl_slist_dup(curl_in.headers);
 }
@@ -146,12 +228,73 @@ void HttpClient::setCerts(const std::string& ca, CryptoSource ca_source, const s
     tls_pkey_file = std::move_if_noexcept(tmp_pkey_file);
   }
   pkcs11_key = (pkey_source == CryptoSource::kPkcs11);
+
+  // Connections and TLS sessions set up with the previous credentials must
+  // not be reused
+  std::atomic_store(&share_, std::make_shared<CurlShare>());
+}
+
+CurlHandler HttpClient::dupHandle() {
+  std::shared_ptr<CurlShare> share = std::atomic_load(&share_);
+  CURL* handle = Utils::curlDupHandleWrapper(curl, pkcs11_key);
+  curlEasySetoptWrapper(handle, CURLOPT_SHARE, share->get());
+  // The share must outlive every handle attached to it
+  return CurlHandler(handle, [share](CURL* c) { curl_easy_cleanup(c); });
+}
+
+// Undo what the request methods set on a handle, so that it is in the same
+// state as a fresh copy of the template handle again
+static void resetRequestOptions(CURL* handle) {
+  curlEasySetoptWrapper(handle, CURLOPT_HTTPHEADER, nullptr);
+  curlEasySetoptWrapper(handle, CURLOPT_HEADERFUNCTION, nullptr);
+  curlEasySetoptWrapper(handle, CURLOPT_HEADERDATA, nullptr);
+  curlEasySetoptWrapper(handle, CURLOPT_NOPROGRESS, 1L);
+  curlEasySetoptWrapper(handle, CURLOPT_XFERINFOFUNCTION, nullptr);
+  curlEasySetoptWrapper(handle, CURLOPT_XFERINFODATA, nullptr);
+  curlEasySetoptWrapper(handle, CURLOPT_POSTFIELDS, nullptr);
+  curlEasySetoptWrapper(handle, CURLOPT_CUSTOMREQUEST, nullptr);
+  curlEasySetoptWrapper(handle, CURLOPT_HTTPGET, 1L);
+  curlEasySetoptWrapper(handle, CURLOPT_MAXFILESIZE_LARGE, static_cast<curl_off_t>(0));
+  curlEasySetoptWrapper(handle, CURLOPT_WRITEDATA, nullptr);
+}
+
+// Handle for a request made through perform(). It is reused by a later
+// request, so that the connections it opened are reused as well.
+CurlHandler HttpClient::requestHandle() {
+  std::shared_ptr<CurlShare> share = std::atomic_load(&share_);
+  CURL* handle = share->takeIdle();
+  if (handle == nullptr) {
+    handle = Utils::curlDupHandleWrapper(curl, pkcs11_key);
+    curlEasySetoptWrapper(handle, CURLOPT_SHARE, share->get());
+  }
+  return CurlHandler(handle, [share](CURL* c) {
+    resetRequestOptions(c);
+    share->putIdle(c);
+  });
 }
 
 HttpResponse HttpClient::get(const std::string& url, int64_t maxsize, const api::FlowControlToken* flow_control) {
-  CURL* curl_get = Utils::curlDupHandleWrapper(curl, pkcs11_key);
+  return getIfModified(url, maxsize, flow_control, "", "");
+}
+
+HttpResponse HttpClient::getIfModified(const std::string& url, int64_t maxsize,
+                                       const api::FlowControlToken* flow_control, const std::string& etag,
+                                       const std::string& last_modified) {
+  CurlHandler curlp = requestHandle();
+  CURL* curl_get = curlp.get();
+
+  curl_slist* req_headers = curl_slist_dup(headers);
+  if (!etag.empty()) {
+    req_headers = curl_slist_append(req_headers, ("If-None-Match: " + etag).c_str());
+  }
+  if (!last_modified.empty()) {
+    req_headers = curl_slist_append(req_headers, ("If-Modified-Since: " + last_modified).c_str());
+  }
+  curlEasySetoptWrapper(curl_get, CURLOPT_HTTPHEADER, req_headers);
 
-  curlEasySetoptWrapper(curl_get, CURLOPT_HTTPHEADER, headers);
+  ResponseHeadersArg response_headers;
+  curlEasySetoptWrapper(curl_get, CURLOPT_HEADERFUNCTION, readHeader);
+  curlEasySetoptWrapper(curl_get, CURLOPT_HEADERDATA, &response_headers);
 
   if (pkcs11_cert) {
     curlEasySetoptWrapper(curl_get, CURLOPT_SSLCERTTYPE, "ENG");
@@ -171,12 +314,15 @@ HttpResponse HttpClient::get(const std::string& url, int64_t maxsize, const api:
 
   LOG_DEBUG << "GET " << url;
   HttpResponse response = perform(curl_get, RETRY_TIMES, maxsize);
-  curl_easy_cleanup(curl_get);
+  curl_slist_free_all(req_headers);
+  response.etag = response_headers.etag;
+  response.last_modified = response_headers.last_modified;
   return response;
 }
 
 HttpResponse HttpClient::post(const std::string& url, const std::string& content_type, const std::string& data) {
-  CURL* curl_post = Utils::curlDupHandleWrapper(curl, pkcs11_key);
+  CurlHandler curlp = requestHandle();
+  CURL* curl_post = curlp.get();
   curl_slist* req_headers = curl_slist_dup(headers);
   req_headers = curl_slist_append(req_headers, (std::string("Content-Type: ") + content_type).c_str());
   curlEasySetoptWrapper(curl_post, CURLOPT_HTTPHEADER, req_headers);
@@ -184,7 +330,6 @@ HttpResponse HttpClient::post(const std::string& url, const std::string& content
   curlEasySetoptWrapper(curl_post, CURLOPT_POST, 1);
   curlEasySetoptWrapper(curl_post, CURLOPT_POSTFIELDS, data.c_str());
   auto result = perform(curl_post, RETRY_TIMES, HttpInterface::kPostRespLimit);
-  curl_easy_cleanup(curl_post);
   curl_slist_free_all(req_headers);
   return result;
 }
@@ -196,7 +341,8 @@ HttpResponse HttpClient::post(const std::string& url, const Json::Value& data) {
 }
 
 HttpResponse HttpClient::put(const std::string& url, const std::string& content_type, const std::string& data) {
-  CURL* curl_put = Utils::curlDupHandleWrapper(curl, pkcs11_key);
+  CurlHandler curlp = requestHandle();
+  CURL* curl_put = curlp.get();
   curl_slist* req_headers = curl_slist_dup(headers);
   req_headers = curl_slist_append(req_headers, (std::string("Content-Type: ") + content_type).c_str());
   curlEasySetoptWrapper(curl_put, CURLOPT_HTTPHEADER, req_headers);
@@ -204,7 +350,6 @@ HttpResponse HttpClient::put(const std::string& url, const std::string& content_
   curlEasySetoptWrapper(curl_put, CURLOPT_POSTFIELDS, data.c_str());
   curlEasySetoptWrapper(curl_put, CURLOPT_CUSTOMREQUEST, "PUT");
   HttpResponse result = perform(curl_put, RETRY_TIMES, HttpInterface::kPutRespLimit);
-  curl_easy_cleanup(curl_put);
   curl_slist_free_all(req_headers);
   return result;
 }
@@ -253,30 +398,36 @@ HttpResponse HttpClient::download(const std::string& url, curl_write_callback wr
   return downloadAsync(url, write_cb, progress_cb, userp, from, nullptr).get();
 }
 
+CurlHandler HttpClient::downloadHandle(const std::string& url, curl_write_callback write_cb, void* userp) {
+  CurlHandler curlp = dupHandle();
+  CURL* curl_download = curlp.get();
+
+  curlEasySetoptWrapper(curl_download, CURLOPT_HTTPHEADER, headers);
+  curlEasySetoptWrapper(curl_download, CURLOPT_URL, url.c_str());
+  curlEasySetoptWrapper(curl_download, CURLOPT_HTTPGET, 1L);
+  curlEasySetoptWrapper(curl_download, CURLOPT_WRITEFUNCTION, write_cb);
+  curlEasySetoptWrapper(curl_download, CURLOPT_WRITEDATA, userp);
+  curlEasySetoptWrapper(curl_download, CURLOPT_TIMEOUT, 0);
+  curlEasySetoptWrapper(curl_download, CURLOPT_LOW_SPEED_TIME, speed_limit_time_interval_);
+  curlEasySetoptWrapper(curl_download, CURLOPT_LOW_SPEED_LIMIT, speed_limit_bytes_per_sec_);
+  return curlp;
+}
+
 std::future<HttpResponse> HttpClient::downloadAsync(const std::string& url, curl_write_callback write_cb,
                                                     curl_xferinfo_callback progress_cb, void* userp, curl_off_t from,
                                                     CurlHandler* easyp) {
-  CURL* curl_download = Utils::curlDupHandleWrapper(curl, pkcs11_key);
-
-  CurlHandler curlp = CurlHandler(curl_download, curl_easy_cleanup);
+  CurlHandler curlp = downloadHandle(url, write_cb, userp);
+  CURL* curl_download = curlp.get();
 
   if (easyp != nullptr) {
     *easyp = curlp;
   }
 
-  curlEasySetoptWrapper(curl_download, CURLOPT_HTTPHEADER, headers);
-  curlEasySetoptWrapper(curl_download, CURLOPT_URL, url.c_str());
-  curlEasySetoptWrapper(curl_download, CURLOPT_HTTPGET, 1L);
-  curlEasySetoptWrapper(curl_download, CURLOPT_WRITEFUNCTION, write_cb);
-  curlEasySetoptWrapper(curl_download, CURLOPT_WRITEDATA, userp);
   if (progress_cb != nullptr) {
     curlEasySetoptWrapper(curl_download, CURLOPT_NOPROGRESS, 0);
     curlEasySetoptWrapper(curl_download, CURLOPT_XFERINFOFUNCTION, progress_cb);
     curlEasySetoptWrapper(curl_download, CURLOPT_XFERINFODATA, userp);
   }
-  curlEasySetoptWrapper(curl_download, CURLOPT_TIMEOUT, 0);
-  curlEasySetoptWrapper(curl_download, CURLOPT_LOW_SPEED_TIME, speed_limit_time_interval_);
-  curlEasySetoptWrapper(curl_download, CURLOPT_LOW_SPEED_LIMIT, speed_limit_bytes_per_sec_);
   curlEasySetoptWrapper(curl_download, CURLOPT_RESUME_FROM_LARGE, from);
 
   std::promise<HttpResponse> resp_promise;
@@ -294,6 +445,60 @@ std::future<HttpResponse> HttpClient::downloadAsync(const std::string& url, curl
   return resp_future;
 }
 
+struct RangeDownloadArg {
+  CURL* curl{nullptr};
+  curl_write_callback write_cb{nullptr};
+  void* userp{nullptr};
+  bool range_ignored{false};
+};
+
+// Only passes the data on if the server actually answered with the requested
+// range, as opposed to the whole content
+static size_t writeRange(char* contents, size_t size, size_t nmemb, void* userp) {
+  auto* arg = static_cast<RangeDownloadArg*>(userp);
+  long http_code = 0;  // NOLINT(google-runtime-int)
+  curl_easy_getinfo(arg->curl, CURLINFO_RESPONSE_CODE, &http_code);
+  if (http_code == 200) {
+    arg->range_ignored = true;
+    return 0;
+  }
+  if (http_code != 206) {
+    // error page, the failure is reported through the HTTP code
+    return size * nmemb;
+  }
+  return arg->write_cb(contents, size, nmemb, arg->userp);
+}
+
+std::future<HttpResponse> HttpClient::downloadRangeAsync(const std::string& url, curl_write_callback write_cb,
+                                                         void* userp, curl_off_t from, curl_off_t to) {
+  auto arg = std::make_shared<RangeDownloadArg>();
+  CurlHandler curlp = downloadHandle(url, writeRange, arg.get());
+  arg->curl = curlp.get();
+  arg->write_cb = write_cb;
+  arg->userp = userp;
+
+  const std::string range = std::to_string(from) + "-" + std::to_string(to);
+  curlEasySetoptWrapper(curlp.get(), CURLOPT_RANGE, range.c_str());
+
+  std::promise<HttpResponse> resp_promise;
+  auto resp_future = resp_promise.get_future();
+  std::thread(
+      [curlp, arg](std::promise<HttpResponse> promise) {
+        CURLcode result = curl_easy_perform(curlp.get());
+        long http_code;  // NOLINT(google-runtime-int)
+        curl_easy_getinfo(curlp.get(), CURLINFO_RESPONSE_CODE, &http_code);
+        if (arg->range_ignored) {
+          promise.set_value(HttpResponse("", http_code, CURLE_RANGE_ERROR, "Server does not support byte ranges"));
+          return;
+        }
+        HttpResponse response("", http_code, result, (result != CURLE_OK) ? curl_easy_strerror(result) : "");
+        promise.set_value(response);
+      },
+      std::move(resp_promise))
+      .detach();
+  return resp_future;
+}
+
 bool HttpClient::updateHeader(const std::string& name, const std::string& value) {
   curl_slist* item = headers;
   std::string lookfor(name + ": ");
@@ -317,6 +522,8 @@ void HttpClient::timeout(int64_t ms) {
   auto ms_long = static_cast<long>(ms);  // NOLINT(google-runtime-int)
   curlEasySetoptWrapper(curl, CURLOPT_TIMEOUT_MS, ms_long);
   curlEasySetoptWrapper(curl, CURLOPT_CONNECTTIMEOUT_MS, ms_long);
+  // Handles kept for reuse still have the old timeouts
+  std::atomic_store(&share_, std::make_shared<CurlShare>());
 }
 
 curl_slist* HttpClient::curl_slist_dup(curl_slist* sl) {
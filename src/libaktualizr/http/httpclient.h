@@ -1,8 +1,11 @@
 #ifndef HTTPCLIENT_H_
 #define HTTPCLIENT_H_
 
+#include <array>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <curl/curl.h>
 #include "gtest/gtest_prod.h"
@@ -23,6 +26,41 @@ class CurlGlobalInitWrapper {
   CurlGlobalInitWrapper &operator=(CurlGlobalInitWrapper &&) = delete;
 };
 
+/**
+ * DNS and TLS session caches shared by all the transfers of a HttpClient.
+ *
+ * libcurl does not support sharing a connection cache between transfers that
+ * run on different threads, so connections are reused differently: the easy
+ * handle of a finished request is kept here, together with the connections it
+ * holds open, and handed to the next request. Each handle is only ever used
+ * by one transfer at a time.
+ */
+class CurlShare {
+ public:
+  CurlShare();
+  ~CurlShare();
+  CurlShare(const CurlShare &) = delete;
+  CurlShare(CurlShare &&) = delete;
+  CurlShare &operator=(const CurlShare &) = delete;
+  CurlShare &operator=(CurlShare &&) = delete;
+  CURLSH *get() const { return share_; }
+  // Returns the handle of a finished request, or nullptr if there is none
+  CURL *takeIdle();
+  // Keeps the handle of a finished request, or frees it if enough are kept
+  void putIdle(CURL *handle);
+
+ private:
+  static constexpr size_t kMaxIdleHandles = 4;
+
+  static void lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userp);
+  static void unlock(CURL *handle, curl_lock_data data, void *userp);
+
+  CURLSH *share_;
+  std::array<std::mutex, CURL_LOCK_DATA_LAST> locks_;
+  std::mutex idle_mutex_;
+  std::vector<CURL *> idle_;
+};
+
 class HttpClient : public HttpInterface {
  public:
   explicit HttpClient(const std::vector<std::string> *extra_headers = nullptr);
@@ -33,6 +71,8 @@ class HttpClient : public HttpInterface {
   HttpClient &operator=(const HttpClient &) = delete;
   HttpClient &operator=(HttpClient &&) = default;
   HttpResponse get(const std::string &url, int64_t maxsize, const api::FlowControlToken *flow_control) override;
+  HttpResponse getIfModified(const std::string &url, int64_t maxsize, const api::FlowControlToken *flow_control,
+                             const std::string &etag, const std::string &last_modified) override;
   HttpResponse post(const std::string &url, const std::string &content_type, const std::string &data) override;
   HttpResponse post(const std::string &url, const Json::Value &data) override;
   HttpResponse put(const std::string &url, const std::string &content_type, const std::string &data) override;
@@ -43,6 +83,8 @@ class HttpClient : public HttpInterface {
   std::future<HttpResponse> downloadAsync(const std::string &url, curl_write_callback write_cb,
                                           curl_xferinfo_callback progress_cb, void *userp, curl_off_t from,
                                           CurlHandler *easyp) override;
+  std::future<HttpResponse> downloadRangeAsync(const std::string &url, curl_write_callback write_cb, void *userp,
+                                               curl_off_t from, curl_off_t to) override;
   void setCerts(const std::string &ca, CryptoSource ca_source, const std::string &cert, CryptoSource cert_source,
                 const std::string &pkey, CryptoSource pkey_source) override;
   bool updateHeader(const std::string &name, const std::string &value);
@@ -50,11 +92,18 @@ class HttpClient : public HttpInterface {
 
  private:
   FRIEND_TEST(GetTest, download_speed_limit);
+  FRIEND_TEST(GetTest, reuse_handle);
 
   static const CurlGlobalInitWrapper manageCurlGlobalInit_;
   CURL *curl;
   curl_slist *headers;
+  // Replaced while other threads may be starting transfers, so only accessed
+  // through std::atomic_load() and std::atomic_store()
+  std::shared_ptr<CurlShare> share_;
   HttpResponse perform(CURL *curl_handler, int retry_times, int64_t size_limit);
+  CurlHandler dupHandle();
+  CurlHandler requestHandle();
+  CurlHandler downloadHandle(const std::string &url, curl_write_callback write_cb, void *userp);
   static curl_slist *curl_slist_dup(curl_slist *sl);
 
   std::unique_ptr<TemporaryFile> tls_ca_file;
@@ -40,6 +40,34 @@ TEST(GetTestWithHeaders, get_performed) {
   EXPECT_EQ(response["status"].asString(), "good");
 }
 
+/* Requests issued concurrently through one client each get their own handle. */
+TEST(GetTest, get_concurrent) {
+  HttpClient http;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&http, i]() {
+      for (int j = 0; j < 10; ++j) {
+        std::string path = "/path/" + std::to_string(i) + "/" + std::to_string(j);
+        Json::Value response = http.get(server + path, HttpInterface::kNoLimit, nullptr).getJson();
+        EXPECT_EQ(response["path"].asString(), path);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+/* A request reuses the handle of the previous one, and with it the connection
+ * it has kept open. */
+TEST(GetTest, reuse_handle) {
+  HttpClient http;
+  EXPECT_TRUE(http.get(server + "/path/1", HttpInterface::kNoLimit, nullptr).isOk());
+  CURL* first = http.requestHandle().get();
+  EXPECT_TRUE(http.post(server + "/path/2", "text/plain", "data").isOk());
+  EXPECT_EQ(http.requestHandle().get(), first);
+}
+
 /* Reject http GET responses that exceed size limit. */
 TEST(GetTest, download_size_limit) {
   HttpClient http;
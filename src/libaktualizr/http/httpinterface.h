@@ -27,7 +27,11 @@ struct HttpResponse {
   long http_status_code{0};  // NOLINT(google-runtime-int)
   CURLcode curl_code{CURLE_OK};
   std::string error_message;
+  // Cache validators sent by the server, if any
+  std::string etag;
+  std::string last_modified;
   bool isOk() const { return (curl_code == CURLE_OK && http_status_code >= 200 && http_status_code < 400); }
+  bool isNotModified() const { return curl_code == CURLE_OK && http_status_code == 304; }
   bool wasInterrupted() const { return curl_code == CURLE_ABORTED_BY_CALLBACK; };
   std::string getStatusStr() const {
     return std::to_string(curl_code) + " " + error_message + " HTTP " + std::to_string(http_status_code);
@@ -42,6 +46,15 @@ class HttpInterface {
   virtual ~HttpInterface() = default;
   virtual HttpResponse get(const std::string &url, int64_t maxsize, const api::FlowControlToken *flow_control) = 0;
   HttpResponse get(const std::string &url, int64_t maxsize) { return get(url, maxsize, nullptr); }
+  // Conditional GET: the response is 304 (Not Modified) with an empty body if
+  // the resource still matches `etag` or has not changed since `last_modified`.
+  // Implementations that do not support it perform a regular GET.
+  virtual HttpResponse getIfModified(const std::string &url, int64_t maxsize, const api::FlowControlToken *flow_control,
+                                     const std::string &etag, const std::string &last_modified) {
+    (void)etag;
+    (void)last_modified;
+    return get(url, maxsize, flow_control);
+  }
   virtual HttpResponse post(const std::string &url, const std::string &content_type, const std::string &data) = 0;
   virtual HttpResponse post(const std::string &url, const Json::Value &data) = 0;
   virtual HttpResponse put(const std::string &url, const std::string &content_type, const std::string &data) = 0;
@@ -52,6 +65,19 @@ class HttpInterface {
   virtual std::future<HttpResponse> downloadAsync(const std::string &url, curl_write_callback write_cb,
                                                   curl_xferinfo_callback progress_cb, void *userp, curl_off_t from,
                                                   CurlHandler *easyp) = 0;
+  // Download the bytes `from` to `to` (inclusive) of the resource. The
+  // response has CURLE_RANGE_ERROR if the server does not honor byte ranges.
+  virtual std::future<HttpResponse> downloadRangeAsync(const std::string &url, curl_write_callback write_cb,
+                                                       void *userp, curl_off_t from, curl_off_t to) {
+    (void)url;
+    (void)write_cb;
+    (void)userp;
+    (void)from;
+    (void)to;
+    std::promise<HttpResponse> resp_promise;
+    resp_promise.set_value(HttpResponse("", 0, CURLE_RANGE_ERROR, "Byte range requests are not supported"));
+    return resp_promise.get_future();
+  }
   virtual void setCerts(const std::string &ca, CryptoSource ca_source, const std::string &cert,
                         CryptoSource cert_source, const std::string &pkey, CryptoSource pkey_source) = 0;
   static constexpr int64_t kNoLimit = 0;  // no limit the size of downloaded data
@@ -1,8 +1,100 @@
+#include "log_stream_backend.h"
+
 #include <iomanip>
 #include <iostream>
 
+#include <boost/log/core/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
 #include <boost/log/trivial.hpp>
-#include <boost/log/utility/setup/console.hpp>
+#include <boost/make_shared.hpp>
+
+void LogStreamBackend::consume(const boost::log::record_view& rec, const string_type& message) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!async_) {
+    stream_ << message << '\n';
+    stream_.flush();
+    return;
+  }
+
+  if (queue_.size() >= kMaxQueued) {
+    auto severity = rec[boost::log::trivial::severity];
+    if (!severity || severity.get() < boost::log::trivial::warning) {
+      ++dropped_;
+      return;
+    }
+    space_cv_.wait(lock, [this] { return queue_.size() < kMaxQueued; });
+  }
+  queue_.push_back(message);
+  if (queue_.size() == 1) {
+    // The writer only waits when the queue is empty
+    queued_cv_.notify_one();
+  }
+}
+
+void LogStreamBackend::setAsync(bool enabled) {
+  std::lock_guard<std::mutex> control_lock(control_mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (enabled == async_) {
+    return;
+  }
+  if (enabled) {
+    async_ = true;
+    stop_ = false;
+    thread_ = std::thread(&LogStreamBackend::run, this);
+    return;
+  }
+
+  stop_ = true;
+  lock.unlock();
+  queued_cv_.notify_one();
+  thread_.join();
+  lock.lock();
+  // Records queued after the writer has seen the stop request
+  write(queue_, dropped_);
+  queue_.clear();
+  dropped_ = 0;
+  async_ = false;
+  space_cv_.notify_all();
+}
+
+void LogStreamBackend::run() {
+  std::vector<std::string> batch;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    queued_cv_.wait(lock, [this] { return !queue_.empty() || dropped_ > 0 || stop_; });
+    if (queue_.empty() && dropped_ == 0) {
+      break;
+    }
+    batch.swap(queue_);
+    const size_t dropped = dropped_;
+    dropped_ = 0;
+    lock.unlock();
+    space_cv_.notify_all();
+
+    write(batch, dropped);
+    batch.clear();
+    lock.lock();
+  }
+}
+
+void LogStreamBackend::write(const std::vector<std::string>& batch, size_t dropped) {
+  std::string out;
+  for (const auto& message : batch) {
+    out += message;
+    out += '\n';
+  }
+  if (dropped > 0) {
+    out += "Dropped " + std::to_string(dropped) + " log messages because the log output could not keep up\n";
+  }
+  if (!out.empty()) {
+    stream_.write(out.data(), static_cast<std::streamsize>(out.size()));
+    stream_.flush();
+  }
+}
+
+// The backend of the sink added by the latest logger_init_sink()
+static boost::shared_ptr<LogStreamBackend> gBackend;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
 
 static void color_fmt(boost::log::record_view const& rec, boost::log::formatting_ostream& strm) {
   auto severity = rec[boost::log::trivial::severity];
@@ -34,9 +126,19 @@ void logger_init_sink(bool use_colors = false) {
   if (getenv("LOG_STDERR") == nullptr) {
     stream = &std::cout;
   }
-  auto sink = boost::log::add_console_log(*stream, boost::log::keywords::format = "%Message%",
-                                          boost::log::keywords::auto_flush = true);
+  auto backend = boost::make_shared<LogStreamBackend>(*stream);
+  auto sink = boost::make_shared<boost::log::sinks::synchronous_sink<LogStreamBackend>>(backend);
   if (use_colors) {
     sink->set_formatter(&color_fmt);
+  } else {
+    sink->set_formatter(boost::log::expressions::stream << boost::log::expressions::smessage);
+  }
+  boost::log::core::get()->add_sink(sink);
+  gBackend = backend;
+}
+
+void logger_set_sink_async(bool enabled) {
+  if (gBackend != nullptr) {
+    gBackend->setAsync(enabled);
   }
 }
@@ -0,0 +1,51 @@
+#ifndef LOGGING_LOG_STREAM_BACKEND_H_
+#define LOGGING_LOG_STREAM_BACKEND_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/log/sinks/basic_sink_backend.hpp>
+
+/**
+ * Writes formatted log records to a stream. By default every record is written
+ * and flushed by the thread that logs it. In asynchronous mode the records are
+ * queued instead and a background thread writes whatever has accumulated in a
+ * single write. When the queue is full, records below warning level are
+ * dropped (and counted) rather than holding up the caller.
+ */
+class LogStreamBackend
+    : public boost::log::sinks::basic_formatted_sink_backend<char, boost::log::sinks::synchronized_feeding> {
+ public:
+  static constexpr size_t kMaxQueued = 4096;
+
+  explicit LogStreamBackend(std::ostream& stream) : stream_(stream) {}
+  ~LogStreamBackend() { setAsync(false); }
+  LogStreamBackend(const LogStreamBackend&) = delete;
+  LogStreamBackend(LogStreamBackend&&) = delete;
+  LogStreamBackend& operator=(const LogStreamBackend&) = delete;
+  LogStreamBackend& operator=(LogStreamBackend&&) = delete;
+
+  void consume(const boost::log::record_view& rec, const string_type& message);
+  void setAsync(bool enabled);
+
+ private:
+  void run();
+  void write(const std::vector<std::string>& batch, size_t dropped);
+
+  std::ostream& stream_;
+  std::mutex control_mutex_;  // Serializes setAsync()
+  std::mutex mutex_;
+  std::condition_variable queued_cv_;
+  std::condition_variable space_cv_;
+  std::vector<std::string> queue_;
+  size_t dropped_{0};
+  bool async_{false};
+  bool stop_{false};
+  std::thread thread_;
+};
+
+#endif  // LOGGING_LOG_STREAM_BACKEND_H_
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include <boost/log/core/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/log/sources/record_ostream.hpp>
+#include <boost/log/sources/severity_logger.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/make_shared.hpp>
+
+#include "log_stream_backend.h"
+
+/* Records what is written to it, and holds up writes while it is closed. */
+class GatedBuffer : public std::streambuf {
+ public:
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = false;
+  }
+  void Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    cv_.notify_all();
+  }
+  // Wait until a write is held up
+  void WaitUntilBlocked() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return blocked_; });
+  }
+  std::string Contents() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return contents_;
+  }
+  int Writes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return writes_;
+  }
+
+ protected:
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    blocked_ = !open_;
+    cv_.notify_all();
+    cv_.wait(lock, [this] { return open_; });
+    blocked_ = false;
+    contents_.append(s, static_cast<size_t>(n));
+    ++writes_;
+    return n;
+  }
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      const char ch = traits_type::to_char_type(c);
+      xsputn(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool open_{true};
+  bool blocked_{false};
+  std::string contents_;
+  int writes_{0};
+};
+
+class LogStreamBackendTest : public ::testing::Test {
+ protected:
+  using Sink = boost::log::sinks::synchronous_sink<LogStreamBackend>;
+
+  LogStreamBackendTest() : stream_(&buffer_), backend_(boost::make_shared<LogStreamBackend>(stream_)) {
+    sink_ = boost::make_shared<Sink>(backend_);
+    sink_->set_formatter(boost::log::expressions::stream << boost::log::expressions::smessage);
+    boost::log::core::get()->add_sink(sink_);
+  }
+  ~LogStreamBackendTest() override { Destroy(); }
+
+  void Log(boost::log::trivial::severity_level severity, const std::string &message) {
+    BOOST_LOG_SEV(logger_, severity) << message;
+  }
+
+  // Start asynchronous mode with the writer held up on a first record
+  void StartBlocked() {
+    backend_->setAsync(true);
+    buffer_.Close();
+    Log(boost::log::trivial::info, "first");
+    buffer_.WaitUntilBlocked();
+  }
+
+  void Destroy() {
+    if (sink_) {
+      boost::log::core::get()->remove_sink(sink_);
+      sink_.reset();
+      backend_.reset();
+    }
+  }
+
+  GatedBuffer buffer_;
+  std::ostream stream_;
+  boost::shared_ptr<LogStreamBackend> backend_;
+  boost::shared_ptr<Sink> sink_;
+  boost::log::sources::severity_logger_mt<boost::log::trivial::severity_level> logger_;
+};
+
+/* Records that pile up while the writer is busy are written in order, in one
+ * write. */
+TEST_F(LogStreamBackendTest, BatchedInOrder) {
+  StartBlocked();
+  std::string expected = "first\n";
+  for (int i = 0; i < 100; ++i) {
+    Log(boost::log::trivial::info, "line " + std::to_string(i));
+    expected += "line " + std::to_string(i) + "\n";
+  }
+  EXPECT_EQ(buffer_.Contents(), "");
+
+  buffer_.Open();
+  backend_->setAsync(false);
+  EXPECT_EQ(buffer_.Contents(), expected);
+  EXPECT_EQ(buffer_.Writes(), 2);
+}
+
+/* With a full queue, records below warning are dropped and counted, while
+ * warnings wait for space. */
+TEST_F(LogStreamBackendTest, DropBelowWarningWhenFull) {
+  StartBlocked();
+  std::string expected = "first\n";
+  for (size_t i = 0; i < LogStreamBackend::kMaxQueued; ++i) {
+    Log(boost::log::trivial::info, "line " + std::to_string(i));
+    expected += "line " + std::to_string(i) + "\n";
+  }
+  for (int i = 0; i < 10; ++i) {
+    Log(boost::log::trivial::debug, "dropped debug");
+    Log(boost::log::trivial::info, "dropped info");
+  }
+  expected += "Dropped 20 log messages because the log output could not keep up\n";
+  expected += "kept warning\n";
+
+  std::thread warning([this]() { Log(boost::log::trivial::warning, "kept warning"); });
+  buffer_.Open();
+  warning.join();
+  backend_->setAsync(false);
+  EXPECT_EQ(buffer_.Contents(), expected);
+}
+
+/* Leaving asynchronous mode writes what is still queued, and later records are
+ * written straight away. */
+TEST_F(LogStreamBackendTest, DrainOnSetAsyncFalse) {
+  StartBlocked();
+  Log(boost::log::trivial::info, "queued");
+  buffer_.Open();
+  backend_->setAsync(false);
+  EXPECT_EQ(buffer_.Contents(), "first\nqueued\n");
+
+  Log(boost::log::trivial::info, "direct");
+  EXPECT_EQ(buffer_.Contents(), "first\nqueued\ndirect\n");
+}
+
+/* Destroying the backend in asynchronous mode writes what is still queued. */
+TEST_F(LogStreamBackendTest, DrainOnDestruction) {
+  StartBlocked();
+  Log(boost::log::trivial::info, "queued");
+  buffer_.Open();
+  Destroy();
+  EXPECT_EQ(buffer_.Contents(), "first\nqueued\n");
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
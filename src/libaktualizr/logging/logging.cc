@@ -10,6 +10,7 @@ using boost::log::trivial::severity_level;
 static severity_level gLoggingThreshold;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
 
 extern void logger_init_sink(bool use_colors = false);
+extern void logger_set_sink_async(bool enabled);
 
 int64_t get_curlopt_verbose() { return gLoggingThreshold <= boost::log::trivial::trace ? 1L : 0L; }
 
@@ -37,8 +38,11 @@ void logger_set_threshold(const LoggerConfig& lconfig) {
     loglevel = boost::log::trivial::fatal;
   }
   logger_set_threshold(static_cast<boost::log::trivial::severity_level>(loglevel));
+  logger_set_async(lconfig.async);
 }
 
+void logger_set_async(bool enabled) { logger_set_sink_async(enabled); }
+
 void logger_set_enable(bool enabled) { boost::log::core::get()->set_logging_enabled(enabled); }
 
 int loggerGetSeverity() { return static_cast<int>(gLoggingThreshold); }
@@ -33,8 +33,14 @@ void logger_init(bool use_colors = false);
 
 void logger_set_threshold(boost::log::trivial::severity_level threshold);
 
+// Also applies the other logger options from the configuration
 void logger_set_threshold(const LoggerConfig& lconfig);
 
+// Write log messages from a background thread, in batches, rather than from
+// the thread that logs them. Under a flood of messages the ones below warning
+// level may be dropped; the output says how many.
+void logger_set_async(bool enabled);
+
 void logger_set_enable(bool enabled);
 
 int loggerGetSeverity();
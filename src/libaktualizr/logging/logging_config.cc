@@ -5,6 +5,10 @@
 
 void LoggerConfig::updateFromPropertyTree(const boost::property_tree::ptree& pt) {
   CopyFromConfig(loglevel, "loglevel", pt);
+  CopyFromConfig(async, "async", pt);
 }
 
-void LoggerConfig::writeToStream(std::ostream& out_stream) const { writeOption(out_stream, loglevel, "loglevel"); }
+void LoggerConfig::writeToStream(std::ostream& out_stream) const {
+  writeOption(out_stream, loglevel, "loglevel");
+  writeOption(out_stream, async, "async");
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <sys/statvfs.h>
+#include <atomic>
 #include <chrono>
 #include <future>
 #include <iostream>
@@ -56,7 +57,8 @@ static void progress_cb(const Uptane::Target& target, const std::string& descrip
  * Resuming while not paused is ignored.
  * Resuming while not downloading is ignored
  */
-void test_pause(const Uptane::Target& target, const std::string& type = PACKAGE_MANAGER_NONE) {
+void test_pause(const Uptane::Target& target, const std::string& type = PACKAGE_MANAGER_NONE,
+                uint64_t download_segments = 1) {
   TemporaryDirectory temp_dir;
   config.storage.path = temp_dir.Path();
   config.pacman.images_path = temp_dir.Path() / "images";
@@ -64,6 +66,7 @@ void test_pause(const Uptane::Target& target, const std::string& type = PACKAGE_
   config.pacman.type = type;
   config.pacman.sysroot = sysroot;
   config.pacman.ostree_server = treehub_server;
+  config.pacman.download_segments = download_segments;
 
   std::shared_ptr<INvStorage> storage(new SQLStorage(config.storage, false));
   auto http = std::make_shared<HttpClient>();
@@ -106,6 +109,7 @@ void test_pause(const Uptane::Target& target, const std::string& type = PACKAGE_
       std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - start).count();
   EXPECT_TRUE(result.get());
   EXPECT_GE(duration, pause_duration);
+  config.pacman.download_segments = 1;
 }
 
 #ifdef BUILD_OSTREE
@@ -132,6 +136,130 @@ TEST(Fetcher, PauseBinary) {
   test_pause(target);
 }
 
+/* Download a binary target as several parallel byte ranges. */
+TEST(Fetcher, DownloadSegments) {
+  Json::Value target_json;
+  target_json["hashes"]["sha256"] = "dd7bd1c37a3226e520b8d6939c30991b1c08772d5dab62b381c3a63541dc629a";
+  target_json["length"] = 100 * (1 << 20);
+  Uptane::Target target("large_file", target_json);
+
+  TemporaryDirectory temp_dir;
+  Config segment_config = config;
+  segment_config.storage.path = temp_dir.Path();
+  segment_config.pacman.images_path = temp_dir.Path() / "images";
+  segment_config.pacman.download_segments = 4;
+  segment_config.uptane.repo_server = server;
+
+  std::shared_ptr<INvStorage> storage(new SQLStorage(segment_config.storage, false));
+  auto http = std::make_shared<HttpClient>();
+  auto pacman = std::make_shared<PackageManagerFake>(segment_config.pacman, segment_config.bootloader, storage, http);
+  KeyManager keys(storage, segment_config.keymanagerConfig());
+  Uptane::Fetcher fetcher(segment_config, http);
+
+  EXPECT_TRUE(pacman->fetchTarget(target, fetcher, keys, progress_cb, nullptr));
+  EXPECT_EQ(pacman->verifyTarget(target), TargetStatus::kGood);
+  // The resume state is dropped once the download is complete.
+  for (const auto& entry : boost::filesystem::directory_iterator(segment_config.pacman.images_path)) {
+    EXPECT_NE(entry.path().extension(), ".segments");
+  }
+}
+
+/* Pause and resume a download made of several byte ranges. */
+TEST(Fetcher, PauseBinarySegments) {
+  Json::Value target_json;
+  target_json["hashes"]["sha256"] = "dd7bd1c37a3226e520b8d6939c30991b1c08772d5dab62b381c3a63541dc629a";
+  target_json["length"] = 100 * (1 << 20);
+
+  Uptane::Target target("large_file", target_json);
+  test_pause(target, PACKAGE_MANAGER_NONE, 4);
+}
+
+/* Fall back to a single stream if the server ignores the Range header and
+ * sends the whole file. */
+TEST(Fetcher, DownloadSegmentsNoRange) {
+  Json::Value target_json;
+  target_json["hashes"]["sha256"] = "dd7bd1c37a3226e520b8d6939c30991b1c08772d5dab62b381c3a63541dc629a";
+  target_json["length"] = 100 * (1 << 20);
+  Uptane::Target target("large_file_no_range", target_json);
+
+  TemporaryDirectory temp_dir;
+  Config segment_config = config;
+  segment_config.storage.path = temp_dir.Path();
+  segment_config.pacman.images_path = temp_dir.Path() / "images";
+  segment_config.pacman.download_segments = 4;
+  segment_config.uptane.repo_server = server;
+
+  std::shared_ptr<INvStorage> storage(new SQLStorage(segment_config.storage, false));
+  auto http = std::make_shared<HttpClient>();
+  auto pacman = std::make_shared<PackageManagerFake>(segment_config.pacman, segment_config.bootloader, storage, http);
+  KeyManager keys(storage, segment_config.keymanagerConfig());
+  Uptane::Fetcher fetcher(segment_config, http);
+
+  EXPECT_TRUE(pacman->fetchTarget(target, fetcher, keys, progress_cb, nullptr));
+  EXPECT_EQ(pacman->verifyTarget(target), TargetStatus::kGood);
+  for (const auto& entry : boost::filesystem::directory_iterator(segment_config.pacman.images_path)) {
+    EXPECT_NE(entry.path().extension(), ".segments");
+  }
+}
+
+class HttpRangeCounter : public HttpClient {
+ public:
+  std::future<HttpResponse> downloadRangeAsync(const std::string& url, curl_write_callback write_cb, void* userp,
+                                               curl_off_t from, curl_off_t to) override {
+    requested_bytes += static_cast<uint64_t>(to + 1 - from);
+    return HttpClient::downloadRangeAsync(url, write_cb, userp, from, to);
+  }
+
+  std::atomic<uint64_t> requested_bytes{0};
+};
+
+/* Resume a segmented download after a restart, from the state saved when it
+ * was aborted halfway. Only the missing ranges are downloaded again. */
+TEST(Fetcher, DownloadSegmentsResume) {
+  const uint64_t length = 100 * (1 << 20);
+  Json::Value target_json;
+  target_json["hashes"]["sha256"] = "dd7bd1c37a3226e520b8d6939c30991b1c08772d5dab62b381c3a63541dc629a";
+  target_json["length"] = static_cast<Json::UInt64>(length);
+  Uptane::Target target("large_file", target_json);
+
+  TemporaryDirectory temp_dir;
+  Config segment_config = config;
+  segment_config.storage.path = temp_dir.Path();
+  segment_config.pacman.images_path = temp_dir.Path() / "images";
+  segment_config.pacman.download_segments = 4;
+  segment_config.uptane.repo_server = server;
+  std::shared_ptr<INvStorage> storage(new SQLStorage(segment_config.storage, false));
+
+  {
+    auto http = std::make_shared<HttpRangeCounter>();
+    auto pacman = std::make_shared<PackageManagerFake>(segment_config.pacman, segment_config.bootloader, storage, http);
+    KeyManager keys(storage, segment_config.keymanagerConfig());
+    Uptane::Fetcher fetcher(segment_config, http);
+
+    api::FlowControlToken token;
+    auto abort_halfway = [&token](const Uptane::Target& t, const std::string& description, unsigned int progress) {
+      (void)t;
+      (void)description;
+      if (progress >= pause_after) {
+        token.setAbort();
+      }
+    };
+    EXPECT_FALSE(pacman->fetchTarget(target, fetcher, keys, abort_halfway, &token));
+    EXPECT_EQ(http->requested_bytes.load(), length);
+    EXPECT_TRUE(boost::filesystem::exists(pacman->checkTargetFile(target)->second + ".segments"));
+  }
+
+  auto http = std::make_shared<HttpRangeCounter>();
+  auto pacman = std::make_shared<PackageManagerFake>(segment_config.pacman, segment_config.bootloader, storage, http);
+  KeyManager keys(storage, segment_config.keymanagerConfig());
+  Uptane::Fetcher fetcher(segment_config, http);
+
+  EXPECT_TRUE(pacman->fetchTarget(target, fetcher, keys, progress_cb, nullptr));
+  EXPECT_EQ(pacman->verifyTarget(target), TargetStatus::kGood);
+  EXPECT_GT(http->requested_bytes.load(), 0U);
+  EXPECT_LT(http->requested_bytes.load(), length);
+}
+
 class HttpCustomUri : public HttpFake {
  public:
   HttpCustomUri(const boost::filesystem::path& test_dir_in) : HttpFake(test_dir_in) {}
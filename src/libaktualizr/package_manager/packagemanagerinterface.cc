@@ -1,8 +1,13 @@
 #include "libaktualizr/packagemanagerinterface.h"
 
+#include <fcntl.h>
 #include <sys/statvfs.h>
+#include <unistd.h>
 #include <boost/filesystem.hpp>
 #include <chrono>
+#include <cstring>
+#include <future>
+#include <mutex>
 
 #include "crypto/crypto.h"
 #include "crypto/keymanager.h"
@@ -98,6 +103,213 @@ static void restoreHasherState(MultiPartHasher& hasher, std::ifstream data) {
   } while (data.gcount() != 0);
 }
 
+// Segmented downloads: the target is split into byte ranges which are
+// downloaded in parallel and written in place into a preallocated file. The
+// progress of each segment is saved next to the file, so that the download can
+// be resumed. The data is hashed in file order, as soon as it is contiguous.
+static constexpr uint64_t kMinSegmentSize = 1 << 20;
+
+class SegmentedDownload {
+ public:
+  struct Segment {
+    uint64_t start;
+    uint64_t length;
+    uint64_t done;
+  };
+  struct SegmentArg {
+    SegmentedDownload* download;
+    size_t index;
+  };
+
+  SegmentedDownload(DownloadMetaStruct& ds, const std::string& path, uint64_t segments_count)
+      : ds_(ds), state_path_(path + ".segments") {
+    const uint64_t length = ds.target.length();
+    const uint64_t segment_length = (length + segments_count - 1) / segments_count;
+    for (uint64_t start = 0; start < length; start += segment_length) {
+      segments_.push_back({start, std::min(segment_length, length - start), 0});
+    }
+
+    // resume from the saved state if it matches the current layout
+    if (boost::filesystem::exists(state_path_)) {
+      const Json::Value state = Utils::parseJSONFile(state_path_);
+      if (state.isArray() && state.size() == segments_.size()) {
+        for (Json::ArrayIndex k = 0; k < state.size(); ++k) {
+          segments_[k].done = std::min(state[k].asUInt64(), segments_[k].length);
+        }
+      }
+    }
+
+    fd_ = ::open(path.c_str(), O_RDWR);
+    if (fd_ < 0 || ::ftruncate(fd_, static_cast<off_t>(length)) < 0) {
+      throw std::runtime_error("Can't preallocate file " + path + ": " + std::strerror(errno));
+    }
+    ds_.downloaded_length = 0;
+    for (const auto& s : segments_) {
+      ds_.downloaded_length += s.done;
+    }
+  }
+  ~SegmentedDownload() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+  SegmentedDownload(const SegmentedDownload&) = delete;
+  SegmentedDownload(SegmentedDownload&&) = delete;
+  SegmentedDownload& operator=(const SegmentedDownload&) = delete;
+  SegmentedDownload& operator=(SegmentedDownload&&) = delete;
+
+  // Returns false if the server does not support byte ranges
+  bool run(HttpInterface& http, const std::string& url) {
+    hashContiguous();
+
+    for (;;) {
+      std::vector<SegmentArg> args;
+      args.reserve(segments_.size());
+      std::vector<std::future<HttpResponse>> responses;
+      for (size_t k = 0; k < segments_.size(); ++k) {
+        const Segment& s = segments_[k];
+        args.push_back({this, k});
+        if (s.done == s.length) {
+          continue;
+        }
+        const auto from = static_cast<curl_off_t>(s.start + s.done);
+        const auto to = static_cast<curl_off_t>(s.start + s.length - 1);
+        responses.push_back(http.downloadRangeAsync(url, SegmentDownloadHandler, &args.back(), from, to));
+      }
+
+      // all the transfers have to be waited for before leaving, as they refer
+      // to this object
+      bool ranges_supported = true;
+      std::string error;
+      std::exception_ptr hash_error;
+      for (auto& f : responses) {
+        const HttpResponse response = f.get();
+        if (response.curl_code == CURLE_RANGE_ERROR) {
+          ranges_supported = false;
+        } else if (!response.isOk() && error.empty()) {
+          error = response.getStatusStr();
+        }
+        std::lock_guard<std::mutex> guard(mutex_);
+        try {
+          hashContiguous();
+        } catch (const std::exception&) {
+          hash_error = std::current_exception();
+        }
+      }
+
+      if (!ranges_supported) {
+        boost::filesystem::remove(state_path_);
+        return false;
+      }
+      saveState();
+      if (hash_error) {
+        std::rethrow_exception(hash_error);
+      }
+      if (interrupted_) {
+        // The transfers were stopped by the flow control token: sleep if
+        // paused, then fetch the missing ranges, or abort the download.
+        interrupted_ = false;
+        if (!ds_.token->canContinue()) {
+          throw Uptane::Exception("image", "Download of a target was aborted");
+        }
+        continue;
+      }
+      if (!error.empty()) {
+        throw Uptane::Exception("image", "Could not download file, error: " + error);
+      }
+      if (hashed_ != ds_.target.length()) {
+        throw Uptane::Exception("image", "Incomplete segmented download");
+      }
+      boost::filesystem::remove(state_path_);
+      return true;
+    }
+  }
+
+ private:
+  static size_t SegmentDownloadHandler(char* contents, size_t size, size_t nmemb, void* userp) {
+    auto* arg = static_cast<SegmentArg*>(userp);
+    SegmentedDownload& dl = *arg->download;
+    Segment& s = dl.segments_[arg->index];
+    const size_t downloaded = size * nmemb;
+    if (s.done + downloaded > s.length) {
+      return downloaded + 1;  // curl will abort if return unexpected size;
+    }
+
+    const uint64_t offset = s.start + s.done;
+    size_t written = 0;
+    while (written < downloaded) {
+      const ssize_t res = ::pwrite(dl.fd_, contents + written, downloaded - written,
+                                   static_cast<off_t>(offset + written));
+      if (res < 0) {
+        LOG_ERROR << "Can't write downloaded data: " << std::strerror(errno);
+        return 0;
+      }
+      written += static_cast<size_t>(res);
+    }
+
+    std::lock_guard<std::mutex> guard(dl.mutex_);
+    if (offset == dl.hashed_) {
+      dl.ds_.hasher().update(reinterpret_cast<const unsigned char*>(contents), downloaded);
+      dl.hashed_ += downloaded;
+    }
+    s.done += downloaded;
+    dl.ds_.downloaded_length += downloaded;
+    if (s.done == s.length) {
+      dl.saveState();
+    }
+    if (ProgressHandler(&dl.ds_, 0, 0, 0, 0) != 0) {
+      dl.interrupted_ = true;
+      return 0;
+    }
+    return downloaded;
+  }
+
+  // Feed the hasher with the data which has become contiguous with what was
+  // already hashed. Must be called with `mutex_` held while transfers are
+  // running.
+  void hashContiguous() {
+    static constexpr size_t buf_len = 64 * 1024;
+    std::array<uint8_t, buf_len> buf{};
+    for (const auto& s : segments_) {
+      const uint64_t end = s.start + s.done;
+      while (hashed_ < end) {
+        const size_t len = static_cast<size_t>(std::min<uint64_t>(buf_len, end - hashed_));
+        const ssize_t res = ::pread(fd_, buf.data(), len, static_cast<off_t>(hashed_));
+        if (res <= 0) {
+          throw std::runtime_error(std::string("Can't read back downloaded data: ") + std::strerror(errno));
+        }
+        ds_.hasher().update(buf.data(), static_cast<uint64_t>(res));
+        hashed_ += static_cast<uint64_t>(res);
+      }
+      if (s.done != s.length) {
+        break;
+      }
+    }
+  }
+
+  // Must be called with `mutex_` held while transfers are running
+  void saveState() {
+    Json::Value state(Json::arrayValue);
+    for (const auto& s : segments_) {
+      state.append(static_cast<Json::UInt64>(s.done));
+    }
+    try {
+      Utils::writeFile(state_path_, Utils::jsonToStr(state));
+    } catch (const std::exception& e) {
+      // only needed to resume the download later on
+      LOG_WARNING << "Can't save segmented download state: " << e.what();
+    }
+  }
+
+  DownloadMetaStruct& ds_;
+  boost::filesystem::path state_path_;
+  std::vector<Segment> segments_;
+  int fd_{-1};
+  uint64_t hashed_{0};
+  bool interrupted_{false};
+  std::mutex mutex_;
+};
+
 bool PackageManagerInterface::fetchTarget(const Uptane::Target& target, Uptane::Fetcher& fetcher,
                                           const KeyManager& keys, const FetcherProgressCb& progress_cb,
                                           const api::FlowControlToken* token) {
@@ -107,7 +319,11 @@ bool PackageManagerInterface::fetchTarget(const Uptane::Target& target, Uptane::
     if (target.hashes().empty()) {
       throw Uptane::Exception("image", "No hash defined for the target");
     }
-    TargetStatus exists = PackageManagerInterface::verifyTarget(target);
+    // A pending segmented download leaves a full size file behind, which must
+    // not be mistaken for a complete one.
+    auto target_file = checkTargetFile(target);
+    const bool segments_pending = target_file && boost::filesystem::exists(target_file->second + ".segments");
+    TargetStatus exists = segments_pending ? TargetStatus::kIncomplete : PackageManagerInterface::verifyTarget(target);
     if (exists == TargetStatus::kGood) {
       LOG_INFO << "Image already downloaded; skipping download";
       return true;
@@ -118,59 +334,88 @@ bool PackageManagerInterface::fetchTarget(const Uptane::Target& target, Uptane::
       ds->fhandle = createTargetFile(target);
       return true;
     }
-    if (exists == TargetStatus::kIncomplete) {
-      LOG_INFO << "Continuing incomplete download of file " << target.filename();
-      auto target_check = checkTargetFile(target);
-      ds->downloaded_length = target_check->first;
-      ::restoreHasherState(ds->hasher(), openTargetFile(target));
-      ds->fhandle = appendTargetFile(target);
-    } else {
-      // If the target was found, but is oversized or the hash doesn't match,
-      // just start over.
-      LOG_DEBUG << "Initiating download of file " << target.filename();
-      ds->fhandle = createTargetFile(target);
-    }
-
-    const uint64_t required_bytes = target.length() - ds->downloaded_length;
-    if (!checkAvailableDiskSpace(required_bytes)) {
-      throw std::runtime_error("Insufficient disk space available to download target");
-    }
 
     std::string target_url = target.uri();
     if (target_url.empty()) {
       target_url = fetcher.getRepoServer() + "/targets/" + Utils::urlEncode(target.filename());
     }
 
-    HttpResponse response;
-    for (;;) {
-      response = http_->download(target_url, DownloadHandler, ProgressHandler, ds.get(),
-                                 static_cast<curl_off_t>(ds->downloaded_length));
-
-      if (response.curl_code == CURLE_RANGE_ERROR) {
+    bool downloaded = false;
+    const uint64_t segments = std::min<uint64_t>(config.download_segments, target.length() / kMinSegmentSize);
+    if (segments > 1) {
+      if (segments_pending) {
+        LOG_INFO << "Continuing incomplete segmented download of file " << target.filename();
+      } else {
+        LOG_DEBUG << "Initiating segmented download of file " << target.filename();
+        createTargetFile(target);
+      }
+      SegmentedDownload download(*ds, checkTargetFile(target)->second, segments);
+      if (!checkAvailableDiskSpace(target.length() - ds->downloaded_length)) {
+        throw std::runtime_error("Insufficient disk space available to download target");
+      }
+      downloaded = download.run(*http_, target_url);
+      if (!downloaded) {
         LOG_WARNING << "The image server doesn't support byte range requests,"
-                       " try to download the image from the beginning: "
+                       " download the image in one piece: "
                     << target_url;
         ds = std_::make_unique<DownloadMetaStruct>(target, progress_cb, token);
+        exists = TargetStatus::kNotFound;
+      }
+    } else if (segments_pending) {
+      boost::filesystem::remove(target_file->second + ".segments");
+      exists = TargetStatus::kNotFound;
+    }
+
+    if (!downloaded) {
+      if (exists == TargetStatus::kIncomplete) {
+        LOG_INFO << "Continuing incomplete download of file " << target.filename();
+        auto target_check = checkTargetFile(target);
+        ds->downloaded_length = target_check->first;
+        ::restoreHasherState(ds->hasher(), openTargetFile(target));
+        ds->fhandle = appendTargetFile(target);
+      } else {
+        // If the target was found, but is oversized or the hash doesn't match,
+        // just start over.
+        LOG_DEBUG << "Initiating download of file " << target.filename();
         ds->fhandle = createTargetFile(target);
-        continue;
       }
 
-      if (!response.wasInterrupted()) {
-        break;
+      const uint64_t required_bytes = target.length() - ds->downloaded_length;
+      if (!checkAvailableDiskSpace(required_bytes)) {
+        throw std::runtime_error("Insufficient disk space available to download target");
       }
-      ds->fhandle.close();
-      // sleep if paused or abort the download
-      if (!token->canContinue()) {
-        throw Uptane::Exception("image", "Download of a target was aborted");
+
+      HttpResponse response;
+      for (;;) {
+        response = http_->download(target_url, DownloadHandler, ProgressHandler, ds.get(),
+                                   static_cast<curl_off_t>(ds->downloaded_length));
+
+        if (response.curl_code == CURLE_RANGE_ERROR) {
+          LOG_WARNING << "The image server doesn't support byte range requests,"
+                         " try to download the image from the beginning: "
+                      << target_url;
+          ds = std_::make_unique<DownloadMetaStruct>(target, progress_cb, token);
+          ds->fhandle = createTargetFile(target);
+          continue;
+        }
+
+        if (!response.wasInterrupted()) {
+          break;
+        }
+        ds->fhandle.close();
+        // sleep if paused or abort the download
+        if (!token->canContinue()) {
+          throw Uptane::Exception("image", "Download of a target was aborted");
+        }
+        ds->fhandle = appendTargetFile(target);
       }
-      ds->fhandle = appendTargetFile(target);
-    }
-    LOG_TRACE << "Download status: " << response.getStatusStr() << std::endl;
-    if (!response.isOk()) {
-      if (response.curl_code == CURLE_WRITE_ERROR) {
-        throw Uptane::OversizedTarget(target.filename());
+      LOG_TRACE << "Download status: " << response.getStatusStr() << std::endl;
+      if (!response.isOk()) {
+        if (response.curl_code == CURLE_WRITE_ERROR) {
+          throw Uptane::OversizedTarget(target.filename());
+        }
+        throw Uptane::Exception("image", "Could not download file, error: " + response.error_message);
       }
-      throw Uptane::Exception("image", "Could not download file, error: " + response.error_message);
     }
     if (!target.MatchHash(Hash(ds->hash_type, ds->hasher().getHexDigest()))) {
       ds->fhandle.close();
@@ -283,6 +528,7 @@ void PackageManagerInterface::removeTargetFile(const Uptane::Target& target) {
     throw std::runtime_error("File doesn't exist for target " + target.filename());
   }
   boost::filesystem::remove(file->second);
+  boost::filesystem::remove(file->second + ".segments");
   storage_->deleteTargetInfo(target.filename());
 }
 
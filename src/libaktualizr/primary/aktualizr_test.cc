@@ -2,7 +2,9 @@
 
 #include <chrono>
 #include <future>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -13,6 +15,8 @@
 #include "libaktualizr/config.h"
 #include "libaktualizr/events.h"
 
+#include "crypto/crypto.h"
+
 #include "httpfake.h"
 #include "metafake.h"
 #include "primary/aktualizr_helpers.h"
@@ -1548,6 +1552,120 @@ TEST(Aktualizr, DownloadFailures) {
   }
 }
 
+class HttpFakeParallelDownloads : public HttpFake {
+ public:
+  HttpFakeParallelDownloads(const boost::filesystem::path& test_dir_in, const boost::filesystem::path& meta_dir_in)
+      : HttpFake(test_dir_in, "noupdates", meta_dir_in) {}
+
+  void addImage(const std::string& filename, const std::string& content) { images_[filename] = content; }
+
+  HttpResponse download(const std::string& url, curl_write_callback write_cb, curl_xferinfo_callback progress_cb,
+                        void* userp, curl_off_t from) override {
+    (void)progress_cb;
+    (void)from;
+    const std::string filename = url.substr(url.rfind('/') + 1);
+    const auto image = images_.find(filename);
+    const std::string content = image == images_.end() ? "" : image->second;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      ++requests[filename];
+      max_running = std::max(max_running, ++running);
+      max_running_same_content = std::max(max_running_same_content, ++running_by_content[content]);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    HttpResponse response("", 500, CURLE_HTTP_RETURNED_ERROR, "Internal Server Error");
+    if (image != images_.end()) {
+      write_cb(const_cast<char*>(content.data()), 1, content.size(), userp);
+      response = HttpResponse(content, 200, CURLE_OK, "");
+    }
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      --running;
+      --running_by_content[content];
+    }
+    return response;
+  }
+
+  std::mutex mutex;
+  std::map<std::string, int> requests;
+  int max_running{0};
+  int max_running_same_content{0};
+
+ private:
+  std::map<std::string, std::string> images_;
+  std::map<std::string, int> running_by_content;
+  int running{0};
+};
+
+/*
+ * Download several targets at once.
+ *
+ * Checks actions:
+ * - No more than uptane.max_parallel_downloads downloads run at the same time
+ * - Targets with the same content are never downloaded at the same time
+ * - Each target gets its own DownloadTargetComplete event
+ * - A failing download does not affect the others
+ */
+TEST(Aktualizr, DownloadParallel) {
+  TemporaryDirectory temp_dir;
+  auto http = std::make_shared<HttpFakeParallelDownloads>(temp_dir.Path(), fake_meta_dir);
+  Config conf = UptaneTestCommon::makeTestConfig(temp_dir, http->tls_server);
+  conf.uptane.max_parallel_downloads = 2;
+  auto storage = INvStorage::newStorage(conf.storage);
+  UptaneTestCommon::TestAktualizr aktualizr(conf, storage, http);
+
+  std::mutex events_mutex;
+  std::map<std::string, std::vector<bool>> download_events;
+  aktualizr.SetSignalHandler([&events_mutex, &download_events](const std::shared_ptr<event::BaseEvent>& event) {
+    if (event->isTypeOf<event::DownloadTargetComplete>()) {
+      const auto download_event = dynamic_cast<event::DownloadTargetComplete*>(event.get());
+      std::lock_guard<std::mutex> guard(events_mutex);
+      download_events[download_event->update.filename()].push_back(download_event->success);
+    }
+  });
+  aktualizr.Initialize();
+
+  auto make_target = [](const std::string& filename, const std::string& content) {
+    Json::Value target_json;
+    target_json["hashes"]["sha256"] = Crypto::sha256digestHex(content);
+    target_json["length"] = static_cast<Json::UInt64>(content.size());
+    target_json["custom"]["targetFormat"] = "BINARY";
+    return Uptane::Target(filename, target_json);
+  };
+  std::vector<Uptane::Target> targets;
+  for (const std::string name : {"first.bin", "second.bin", "third.bin", "fourth.bin"}) {
+    http->addImage(name, "content of " + name);
+    targets.push_back(make_target(name, "content of " + name));
+  }
+  for (const std::string name : {"copy1.bin", "copy2.bin", "copy3.bin"}) {
+    http->addImage(name, "shared content");
+    targets.push_back(make_target(name, "shared content"));
+  }
+  targets.push_back(make_target("missing.bin", "content of missing.bin"));
+
+  const auto results = aktualizr.uptane_client()->downloadImagesParallel(targets);
+
+  ASSERT_EQ(results.size(), targets.size());
+  for (size_t k = 0; k < targets.size(); ++k) {
+    const std::string& filename = targets[k].filename();
+    const bool expected = filename != "missing.bin";
+    EXPECT_EQ(results[k].second.filename(), filename);
+    EXPECT_EQ(results[k].first, expected) << filename;
+    std::lock_guard<std::mutex> guard(events_mutex);
+    EXPECT_EQ(download_events[filename], std::vector<bool>{expected}) << filename;
+  }
+
+  std::lock_guard<std::mutex> guard(http->mutex);
+  EXPECT_EQ(http->max_running, 2);
+  EXPECT_EQ(http->max_running_same_content, 1);
+  EXPECT_EQ(http->requests["copy1.bin"], 1);
+  EXPECT_EQ(http->requests["copy2.bin"], 1);
+  EXPECT_EQ(http->requests["copy3.bin"], 1);
+  // Failed downloads are retried, and then given up on.
+  EXPECT_EQ(http->requests["missing.bin"], 3);
+}
+
 /*
  * List targets in storage via API.
  * Remove targets in storage via API.
@@ -273,6 +273,7 @@ void Provisioner::initEcuSerials() {
 
     // Check all stored Secondaries not already matched to see if any have been
     // removed. Store them in a separate table to keep track of them.
+    auto batch = storage_->beginBatch();
     std::vector<bool>::iterator found_it;
     for (found_it = found.begin(); found_it != found.end(); ++found_it) {
       if (!*found_it) {
@@ -283,37 +284,60 @@ void Provisioner::initEcuSerials() {
         storage_->saveMisconfiguredEcu({not_registered.first, not_registered.second, EcuState::kOld});
       }
     }
+    batch->commit();
   }
 }
 
 void Provisioner::initSecondaryInfo() {
   sec_info_.clear();
-  for (const auto& s : secondaries_) {
-    const Uptane::EcuSerial serial = s.first;
-    SecondaryInterface& sec = *s.second;
-
-    SecondaryInfo info;
-    // If upgrading from the older version of the storage without the
-    // secondary_ecus table, we need to migrate the data. This should be done
-    // regardless of whether we need to (re-)register the ECUs.
-    // The ECU serials should be already initialized by this point.
-    if (!storage_->loadSecondaryInfo(serial, &info) || info.type.empty() || info.pub_key.Type() == KeyType::kUnknown) {
-      info.serial = serial;
-      info.hw_id = sec.getHwId();
-      info.type = sec.Type();
-      const PublicKey& p = sec.getPublicKey();
-      if (p.Type() != KeyType::kUnknown) {
-        info.pub_key = p;
-      }
-      // If we don't need to register the ECUs, we still need to store this info
-      // to complete the migration.
-      if (!register_ecus_) {
-        storage_->saveSecondaryInfo(info.serial, info.type, info.pub_key);
+  // Secondaries are queried before the storage is locked for the batch, as
+  // getting their hardware ID and key may require network access.
+  std::vector<SecondaryInfo> migrated;
+  auto save_migrated = [this, &migrated]() {
+    if (migrated.empty()) {
+      return;
+    }
+    auto batch = storage_->beginBatch();
+    for (const auto& info : migrated) {
+      storage_->saveSecondaryInfo(info.serial, info.type, info.pub_key);
+    }
+    batch->commit();
+  };
+
+  try {
+    for (const auto& s : secondaries_) {
+      const Uptane::EcuSerial serial = s.first;
+      SecondaryInterface& sec = *s.second;
+
+      SecondaryInfo info;
+      // If upgrading from the older version of the storage without the
+      // secondary_ecus table, we need to migrate the data. This should be done
+      // regardless of whether we need to (re-)register the ECUs.
+      // The ECU serials should be already initialized by this point.
+      if (!storage_->loadSecondaryInfo(serial, &info) || info.type.empty() ||
+          info.pub_key.Type() == KeyType::kUnknown) {
+        info.serial = serial;
+        info.hw_id = sec.getHwId();
+        info.type = sec.Type();
+        const PublicKey& p = sec.getPublicKey();
+        if (p.Type() != KeyType::kUnknown) {
+          info.pub_key = p;
+        }
+        // If we don't need to register the ECUs, we still need to store this info
+        // to complete the migration.
+        if (!register_ecus_) {
+          migrated.push_back(info);
+        }
       }
+      // We will need this info later if the device is not yet provisioned
+      sec_info_.push_back(std::move(info));
     }
-    // We will need this info later if the device is not yet provisioned
-    sec_info_.push_back(std::move(info));
+  } catch (...) {
+    // Keep the info of the Secondaries that did answer
+    save_migrated();
+    throw;
   }
+  save_migrated();
 }
 
 // Postcondition: "ECUs registered" flag set in the storage
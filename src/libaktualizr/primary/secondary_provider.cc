@@ -102,3 +102,11 @@ std::string SecondaryProvider::getTreehubCredentials() const {
 std::ifstream SecondaryProvider::getTargetFileHandle(const Uptane::Target& target) const {
   return package_manager_->openTargetFile(target);
 }
+
+std::string SecondaryProvider::getTargetFilePath(const Uptane::Target& target) const {
+  auto target_file = package_manager_->checkTargetFile(target);
+  if (!target_file) {
+    return "";
+  }
+  return target_file->second;
+}
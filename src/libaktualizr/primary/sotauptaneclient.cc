@@ -50,6 +50,8 @@ SotaUptaneClient::SotaUptaneClient(Config &config_in, std::shared_ptr<INvStorage
       flow_control_(flow_control) {
   report_queue = std_::make_unique<ReportQueue>(config, http, storage);
   secondary_provider_ = SecondaryProviderBuilder::Build(config, storage, package_manager_);
+  director_repo.setMaxParallelVerifications(config.uptane.max_parallel_verifications);
+  image_repo.setMaxParallelVerifications(config.uptane.max_parallel_verifications);
 }
 
 void SotaUptaneClient::addSecondary(const std::shared_ptr<SecondaryInterface> &sec) {
@@ -321,11 +323,23 @@ Json::Value SotaUptaneClient::AssembleManifest() {
   }
   version_manifest[primary_ecu_serial.ToString()] = uptane_manifest->sign(primary_manifest, report_counter);
 
-  for (auto it = secondaries.begin(); it != secondaries.end(); it++) {
-    const Uptane::EcuSerial &ecu_serial = it->first;
+  // Ask all the Secondaries at once, so that one that is offline does not
+  // hold up the others. The results are merged in order of ECU serial.
+  struct SecondaryManifest {
+    Uptane::Manifest manifest;  // Empty if none could be verified
+    bool from_cache{false};
+  };
+  std::vector<std::pair<Uptane::EcuSerial, SecondaryInterface *>> ecus;
+  for (const auto &sec : secondaries) {
+    ecus.emplace_back(sec.first, sec.second.get());
+  }
+  std::vector<SecondaryManifest> sec_manifests(ecus.size());
+  forEachSecondaryTask(ecus.size(), [this, &ecus, &sec_manifests](size_t k) {
+    const Uptane::EcuSerial &ecu_serial = ecus[k].first;
+    SecondaryInterface &secondary = *ecus[k].second;
     Uptane::Manifest secmanifest;
     try {
-      secmanifest = it->second->getManifest();
+      secmanifest = secondary.getManifest();
     } catch (const std::exception &ex) {
       // Not critical; it might just be temporarily offline.
       LOG_DEBUG << "Failed to get manifest from Secondary with serial " << ecu_serial << ": " << ex.what();
@@ -341,26 +355,36 @@ Json::Value SotaUptaneClient::AssembleManifest() {
         from_cache = true;
       } else {
         LOG_ERROR << "Failed to get a valid manifest from Secondary with serial " << ecu_serial << " or from cache!";
-        continue;
+        return;
       }
     }
 
     bool verified = false;
     try {
-      verified = secmanifest.verifySignature(it->second->getPublicKey());
+      verified = secmanifest.verifySignature(secondary.getPublicKey());
     } catch (const std::exception &ex) {
       LOG_ERROR << "Failed to get public key from Secondary with serial " << ecu_serial << ": " << ex.what();
     }
     if (verified) {
-      version_manifest[ecu_serial.ToString()] = secmanifest;
-      if (!from_cache) {
-        storage->storeCachedEcuManifest(ecu_serial, Utils::jsonToCanonicalStr(secmanifest));
-      }
+      sec_manifests[k].manifest = secmanifest;
+      sec_manifests[k].from_cache = from_cache;
     } else {
       // TODO(OTA-4305): send a corresponding event/report in this case
       LOG_ERROR << "Invalid manifest or signature reported by Secondary: "
                 << " serial: " << ecu_serial << " manifest: " << secmanifest;
     }
+  });
+
+  for (size_t k = 0; k < ecus.size(); ++k) {
+    const Uptane::EcuSerial &ecu_serial = ecus[k].first;
+    const SecondaryManifest &secmanifest = sec_manifests[k];
+    if (secmanifest.manifest.empty()) {
+      continue;
+    }
+    version_manifest[ecu_serial.ToString()] = secmanifest.manifest;
+    if (!secmanifest.from_cache) {
+      storage->storeCachedEcuManifest(ecu_serial, Utils::jsonToCanonicalStr(secmanifest.manifest));
+    }
   }
   manifest["ecu_version_manifests"] = version_manifest;
 
@@ -685,6 +709,7 @@ result::Download SotaUptaneClient::downloadImages(const std::vector<Uptane::Targ
   try {
     update_status = checkUpdatesOffline(targets);
   } catch (const std::exception &e) {
+    std::lock_guard<std::mutex> exception_guard(last_exception_mutex);
     last_exception = std::current_exception();
     update_status = result::UpdateStatus::kError;
   }
@@ -702,8 +727,7 @@ result::Download SotaUptaneClient::downloadImages(const std::vector<Uptane::Targ
     return result;
   }
 
-  for (const auto &target : targets) {
-    auto res = downloadImage(target);
+  for (const auto &res : downloadImagesParallel(targets)) {
     if (res.first) {
       downloaded_targets.push_back(res.second);
     }
@@ -727,6 +751,38 @@ result::Download SotaUptaneClient::downloadImages(const std::vector<Uptane::Targ
   return result;
 }
 
+std::vector<std::pair<bool, Uptane::Target>> SotaUptaneClient::downloadImagesParallel(
+    const std::vector<Uptane::Target> &targets) {
+  std::vector<std::pair<bool, Uptane::Target>> results;
+  results.reserve(targets.size());
+  // Targets with the same content are stored in the same file: download them
+  // one after the other so that two workers never write that file at once.
+  std::vector<std::vector<size_t>> groups;
+  std::map<std::string, size_t> group_by_hash;
+  for (size_t k = 0; k < targets.size(); ++k) {
+    results.emplace_back(false, targets[k]);
+    const std::string hash = targets[k].hashes().empty() ? "" : targets[k].hashes()[0].HashString();
+    auto it = group_by_hash.find(hash);
+    if (hash.empty() || it == group_by_hash.end()) {
+      group_by_hash.emplace(hash, groups.size());
+      groups.push_back({k});
+    } else {
+      groups[it->second].push_back(k);
+    }
+  }
+
+  Utils::parallelFor(groups.size(), config.uptane.max_parallel_downloads, [&](size_t g) {
+    for (const size_t k : groups[g]) {
+      results[k] = downloadImage(targets[k]);
+    }
+  });
+  return results;
+}
+
+void SotaUptaneClient::forEachSecondaryTask(size_t count, const std::function<void(size_t)> &task) {
+  Utils::parallelFor(count, config.uptane.max_parallel_secondaries, task);
+}
+
 void SotaUptaneClient::reportPause() {
   auto correlation_id = director_repo.getCorrelationId();
   report_queue->enqueue(std_::make_unique<DevicePausedReport>(correlation_id));
@@ -787,6 +843,7 @@ std::pair<bool, Uptane::Target> SotaUptaneClient::downloadImage(const Uptane::Ta
     }
   } catch (const std::exception &e) {
     LOG_ERROR << "Error downloading image: " << e.what();
+    std::lock_guard<std::mutex> exception_guard(last_exception_mutex);
     last_exception = std::current_exception();
   }
 
@@ -902,6 +959,7 @@ result::UpdateCheck SotaUptaneClient::checkUpdates() {
   try {
     uptaneIteration(&updates, &ecus_count);
   } catch (const std::exception &e) {
+    std::lock_guard<std::mutex> exception_guard(last_exception_mutex);
     last_exception = std::current_exception();
     result = result::UpdateCheck({}, 0, result::UpdateStatus::kError, Json::nullValue, "Could not update metadata.");
     return result;
@@ -939,6 +997,7 @@ result::UpdateCheck SotaUptaneClient::checkUpdates() {
       }
     }
   } catch (const std::exception &e) {
+    std::lock_guard<std::mutex> exception_guard(last_exception_mutex);
     last_exception = std::current_exception();
     LOG_ERROR << e.what();
     result = result::UpdateCheck({}, 0, result::UpdateStatus::kError, Utils::parseJSON(director_targets),
@@ -1024,6 +1083,7 @@ result::Install SotaUptaneClient::uptaneInstall(const std::vector<Uptane::Target
     try {
       update_status = checkUpdatesOffline(updates);
     } catch (const std::exception &e) {
+      std::lock_guard<std::mutex> exception_guard(last_exception_mutex);
       last_exception = std::current_exception();
       update_status = result::UpdateStatus::kError;
     }
@@ -1354,38 +1414,67 @@ void SotaUptaneClient::sendMetadataToEcus(const std::vector<Uptane::Target> &tar
                                           std::string *raw_installation_report) {
   data::InstallationResult final_result{data::ResultCode::Numeric::kOk, ""};
   std::string result_code_err_str;
+
+  // One task per Secondary, which goes through its targets in order. The
+  // Secondaries are updated in parallel.
+  struct MetadataPush {
+    const Uptane::Target *target;
+    Uptane::HardwareIdentifier hw_id;
+    data::InstallationResult result;
+  };
+  std::vector<std::pair<SecondaryInterface *, std::vector<MetadataPush>>> pushes;
+  std::map<Uptane::EcuSerial, size_t> push_index;
   for (const auto &target : targets) {
     for (const auto &ecu : target.ecus()) {
-      const Uptane::EcuSerial ecu_serial = ecu.first;
-      const Uptane::HardwareIdentifier hw_id = ecu.second;
-      auto sec = secondaries.find(ecu_serial);
+      auto sec = secondaries.find(ecu.first);
       if (sec == secondaries.end()) {
         continue;
       }
+      auto it = push_index.emplace(ecu.first, pushes.size()).first;
+      if (it->second == pushes.size()) {
+        pushes.emplace_back(sec->second.get(), std::vector<MetadataPush>{});
+      }
+      pushes[it->second].second.push_back({&target, ecu.second, data::InstallationResult()});
+    }
+  }
 
-      data::InstallationResult local_result{data::ResultCode::Numeric::kOk, ""};
+  forEachSecondaryTask(pushes.size(), [this, &pushes](size_t k) {
+    SecondaryInterface &secondary = *pushes[k].first;
+    for (auto &push : pushes[k].second) {
+      data::InstallationResult &local_result = push.result;
       do {
         /* Root rotation if necessary */
-        local_result = rotateSecondaryRoot(Uptane::RepositoryType::Director(), *(sec->second));
+        local_result = rotateSecondaryRoot(Uptane::RepositoryType::Director(), secondary);
         if (!local_result.isSuccess()) {
-          final_result = local_result;
           break;
         }
-        local_result = rotateSecondaryRoot(Uptane::RepositoryType::Image(), *(sec->second));
+        local_result = rotateSecondaryRoot(Uptane::RepositoryType::Image(), secondary);
         if (!local_result.isSuccess()) {
-          final_result = local_result;
           break;
         }
         try {
-          local_result = sec->second->putMetadata(target);
+          local_result = secondary.putMetadata(*push.target);
         } catch (const std::exception &ex) {
           local_result = data::InstallationResult(data::ResultCode::Numeric::kInternalError, ex.what());
         }
       } while (false);
-      if (!local_result.isSuccess()) {
-        LOG_ERROR << "Sending metadata to " << sec->first << " failed: " << local_result.result_code << " "
-                  << local_result.description;
-        const std::string ecu_code_str = hw_id.ToString() + ":" + local_result.result_code.ToString();
+    }
+  });
+
+  // Report the failures in the order of the targets, as before
+  for (const auto &target : targets) {
+    for (const auto &ecu : target.ecus()) {
+      auto it = push_index.find(ecu.first);
+      if (it == push_index.end()) {
+        continue;
+      }
+      for (const auto &push : pushes[it->second].second) {
+        if (push.target != &target || push.result.isSuccess()) {
+          continue;
+        }
+        LOG_ERROR << "Sending metadata to " << ecu.first << " failed: " << push.result.result_code << " "
+                  << push.result.description;
+        const std::string ecu_code_str = push.hw_id.ToString() + ":" + push.result.result_code.ToString();
         result_code_err_str += (!result_code_err_str.empty() ? "|" : "") + ecu_code_str;
       }
     }
@@ -1406,41 +1495,37 @@ void SotaUptaneClient::sendMetadataToEcus(const std::vector<Uptane::Target> &tar
   }
 }
 
-std::future<data::InstallationResult> SotaUptaneClient::sendFirmwareAsync(SecondaryInterface &secondary,
-                                                                          const Uptane::Target &target) {
-  auto f = [this, &secondary, target]() {
-    auto correlation_id = director_repo.getCorrelationId();
+data::InstallationResult SotaUptaneClient::sendFirmwareToEcu(SecondaryInterface &secondary,
+                                                             const Uptane::Target &target) {
+  auto correlation_id = director_repo.getCorrelationId();
 
-    sendEvent<event::InstallStarted>(secondary.getSerial());
-    report_queue->enqueue(std_::make_unique<EcuInstallationStartedReport>(secondary.getSerial(), correlation_id));
+  sendEvent<event::InstallStarted>(secondary.getSerial());
+  report_queue->enqueue(std_::make_unique<EcuInstallationStartedReport>(secondary.getSerial(), correlation_id));
 
-    data::InstallationResult result;
-    try {
-      result = secondary.sendFirmware(target, flow_control_);
-      if (result.isSuccess()) {
-        result = secondary.install(target, flow_control_);
-      }
-    } catch (const std::exception &ex) {
-      result = data::InstallationResult(data::ResultCode::Numeric::kInternalError, ex.what());
-    }
-
-    if (result.result_code == data::ResultCode::Numeric::kNeedCompletion) {
-      report_queue->enqueue(std_::make_unique<EcuInstallationAppliedReport>(secondary.getSerial(), correlation_id));
-    } else {
-      report_queue->enqueue(
-          std_::make_unique<EcuInstallationCompletedReport>(secondary.getSerial(), correlation_id, result.isSuccess()));
+  data::InstallationResult result;
+  try {
+    result = secondary.sendFirmware(target, flow_control_);
+    if (result.isSuccess()) {
+      result = secondary.install(target, flow_control_);
     }
+  } catch (const std::exception &ex) {
+    result = data::InstallationResult(data::ResultCode::Numeric::kInternalError, ex.what());
+  }
 
-    sendEvent<event::InstallTargetComplete>(secondary.getSerial(), result.isSuccess());
-    return result;
-  };
+  if (result.result_code == data::ResultCode::Numeric::kNeedCompletion) {
+    report_queue->enqueue(std_::make_unique<EcuInstallationAppliedReport>(secondary.getSerial(), correlation_id));
+  } else {
+    report_queue->enqueue(
+        std_::make_unique<EcuInstallationCompletedReport>(secondary.getSerial(), correlation_id, result.isSuccess()));
+  }
 
-  return std::async(std::launch::async, f);
+  sendEvent<event::InstallTargetComplete>(secondary.getSerial(), result.isSuccess());
+  return result;
 }
 
 std::vector<result::Install::EcuReport> SotaUptaneClient::sendImagesToEcus(const std::vector<Uptane::Target> &targets) {
   std::vector<result::Install::EcuReport> reports;
-  std::vector<std::pair<result::Install::EcuReport, std::future<data::InstallationResult>>> firmwareFutures;
+  std::vector<std::pair<result::Install::EcuReport, SecondaryInterface *>> firmware_sends;
 
   const Uptane::EcuSerial &primary_ecu_serial = primaryEcuSerial();
   // target images should already have been downloaded to metadata_path/targets/
@@ -1458,29 +1543,40 @@ std::vector<result::Install::EcuReport> SotaUptaneClient::sendImagesToEcus(const
         continue;
       }
 
-      SecondaryInterface &sec = *f->second;
-      firmwareFutures.emplace_back(result::Install::EcuReport(*targets_it, ecu_serial, data::InstallationResult()),
-                                   sendFirmwareAsync(sec, *targets_it));
+      firmware_sends.emplace_back(result::Install::EcuReport(*targets_it, ecu_serial, data::InstallationResult()),
+                                  f->second.get());
     }
   }
 
-  for (auto &f : firmwareFutures) {
-    data::InstallationResult fut_result = f.second.get();
-
-    if (fut_result.isSuccess() || fut_result.result_code == data::ResultCode::Numeric::kNeedCompletion) {
-      auto update_mode =
-          fut_result.isSuccess() ? InstalledVersionUpdateMode::kCurrent : InstalledVersionUpdateMode::kPending;
-      storage->saveInstalledVersion(f.first.serial.ToString(), f.first.update, update_mode,
-                                    director_repo.getCorrelationId());
-    }
+  // Each result is stored as soon as its Secondary is done, so that it is not
+  // lost if the process stops while the other Secondaries are still updating.
+  forEachSecondaryTask(firmware_sends.size(), [this, &firmware_sends](size_t k) {
+    auto &send = firmware_sends[k];
+    send.first.install_res = sendFirmwareToEcu(*send.second, send.first.update);
+    storeEcuInstallationResult(send.first);
+  });
 
-    f.first.install_res = fut_result;
-    storage->saveEcuInstallationResult(f.first.serial, f.first.install_res);
+  reports.reserve(firmware_sends.size());
+  for (auto &f : firmware_sends) {
     reports.push_back(f.first);
   }
   return reports;
 }
 
+void SotaUptaneClient::storeEcuInstallationResult(const result::Install::EcuReport &report) {
+  const data::InstallationResult &install_res = report.install_res;
+  // The installed version and the installation result of an ECU are updated together
+  auto batch = storage->beginBatch();
+  if (install_res.isSuccess() || install_res.result_code == data::ResultCode::Numeric::kNeedCompletion) {
+    auto update_mode =
+        install_res.isSuccess() ? InstalledVersionUpdateMode::kCurrent : InstalledVersionUpdateMode::kPending;
+    storage->saveInstalledVersion(report.serial.ToString(), report.update, update_mode,
+                                  director_repo.getCorrelationId());
+  }
+  storage->saveEcuInstallationResult(report.serial, install_res);
+  batch->commit();
+}
+
 Uptane::LazyTargetsList SotaUptaneClient::allTargets() const {
   return Uptane::LazyTargetsList(image_repo, storage, uptane_fetcher, flow_control_);
 }
@@ -1,6 +1,7 @@
 #ifndef SOTA_UPTANE_CLIENT_H_
 #define SOTA_UPTANE_CLIENT_H_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -97,6 +98,7 @@ class SotaUptaneClient {
   FRIEND_TEST(Aktualizr, FullMultipleSecondaries);
   FRIEND_TEST(Aktualizr, CheckNoUpdates);
   FRIEND_TEST(Aktualizr, DownloadWithUpdates);
+  FRIEND_TEST(Aktualizr, DownloadParallel);
   FRIEND_TEST(Aktualizr, FinalizationFailure);
   FRIEND_TEST(Aktualizr, InstallationFailure);
   FRIEND_TEST(Aktualizr, AutoRebootAfterUpdate);
@@ -117,6 +119,10 @@ class SotaUptaneClient {
   FRIEND_TEST(UptaneNetwork, DownloadFailure);
   FRIEND_TEST(UptaneNetwork, LogConnectivityRestored);
   FRIEND_TEST(UptaneOstree, InitialManifest);
+  FRIEND_TEST(UptaneParallelSecondaries, AssembleManifest);
+  FRIEND_TEST(UptaneParallelSecondaries, SendImages);
+  FRIEND_TEST(UptaneParallelSecondaries, SendMetadata);
+  FRIEND_TEST(UptaneParallelSecondaries, MaxParallel);
   FRIEND_TEST(UptaneVector, Test);
   FRIEND_TEST(aktualizr_secondary_uptane, credentialsPassing);
   FRIEND_TEST(MetadataExpirationTest, MetadataExpirationAfterInstallationAndBeforeApplication);
@@ -145,7 +151,10 @@ class SotaUptaneClient {
   result::UpdateCheck checkUpdates();
   result::UpdateStatus checkUpdatesOffline(const std::vector<Uptane::Target> &targets);
   Json::Value AssembleManifest();
-  std::exception_ptr getLastException() const { return last_exception; }
+  std::exception_ptr getLastException() const {
+    std::lock_guard<std::mutex> guard(last_exception_mutex);
+    return last_exception;
+  }
   Uptane::Target getCurrent() const { return package_manager_->getCurrent(); }
 
   static std::vector<Uptane::Target> findForEcu(const std::vector<Uptane::Target> &targets,
@@ -166,8 +175,13 @@ class SotaUptaneClient {
   data::InstallationResult rotateSecondaryRoot(Uptane::RepositoryType repo, SecondaryInterface &secondary);
   void sendMetadataToEcus(const std::vector<Uptane::Target> &targets, data::InstallationResult *result,
                           std::string *raw_installation_report);
-  std::future<data::InstallationResult> sendFirmwareAsync(SecondaryInterface &secondary, const Uptane::Target &target);
+  data::InstallationResult sendFirmwareToEcu(SecondaryInterface &secondary, const Uptane::Target &target);
+  // Calls task(0) ... task(count - 1) on up to uptane.max_parallel_secondaries
+  // threads and returns when all of them have finished.
+  void forEachSecondaryTask(size_t count, const std::function<void(size_t)> &task);
   std::vector<result::Install::EcuReport> sendImagesToEcus(const std::vector<Uptane::Target> &targets);
+  void storeEcuInstallationResult(const result::Install::EcuReport &report);
+  std::vector<std::pair<bool, Uptane::Target>> downloadImagesParallel(const std::vector<Uptane::Target> &targets);
 
   bool putManifestSimple(const Json::Value &custom = Json::nullValue);
   void getNewTargets(std::vector<Uptane::Target> *new_targets, unsigned int *ecus_count = nullptr);
@@ -209,6 +223,7 @@ class SotaUptaneClient {
   std::shared_ptr<SecondaryProvider> secondary_provider_;
   std::shared_ptr<event::Channel> events_channel;
   std::exception_ptr last_exception;
+  mutable std::mutex last_exception_mutex;
   // ecu_serial => secondary*
   std::map<Uptane::EcuSerial, SecondaryInterface::Ptr> secondaries;
   std::mutex download_mutex;
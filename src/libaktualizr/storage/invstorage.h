@@ -36,6 +36,20 @@ struct MisconfiguredEcu {
 
 enum class InstalledVersionUpdateMode { kNone, kCurrent, kPending };
 
+// Groups all the writes made by the calling thread during its lifetime into a
+// single transaction, see `INvStorage::beginBatch()`. They are persisted by
+// `commit()` and discarded if the batch is destroyed without committing.
+class StorageBatch {
+ public:
+  StorageBatch() = default;
+  virtual ~StorageBatch() = default;
+  StorageBatch(const StorageBatch&) = delete;
+  StorageBatch(StorageBatch&&) = delete;
+  StorageBatch& operator=(const StorageBatch&) = delete;
+  StorageBatch& operator=(StorageBatch&&) = delete;
+  virtual void commit() = 0;
+};
+
 // Functions loading/storing multiple pieces of data are supposed to do so
 // atomically as far as implementation makes it possible.
 //
@@ -79,6 +93,12 @@ class INvStorage {
   virtual void storeNonRoot(const std::string& data, Uptane::RepositoryType repo, Uptane::Role role) = 0;
   virtual bool loadNonRoot(std::string* data, Uptane::RepositoryType repo, Uptane::Role role) const = 0;
   virtual void clearNonRootMeta(Uptane::RepositoryType repo) = 0;
+  // Validators describe the stored copy of a role: storing a new copy with
+  // storeNonRoot() drops them.
+  virtual void storeMetaValidators(const Uptane::MetaValidators& validators, Uptane::RepositoryType repo,
+                                   Uptane::Role role) = 0;
+  virtual bool loadMetaValidators(Uptane::MetaValidators* validators, Uptane::RepositoryType repo,
+                                  Uptane::Role role) const = 0;
   virtual void clearMetadata() = 0;
   virtual void storeDelegation(const std::string& data, Uptane::Role role) = 0;
   virtual bool loadDelegation(std::string* data, Uptane::Role role) const = 0;
@@ -149,6 +169,10 @@ class INvStorage {
   virtual std::vector<std::string> getAllTargetNames() const = 0;
   virtual void deleteTargetInfo(const std::string& targetname) const = 0;
 
+  // Batches of writes. Other threads wait for the batch to be over before
+  // accessing the storage, so it should not be kept across long operations.
+  virtual std::unique_ptr<StorageBatch> beginBatch() = 0;
+
   // Special constructors and utilities
   static std::shared_ptr<INvStorage> newStorage(const StorageConfig& config, bool readonly = false);
   static void FSSToSQLS(FSStorageRead& fs_storage, SQLStorage& sql_storage);
@@ -6,6 +6,8 @@
 #include <mutex>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/optional.hpp>
@@ -16,6 +18,8 @@
 
 // Unique ownership SQLite3 statement creation
 
+// Blob argument: the referenced content is not copied and must outlive the
+// statement
 struct SQLBlob {
   const std::string& content;
   explicit SQLBlob(const std::string& str) : content(str) {}
@@ -31,20 +35,72 @@ class SQLInternalException : public SQLException {
   explicit SQLInternalException(const std::string& what = "SQL internal error") : SQLException(what) {}
 };
 
+// Long-lived SQLite3 connection, with a cache of compiled statements keyed by
+// their SQL text. Not thread-safe: users must serialize access to it.
+class SQLite3Connection {
+ public:
+  explicit SQLite3Connection(std::shared_ptr<sqlite3> handle) : handle_(std::move(handle)) {}
+  ~SQLite3Connection() {
+    for (auto& s : statements_) {
+      sqlite3_finalize(s.second);
+    }
+  }
+  SQLite3Connection(const SQLite3Connection&) = delete;
+  SQLite3Connection(SQLite3Connection&&) = delete;
+  SQLite3Connection& operator=(const SQLite3Connection&) = delete;
+  SQLite3Connection& operator=(SQLite3Connection&&) = delete;
+
+  sqlite3* get() const { return handle_.get(); }
+  std::shared_ptr<sqlite3> handle() const { return handle_; }
+
+  // Number of guards currently borrowing the connection (nested on one thread)
+  int users() const { return users_; }
+  void acquire() { ++users_; }
+  void release() { --users_; }
+
+  // Take a cached statement out of the cache, nullptr if there is none
+  sqlite3_stmt* takeStatement(const std::string& zSql) {
+    auto it = statements_.find(zSql);
+    if (it == statements_.end()) {
+      return nullptr;
+    }
+    sqlite3_stmt* statement = it->second;
+    statements_.erase(it);
+    return statement;
+  }
+
+  // Give a statement back for later reuse. If the same query is already
+  // cached (it was prepared twice concurrently), the statement is finalized.
+  void releaseStatement(sqlite3_stmt* statement) {
+    sqlite3_reset(statement);
+    sqlite3_clear_bindings(statement);
+    if (!statements_.emplace(sqlite3_sql(statement), statement).second) {
+      sqlite3_finalize(statement);
+    }
+  }
+
+ private:
+  std::shared_ptr<sqlite3> handle_;
+  std::unordered_map<std::string, sqlite3_stmt*> statements_;
+  int users_{0};
+};
+
 class SQLiteStatement {
  public:
   template <typename... Types>
-  SQLiteStatement(sqlite3* db, const std::string& zSql, const Types&... args)
-      : db_(db), stmt_(nullptr, sqlite3_finalize), bind_cnt_(1) {
-    sqlite3_stmt* statement;
+  SQLiteStatement(sqlite3* db, const std::string& zSql, std::shared_ptr<SQLite3Connection> connection,
+                  Types&&... args)
+      : db_(db), stmt_(nullptr, StatementReleaser{std::move(connection)}), bind_cnt_(1) {
+    const auto& cache = stmt_.get_deleter().connection;
+    sqlite3_stmt* statement = (cache != nullptr) ? cache->takeStatement(zSql) : nullptr;
 
-    if (sqlite3_prepare_v2(db_, zSql.c_str(), -1, &statement, nullptr) != SQLITE_OK) {
+    if (statement == nullptr && sqlite3_prepare_v2(db_, zSql.c_str(), -1, &statement, nullptr) != SQLITE_OK) {
       LOG_ERROR << "Could not prepare statement: " << sqlite3_errmsg(db_);
       throw SQLInternalException(std::string("Could not prepare statement: ") + sqlite3_errmsg(db_));
     }
     stmt_.reset(statement);
 
-    bindArguments(args...);
+    bindArguments(std::forward<Types>(args)...);
   }
 
   inline sqlite3_stmt* get() const { return stmt_.get(); }
@@ -71,6 +127,19 @@ class SQLiteStatement {
   inline int64_t get_result_col_int(int iCol) { return sqlite3_column_int64(stmt_.get(), iCol); }
 
  private:
+  // Finalizes the statement or, if it comes from a connection cache, hands it
+  // back to the cache
+  struct StatementReleaser {
+    std::shared_ptr<SQLite3Connection> connection;
+    void operator()(sqlite3_stmt* statement) const {
+      if (connection != nullptr) {
+        connection->releaseStatement(statement);
+      } else {
+        sqlite3_finalize(statement);
+      }
+    }
+  };
+
   void bindArgument(int v) {
     if (sqlite3_bind_int(stmt_.get(), bind_cnt_, v) != SQLITE_OK) {
       LOG_ERROR << "Could not bind: " << sqlite3_errmsg(db_);
@@ -85,59 +154,62 @@ class SQLiteStatement {
     }
   }
 
-  void bindArgument(const std::string& v) {
-    owned_data_.push_back(v);
-    const std::string& oe = owned_data_.back();
+  // Strings passed as lvalues are owned by the caller and outlive the
+  // statement: they are bound without copy
+  void bindArgument(const std::string& v) { bindText(v.c_str(), static_cast<int>(v.size())); }
 
-    if (sqlite3_bind_text(stmt_.get(), bind_cnt_, oe.c_str(), -1, nullptr) != SQLITE_OK) {
-      LOG_ERROR << "Could not bind: " << sqlite3_errmsg(db_);
-      throw SQLInternalException(std::string("SQLite bind error: ") + sqlite3_errmsg(db_));
-    }
+  // Temporaries have to be kept alive until the statement is done
+  void bindArgument(std::string&& v) {
+    owned_data_.push_back(std::move(v));
+    bindArgument(owned_data_.back());
   }
 
-  void bindArgument(const char* v) { bindArgument(std::string(v)); }
+  void bindArgument(const char* v) { bindText(v, -1); }
 
+  // The blob content is owned by the caller, see `SQLBlob`
   void bindArgument(const SQLBlob& blob) {
-    owned_data_.emplace_back(blob.content);
-    const std::string& oe = owned_data_.back();
-
-    if (sqlite3_bind_blob(stmt_.get(), bind_cnt_, oe.c_str(), static_cast<int>(oe.size()), SQLITE_STATIC) !=
-        SQLITE_OK) {
+    if (sqlite3_bind_blob(stmt_.get(), bind_cnt_, blob.content.c_str(), static_cast<int>(blob.content.size()),
+                          SQLITE_STATIC) != SQLITE_OK) {
       LOG_ERROR << "Could not bind: " << sqlite3_errmsg(db_);
       throw SQLInternalException("SQLite bind error");
     }
   }
 
+  void bindText(const char* v, int len) {
+    if (sqlite3_bind_text(stmt_.get(), bind_cnt_, v, len, SQLITE_STATIC) != SQLITE_OK) {
+      LOG_ERROR << "Could not bind: " << sqlite3_errmsg(db_);
+      throw SQLInternalException(std::string("SQLite bind error: ") + sqlite3_errmsg(db_));
+    }
+  }
+
   /* end of template specialization */
   void bindArguments() {}
 
   template <typename T, typename... Types>
-  void bindArguments(const T& v, const Types&... args) {
-    bindArgument(v);
+  void bindArguments(T&& v, Types&&... args) {
+    bindArgument(std::forward<T>(v));
     bind_cnt_ += 1;
-    bindArguments(args...);
+    bindArguments(std::forward<Types>(args)...);
   }
 
   sqlite3* db_;
-  std::unique_ptr<sqlite3_stmt, int (*)(sqlite3_stmt*)> stmt_;
+  std::unique_ptr<sqlite3_stmt, StatementReleaser> stmt_;
   int bind_cnt_;  // NOLINT
-  // copies of data that need to persist for the object duration
+  // temporaries that need to persist for the object duration
   // (avoid vector because of resizing issues)
   std::list<std::string> owned_data_;
 };
 
-// Unique ownership SQLite3 connection
+// Access to an SQLite3 connection, either owned or borrowed from a long-lived
+// `SQLite3Connection`
 const extern std::mutex sql_mutex;
 class SQLite3Guard {
  public:
   sqlite3* get() { return handle_.get(); }
+  std::shared_ptr<sqlite3> handle() const { return handle_; }
   int get_rc() const { return rc_; }
 
-  explicit SQLite3Guard(const char* path, bool readonly, std::shared_ptr<std::mutex> mutex = nullptr)
-      : handle_(nullptr, sqlite3_close), rc_(0), m_(std::move(mutex)) {
-    if (m_) {
-      m_->lock();
-    }
+  explicit SQLite3Guard(const char* path, bool readonly = false) : rc_(0) {
     if (sqlite3_threadsafe() == 0) {
       throw SQLInternalException("sqlite3 has been compiled without multitheading support");
     }
@@ -151,16 +223,42 @@ class SQLite3Guard {
     /* retry operations for 2 seconds before returning SQLITE_BUSY */
     sqlite3_busy_timeout(h, 2000);
 
-    handle_.reset(h);
+    handle_.reset(h, sqlite3_close);
+  }
+
+  explicit SQLite3Guard(const boost::filesystem::path& path, bool readonly = false)
+      : SQLite3Guard(path.c_str(), readonly) {}
+
+  // Borrow an already opened connection. `lock` protects it for the lifetime of
+  // the guard: the connection is only ever used by one thread at a time. Guards
+  // on the same thread can be nested, see `beginTransaction()`.
+  SQLite3Guard(std::shared_ptr<SQLite3Connection> connection, std::unique_lock<std::recursive_mutex> lock)
+      : handle_(connection->handle()), connection_(std::move(connection)), rc_(SQLITE_OK), lock_(std::move(lock)) {
+    connection_->acquire();
   }
 
-  explicit SQLite3Guard(const boost::filesystem::path& path, bool readonly = false,
-                        std::shared_ptr<std::mutex> mutex = nullptr)
-      : SQLite3Guard(path.c_str(), readonly, std::move(mutex)) {}
-  SQLite3Guard(SQLite3Guard&& guard) noexcept : handle_(std::move(guard.handle_)), rc_(guard.rc_) {}
+  SQLite3Guard(SQLite3Guard&& guard) noexcept
+      : handle_(std::move(guard.handle_)),
+        connection_(std::move(guard.connection_)),
+        rc_(guard.rc_),
+        transaction_(guard.transaction_),
+        lock_(std::move(guard.lock_)) {
+    guard.transaction_ = Transaction::kNone;
+  }
   ~SQLite3Guard() {
-    if (m_) {
-      m_->unlock();
+    // A borrowed connection outlives the guard, so a transaction that was not
+    // committed has to be rolled back explicitly here.
+    // Transactions opened behind our back (e.g. by a migration script) are
+    // rolled back by the outermost guard.
+    const bool stray = transaction_ == Transaction::kNone && connection_ && connection_->users() == 1 &&
+                       sqlite3_get_autocommit(handle_.get()) == 0;
+    if (transaction_ != Transaction::kNone || stray) {
+      if (exec(rollbackStatement(), nullptr, nullptr) != SQLITE_OK) {
+        LOG_ERROR << "Can't rollback transaction: " << errmsg();
+      }
+    }
+    if (connection_) {
+      connection_->release();
     }
   }
   SQLite3Guard(const SQLite3Guard& guard) = delete;
@@ -175,9 +273,12 @@ class SQLite3Guard {
     return exec(sql.c_str(), callback, cb_arg);
   }
 
+  // Statements prepared on a borrowed connection are cached and reused.
+  // String arguments passed as lvalues are bound without copy and must not be
+  // modified while the statement is in use.
   template <typename... Types>
-  SQLiteStatement prepareStatement(const std::string& zSql, const Types&... args) {
-    return SQLiteStatement(handle_.get(), zSql, args...);
+  SQLiteStatement prepareStatement(const std::string& zSql, Types&&... args) {
+    return SQLiteStatement(handle_.get(), zSql, connection_, std::forward<Types>(args)...);
   }
 
   std::string errmsg() const { return sqlite3_errmsg(handle_.get()); }
@@ -186,37 +287,53 @@ class SQLite3Guard {
   //
   // A transactional series of db operations should be realized between calls of
   // `beginTranscation()` and `commitTransaction()`. If no commit is done before
-  // the destruction of the `SQLite3Guard` (and thus the SQLite connection) or
-  // if `rollbackTransaction()` is called explicitely, the changes will be
-  // rolled back
+  // the destruction of the `SQLite3Guard` or if `rollbackTransaction()` is
+  // called explicitely, the changes will be rolled back
+  //
+  // If a transaction is already open on the connection (by an enclosing guard
+  // of the same thread), a savepoint is used instead: the changes only become
+  // persistent when the outer transaction is committed.
 
   void beginTransaction() {
-    // Note: transaction cannot be nested and this will fail if another
-    // transaction was open on the same connection
-    if (exec("BEGIN TRANSACTION;", nullptr, nullptr) != SQLITE_OK) {
+    const bool nested = sqlite3_get_autocommit(handle_.get()) == 0;
+    if (exec(nested ? "SAVEPOINT nested;" : "BEGIN TRANSACTION;", nullptr, nullptr) != SQLITE_OK) {
       LOG_ERROR << "Can't begin transaction: " << errmsg();
       throw SQLInternalException(std::string("Can't begin transaction: ") + errmsg());
     }
+    transaction_ = nested ? Transaction::kSavepoint : Transaction::kTransaction;
   }
 
   void commitTransaction() {
-    if (exec("COMMIT TRANSACTION;", nullptr, nullptr) != SQLITE_OK) {
+    const char* statement =
+        (transaction_ == Transaction::kSavepoint) ? "RELEASE SAVEPOINT nested;" : "COMMIT TRANSACTION;";
+    if (exec(statement, nullptr, nullptr) != SQLITE_OK) {
       LOG_ERROR << "Can't commit transaction: " << errmsg();
       throw SQLInternalException(std::string("Can't begin transaction: ") + errmsg());
     }
+    transaction_ = Transaction::kNone;
   }
 
   void rollbackTransaction() {
-    if (exec("ROLLBACK TRANSACTION;", nullptr, nullptr) != SQLITE_OK) {
+    if (exec(rollbackStatement(), nullptr, nullptr) != SQLITE_OK) {
       LOG_ERROR << "Can't rollback transaction: " << errmsg();
       throw SQLInternalException(std::string("Can't begin transaction: ") + errmsg());
     }
+    transaction_ = Transaction::kNone;
   }
 
  private:
-  std::unique_ptr<sqlite3, int (*)(sqlite3*)> handle_;
+  enum class Transaction { kNone, kTransaction, kSavepoint };
+
+  const char* rollbackStatement() const {
+    return (transaction_ == Transaction::kSavepoint) ? "ROLLBACK TO SAVEPOINT nested; RELEASE SAVEPOINT nested;"
+                                                     : "ROLLBACK TRANSACTION;";
+  }
+
+  std::shared_ptr<sqlite3> handle_;
+  std::shared_ptr<SQLite3Connection> connection_;
   int rc_;
-  std::shared_ptr<std::mutex> m_ = nullptr;
+  Transaction transaction_{Transaction::kNone};
+  std::unique_lock<std::recursive_mutex> lock_;
 };
 
 #endif  // SQL_UTILS_H_
@@ -11,11 +11,112 @@ TEST(sql_utils, PrepareRvalue) {
   // the arguments used in prepareStatement should last for the subsequent
   // sqlite calls (eg: `.step()`)
   std::string s2 = "test";
-  auto statement =
-      db.prepareStatement<std::string>("INSERT INTO example(ex1, ex2) VALUES (?,?);", temp_dir.PathString(), s2);
+  auto statement = db.prepareStatement("INSERT INTO example(ex1, ex2) VALUES (?,?);", temp_dir.PathString(), s2);
   EXPECT_EQ(statement.step(), SQLITE_DONE);
 }
 
+/* A transaction left open on a borrowed connection is rolled back when the guard goes away. */
+TEST(sql_utils, BorrowedRollback) {
+  TemporaryDirectory temp_dir;
+  SQLite3Guard owner((temp_dir.Path() / "test.db").c_str());
+  ASSERT_EQ(owner.exec("CREATE TABLE example(ex1 TEXT);", NULL, NULL), SQLITE_OK);
+
+  auto connection = std::make_shared<SQLite3Connection>(owner.handle());
+  std::recursive_mutex m;
+  {
+    SQLite3Guard db(connection, std::unique_lock<std::recursive_mutex>(m));
+    db.beginTransaction();
+    auto statement = db.prepareStatement("INSERT INTO example(ex1) VALUES (?);", "test");
+    EXPECT_EQ(statement.step(), SQLITE_DONE);
+  }
+
+  auto statement = owner.prepareStatement("SELECT count(*) FROM example;");
+  ASSERT_EQ(statement.step(), SQLITE_ROW);
+  EXPECT_EQ(statement.get_result_col_int(0), 0);
+}
+
+/* Statements prepared on a borrowed connection are reset and reused for the same query. */
+TEST(sql_utils, StatementCache) {
+  TemporaryDirectory temp_dir;
+  SQLite3Guard owner((temp_dir.Path() / "test.db").c_str());
+  ASSERT_EQ(owner.exec("CREATE TABLE example(ex1 TEXT);", NULL, NULL), SQLITE_OK);
+
+  auto connection = std::make_shared<SQLite3Connection>(owner.handle());
+  std::recursive_mutex m;
+  SQLite3Guard db(connection, std::unique_lock<std::recursive_mutex>(m));
+  const std::string query = "INSERT INTO example(ex1) VALUES (?);";
+
+  sqlite3_stmt* first;
+  {
+    std::string value = "first";
+    auto statement = db.prepareStatement(query, value);
+    first = statement.get();
+    EXPECT_EQ(statement.step(), SQLITE_DONE);
+  }
+  {
+    auto statement = db.prepareStatement(query, std::string("second"));
+    EXPECT_EQ(statement.get(), first);
+    // the same query can still be used twice at the same time
+    auto other = db.prepareStatement(query, "third");
+    EXPECT_NE(other.get(), first);
+    EXPECT_EQ(statement.step(), SQLITE_DONE);
+    EXPECT_EQ(other.step(), SQLITE_DONE);
+  }
+
+  auto statement = db.prepareStatement("SELECT ex1 FROM example ORDER BY rowid;");
+  std::vector<std::string> values;
+  while (statement.step() == SQLITE_ROW) {
+    values.push_back(statement.get_result_col_str(0).value());
+  }
+  EXPECT_EQ(values, (std::vector<std::string>{"first", "second", "third"}));
+}
+
+/* Transactions of nested guards are savepoints within the transaction of the outer guard. */
+TEST(sql_utils, NestedTransaction) {
+  TemporaryDirectory temp_dir;
+  SQLite3Guard owner((temp_dir.Path() / "test.db").c_str());
+  ASSERT_EQ(owner.exec("CREATE TABLE example(ex1 TEXT);", NULL, NULL), SQLITE_OK);
+
+  auto connection = std::make_shared<SQLite3Connection>(owner.handle());
+  std::recursive_mutex m;
+  auto count = [&owner]() {
+    auto statement = owner.prepareStatement("SELECT count(*) FROM example;");
+    EXPECT_EQ(statement.step(), SQLITE_ROW);
+    return statement.get_result_col_int(0);
+  };
+
+  {
+    SQLite3Guard outer(connection, std::unique_lock<std::recursive_mutex>(m));
+    outer.beginTransaction();
+    {
+      SQLite3Guard inner(connection, std::unique_lock<std::recursive_mutex>(m));
+      inner.beginTransaction();
+      EXPECT_EQ(inner.prepareStatement("INSERT INTO example(ex1) VALUES (?);", "kept").step(), SQLITE_DONE);
+      inner.commitTransaction();
+    }
+    {
+      SQLite3Guard inner(connection, std::unique_lock<std::recursive_mutex>(m));
+      inner.beginTransaction();
+      EXPECT_EQ(inner.prepareStatement("INSERT INTO example(ex1) VALUES (?);", "dropped").step(), SQLITE_DONE);
+    }
+    EXPECT_EQ(count(), 1);
+    outer.commitTransaction();
+  }
+  EXPECT_EQ(count(), 1);
+
+  {
+    SQLite3Guard outer(connection, std::unique_lock<std::recursive_mutex>(m));
+    outer.beginTransaction();
+    {
+      SQLite3Guard inner(connection, std::unique_lock<std::recursive_mutex>(m));
+      inner.beginTransaction();
+      EXPECT_EQ(inner.prepareStatement("INSERT INTO example(ex1) VALUES (?);", "dropped").step(), SQLITE_DONE);
+      inner.commitTransaction();
+    }
+  }
+  EXPECT_EQ(count(), 1);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
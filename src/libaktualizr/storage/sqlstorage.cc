@@ -17,8 +17,8 @@ void SQLStorage::cleanMetaVersion(Uptane::RepositoryType repo, const Uptane::Rol
 
   db.beginTransaction();
 
-  auto statement = db.prepareStatement<int, int, int>(
-      "SELECT meta FROM meta WHERE (repo=? AND meta_type=? AND version=?);", static_cast<int>(repo), role.ToInt(), -1);
+  auto statement = db.prepareStatement("SELECT meta FROM meta WHERE (repo=? AND meta_type=? AND version=?);",
+                                       static_cast<int>(repo), role.ToInt(), -1);
 
   int result = statement.step();
 
@@ -38,17 +38,16 @@ void SQLStorage::cleanMetaVersion(Uptane::RepositoryType repo, const Uptane::Rol
   }
 
   // If there is already metadata with the same version, delete it.
-  statement = db.prepareStatement<int, int, int>("DELETE FROM meta WHERE (repo=? AND meta_type=? AND version=?);",
-                                                 static_cast<int>(repo), role.ToInt(), version);
+  statement = db.prepareStatement("DELETE FROM meta WHERE (repo=? AND meta_type=? AND version=?);",
+                                  static_cast<int>(repo), role.ToInt(), version);
 
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to clear " << repo << " " << role << " metadata: " << db.errmsg();
     return;
   }
 
-  statement = db.prepareStatement<int, int, int, int>(
-      "UPDATE meta SET version = ? WHERE (repo=? AND meta_type=? AND version=?);", version, static_cast<int>(repo),
-      role.ToInt(), -1);
+  statement = db.prepareStatement("UPDATE meta SET version = ? WHERE (repo=? AND meta_type=? AND version=?);", version,
+                                  static_cast<int>(repo), role.ToInt(), -1);
 
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to update " << repo << " " << role << " metadata: " << db.errmsg();
@@ -74,7 +73,7 @@ SQLStorage::SQLStorage(const StorageConfig& config, bool readonly)
 void SQLStorage::storePrimaryKeys(const std::string& public_key, const std::string& private_key) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string>(
+  auto statement = db.prepareStatement(
       "INSERT OR REPLACE INTO primary_keys(unique_mark,public,private) VALUES (0,?,?);", public_key, private_key);
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to set Primary keys: " << db.errmsg();
@@ -159,8 +158,7 @@ void SQLStorage::saveSecondaryInfo(const Uptane::EcuSerial& ecu_serial, const st
 
   db.beginTransaction();
 
-  auto statement =
-      db.prepareStatement<std::string>("SELECT count(*) FROM secondary_ecus WHERE serial = ?;", ecu_serial.ToString());
+  auto statement = db.prepareStatement("SELECT count(*) FROM secondary_ecus WHERE serial = ?;", ecu_serial.ToString());
   if (statement.step() != SQLITE_ROW) {
     throw SQLException(db.errmsg().insert(0, "Failed to get count of secondary_ecus table: "));
   }
@@ -174,8 +172,7 @@ void SQLStorage::saveSecondaryInfo(const Uptane::EcuSerial& ecu_serial, const st
         "serial,?,?,? FROM ecus WHERE (serial = ? AND is_primary = 0);";
   }
 
-  statement = db.prepareStatement<std::string, std::string, std::string, std::string>(
-      req, sec_type, key_type_str, public_key.Value(), ecu_serial.ToString());
+  statement = db.prepareStatement(req, sec_type, key_type_str, public_key.Value(), ecu_serial.ToString());
   if (statement.step() != SQLITE_DONE || sqlite3_changes(db.get()) != 1) {
     throw SQLException(db.errmsg().insert(0, "Failed to set Secondary key: "));
   }
@@ -188,8 +185,7 @@ void SQLStorage::saveSecondaryData(const Uptane::EcuSerial& ecu_serial, const st
 
   db.beginTransaction();
 
-  auto statement =
-      db.prepareStatement<std::string>("SELECT count(*) FROM secondary_ecus WHERE serial = ?;", ecu_serial.ToString());
+  auto statement = db.prepareStatement("SELECT count(*) FROM secondary_ecus WHERE serial = ?;", ecu_serial.ToString());
   if (statement.step() != SQLITE_ROW) {
     throw SQLException(db.errmsg().insert(0, "Failed to get count of secondary_ecus table: "));
   }
@@ -201,7 +197,7 @@ void SQLStorage::saveSecondaryData(const Uptane::EcuSerial& ecu_serial, const st
     req = "INSERT INTO secondary_ecus (extra, serial) VALUES (?,?);";
   }
 
-  statement = db.prepareStatement<std::string, std::string>(req, data, ecu_serial.ToString());
+  statement = db.prepareStatement(req, data, ecu_serial.ToString());
   if (statement.step() != SQLITE_DONE || sqlite3_changes(db.get()) != 1) {
     throw SQLException(db.errmsg().insert(0, "Failed to set Secondary data: "));
   }
@@ -214,7 +210,7 @@ bool SQLStorage::loadSecondaryInfo(const Uptane::EcuSerial& ecu_serial, Secondar
 
   SecondaryInfo new_sec{};
 
-  auto statement = db.prepareStatement<std::string>(
+  auto statement = db.prepareStatement(
       "SELECT serial, hardware_id, sec_type, public_key_type, public_key, extra FROM ecus LEFT JOIN secondary_ecus "
       "USING "
       "(serial) WHERE (serial = ? AND is_primary = 0);",
@@ -318,7 +314,7 @@ void SQLStorage::storeTlsCa(const std::string& ca) {
     req = "INSERT INTO tls_creds(ca_cert) VALUES (?);";
   }
 
-  statement = db.prepareStatement<SQLBlob>(req, SQLBlob(ca));
+  statement = db.prepareStatement(req, SQLBlob(ca));
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to set CA certificate: " << db.errmsg();
     return;
@@ -345,7 +341,7 @@ void SQLStorage::storeTlsCert(const std::string& cert) {
     req = "INSERT INTO tls_creds(client_cert) VALUES (?);";
   }
 
-  statement = db.prepareStatement<SQLBlob>(req, SQLBlob(cert));
+  statement = db.prepareStatement(req, SQLBlob(cert));
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to set client certificate: " << db.errmsg();
     return;
@@ -372,7 +368,7 @@ void SQLStorage::storeTlsPkey(const std::string& pkey) {
     req = "INSERT INTO tls_creds(client_pkey) VALUES (?);";
   }
 
-  statement = db.prepareStatement<SQLBlob>(req, SQLBlob(pkey));
+  statement = db.prepareStatement(req, SQLBlob(pkey));
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to set client private key: " << db.errmsg();
     return;
@@ -512,17 +508,16 @@ void SQLStorage::storeRoot(const std::string& data, Uptane::RepositoryType repo,
   db.beginTransaction();
 
   auto del_statement =
-      db.prepareStatement<int, int, int>("DELETE FROM meta WHERE (repo=? AND meta_type=? AND version=?);",
-                                         static_cast<int>(repo), Uptane::Role::Root().ToInt(), version.version());
+      db.prepareStatement("DELETE FROM meta WHERE (repo=? AND meta_type=? AND version=?);", static_cast<int>(repo),
+                          Uptane::Role::Root().ToInt(), version.version());
 
   if (del_statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to clear Root metadata: " << db.errmsg();
     return;
   }
 
-  auto ins_statement = db.prepareStatement<SQLBlob, int, int, int>("INSERT INTO meta VALUES (?, ?, ?, ?);",
-                                                                   SQLBlob(data), static_cast<int>(repo),
-                                                                   Uptane::Role::Root().ToInt(), version.version());
+  auto ins_statement = db.prepareStatement("INSERT INTO meta VALUES (?, ?, ?, ?);", SQLBlob(data),
+                                           static_cast<int>(repo), Uptane::Role::Root().ToInt(), version.version());
 
   if (ins_statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to store Root metadata: " << db.errmsg();
@@ -537,8 +532,8 @@ void SQLStorage::storeNonRoot(const std::string& data, Uptane::RepositoryType re
 
   db.beginTransaction();
 
-  auto del_statement = db.prepareStatement<int, int>("DELETE FROM meta WHERE (repo=? AND meta_type=?);",
-                                                     static_cast<int>(repo), role.ToInt());
+  auto del_statement = db.prepareStatement("DELETE FROM meta WHERE (repo=? AND meta_type=?);", static_cast<int>(repo),
+                                           role.ToInt());
 
   if (del_statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to clear " << role << " metadata: " << db.errmsg();
@@ -546,14 +541,22 @@ void SQLStorage::storeNonRoot(const std::string& data, Uptane::RepositoryType re
   }
 
   auto ins_statement =
-      db.prepareStatement<SQLBlob, int, int, int>("INSERT INTO meta VALUES (?, ?, ?, ?);", SQLBlob(data),
-                                                  static_cast<int>(repo), role.ToInt(), Uptane::Version().version());
+      db.prepareStatement("INSERT INTO meta VALUES (?, ?, ?, ?);", SQLBlob(data), static_cast<int>(repo), role.ToInt(),
+                          Uptane::Version().version());
 
   if (ins_statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to add " << role << "metadata: " << db.errmsg();
     return;
   }
 
+  auto del_validators_statement = db.prepareStatement("DELETE FROM meta_validators WHERE (repo=? AND meta_type=?);",
+                                                      static_cast<int>(repo), role.ToInt());
+
+  if (del_validators_statement.step() != SQLITE_DONE) {
+    LOG_ERROR << "Failed to clear " << role << " metadata validators: " << db.errmsg();
+    return;
+  }
+
   db.commitTransaction();
 }
 
@@ -562,7 +565,7 @@ bool SQLStorage::loadRoot(std::string* data, Uptane::RepositoryType repo, Uptane
 
   // version < 0 => latest metadata requested
   if (version.version() < 0) {
-    auto statement = db.prepareStatement<int, int>(
+    auto statement = db.prepareStatement(
         "SELECT meta FROM meta WHERE (repo=? AND meta_type=?) ORDER BY version DESC LIMIT 1;", static_cast<int>(repo),
         Uptane::Role::Root().ToInt());
     int result = statement.step();
@@ -579,8 +582,8 @@ bool SQLStorage::loadRoot(std::string* data, Uptane::RepositoryType repo, Uptane
     }
   } else {
     auto statement =
-        db.prepareStatement<int, int, int>("SELECT meta FROM meta WHERE (repo=? AND meta_type=? AND version=?);",
-                                           static_cast<int>(repo), Uptane::Role::Root().ToInt(), version.version());
+        db.prepareStatement("SELECT meta FROM meta WHERE (repo=? AND meta_type=? AND version=?);",
+                            static_cast<int>(repo), Uptane::Role::Root().ToInt(), version.version());
 
     int result = statement.step();
 
@@ -609,7 +612,7 @@ bool SQLStorage::loadRoot(std::string* data, Uptane::RepositoryType repo, Uptane
 bool SQLStorage::loadNonRoot(std::string* data, Uptane::RepositoryType repo, const Uptane::Role role) const {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<int, int>(
+  auto statement = db.prepareStatement(
       "SELECT meta FROM meta WHERE (repo=? AND meta_type=?) ORDER BY version DESC LIMIT 1;", static_cast<int>(repo),
       role.ToInt());
   int result = statement.step();
@@ -632,11 +635,54 @@ void SQLStorage::clearNonRootMeta(Uptane::RepositoryType repo) {
   SQLite3Guard db = dbConnection();
 
   auto del_statement =
-      db.prepareStatement<int>("DELETE FROM meta WHERE (repo=? AND meta_type != 0);", static_cast<int>(repo));
+      db.prepareStatement("DELETE FROM meta WHERE (repo=? AND meta_type != 0);", static_cast<int>(repo));
 
   if (del_statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to clear metadata: " << db.errmsg();
   }
+
+  auto del_validators_statement =
+      db.prepareStatement("DELETE FROM meta_validators WHERE repo=?;", static_cast<int>(repo));
+
+  if (del_validators_statement.step() != SQLITE_DONE) {
+    LOG_ERROR << "Failed to clear metadata validators: " << db.errmsg();
+  }
+}
+
+void SQLStorage::storeMetaValidators(const Uptane::MetaValidators& validators, Uptane::RepositoryType repo,
+                                     const Uptane::Role role) {
+  SQLite3Guard db = dbConnection();
+
+  auto statement = db.prepareStatement("INSERT OR REPLACE INTO meta_validators VALUES (?, ?, ?, ?);",
+                                       static_cast<int>(repo), role.ToInt(), validators.etag, validators.last_modified);
+
+  if (statement.step() != SQLITE_DONE) {
+    LOG_ERROR << "Failed to store " << role << " metadata validators: " << db.errmsg();
+  }
+}
+
+bool SQLStorage::loadMetaValidators(Uptane::MetaValidators* validators, Uptane::RepositoryType repo,
+                                    const Uptane::Role role) const {
+  SQLite3Guard db = dbConnection();
+
+  auto statement =
+      db.prepareStatement("SELECT etag, last_modified FROM meta_validators WHERE (repo=? AND meta_type=?);",
+                          static_cast<int>(repo), role.ToInt());
+  int result = statement.step();
+
+  if (result == SQLITE_DONE) {
+    LOG_TRACE << role << " metadata validators not found in database";
+    return false;
+  } else if (result != SQLITE_ROW) {
+    LOG_ERROR << "Failed to get " << role << " metadata validators: " << db.errmsg();
+    return false;
+  }
+  if (validators != nullptr) {
+    validators->etag = statement.get_result_col_str(0).value();
+    validators->last_modified = statement.get_result_col_str(1).value();
+  }
+
+  return true;
 }
 
 void SQLStorage::clearMetadata() {
@@ -646,13 +692,18 @@ void SQLStorage::clearMetadata() {
     LOG_ERROR << "Failed to clear metadata: " << db.errmsg();
     return;
   }
+
+  if (db.exec("DELETE FROM meta_validators;", nullptr, nullptr) != SQLITE_OK) {
+    LOG_ERROR << "Failed to clear metadata validators: " << db.errmsg();
+    return;
+  }
 }
 
 void SQLStorage::storeDelegation(const std::string& data, const Uptane::Role role) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<SQLBlob, std::string>("INSERT OR REPLACE INTO delegations VALUES (?, ?);",
-                                                             SQLBlob(data), role.ToString());
+  auto statement = db.prepareStatement("INSERT OR REPLACE INTO delegations VALUES (?, ?);", SQLBlob(data),
+                                       role.ToString());
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to store delegation metadata: " << db.errmsg();
     return;
@@ -662,8 +713,7 @@ void SQLStorage::storeDelegation(const std::string& data, const Uptane::Role rol
 bool SQLStorage::loadDelegation(std::string* data, const Uptane::Role role) const {
   SQLite3Guard db = dbConnection();
 
-  auto statement =
-      db.prepareStatement<std::string>("SELECT meta FROM delegations WHERE role_name=? LIMIT 1;", role.ToString());
+  auto statement = db.prepareStatement("SELECT meta FROM delegations WHERE role_name=? LIMIT 1;", role.ToString());
   int result = statement.step();
 
   if (result == SQLITE_DONE) {
@@ -718,7 +768,7 @@ bool SQLStorage::loadAllDelegations(std::vector<std::pair<Uptane::Role, std::str
 void SQLStorage::deleteDelegation(const Uptane::Role role) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string>("DELETE FROM delegations WHERE role_name=?;", role.ToString());
+  auto statement = db.prepareStatement("DELETE FROM delegations WHERE role_name=?;", role.ToString());
   statement.step();
 }
 
@@ -733,7 +783,7 @@ void SQLStorage::clearDelegations() {
 void SQLStorage::storeDeviceId(const std::string& device_id) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string>(
+  auto statement = db.prepareStatement(
       "INSERT OR REPLACE INTO device_info(unique_mark,device_id,is_registered) VALUES(0,?,0);", device_id);
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to set device ID: " << db.errmsg();
@@ -830,7 +880,7 @@ void SQLStorage::clearEcuRegistered() {
 void SQLStorage::storeNeedReboot() {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<int>("INSERT OR REPLACE INTO need_reboot(unique_mark,flag) VALUES(0,?);", 1);
+  auto statement = db.prepareStatement("INSERT OR REPLACE INTO need_reboot(unique_mark,flag) VALUES(0,?);", 1);
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to set reboot flag: " << db.errmsg();
     return;
@@ -885,15 +935,15 @@ void SQLStorage::storeEcuSerials(const EcuSerials& serials) {
     std::string serial = serials[0].first.ToString();
     std::string hwid = serials[0].second.ToString();
     {
-      auto statement = db.prepareStatement<std::string, std::string>(
-          "INSERT INTO ecus(id, serial,hardware_id,is_primary) VALUES (0, ?,?,1);", serial, hwid);
+      auto statement = db.prepareStatement("INSERT INTO ecus(id, serial,hardware_id,is_primary) VALUES (0, ?,?,1);",
+                                           serial, hwid);
       if (statement.step() != SQLITE_DONE) {
         LOG_ERROR << "Failed to store ECU serials: " << db.errmsg();
         return;
       }
 
       // update lazily stored installed version
-      auto statement_ivupdate = db.prepareStatement<std::string>(
+      auto statement_ivupdate = db.prepareStatement(
           "UPDATE installed_versions SET ecu_serial = ? WHERE ecu_serial = '';", serial);
 
       if (statement_ivupdate.step() != SQLITE_DONE) {
@@ -903,9 +953,8 @@ void SQLStorage::storeEcuSerials(const EcuSerials& serials) {
     }
 
     for (auto it = serials.cbegin() + 1; it != serials.cend(); it++) {
-      auto statement = db.prepareStatement<int64_t, std::string, std::string>(
-          "INSERT INTO ecus(id,serial,hardware_id) VALUES (?,?,?);", it - serials.cbegin(), it->first.ToString(),
-          it->second.ToString());
+      auto statement = db.prepareStatement("INSERT INTO ecus(id,serial,hardware_id) VALUES (?,?,?);",
+                                           it - serials.cbegin(), it->first.ToString(), it->second.ToString());
 
       if (statement.step() != SQLITE_DONE) {
         LOG_ERROR << "Failed to store ECU serials: " << db.errmsg();
@@ -969,8 +1018,8 @@ void SQLStorage::clearEcuSerials() {
 void SQLStorage::storeCachedEcuManifest(const Uptane::EcuSerial& ecu_serial, const std::string& manifest) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string, std::string>(
-      "UPDATE secondary_ecus SET manifest = ? WHERE (serial = ?);", manifest, ecu_serial.ToString());
+  auto statement = db.prepareStatement("UPDATE secondary_ecus SET manifest = ? WHERE (serial = ?);", manifest,
+                                       ecu_serial.ToString());
   if (statement.step() != SQLITE_DONE || sqlite3_changes(db.get()) != 1) {
     LOG_ERROR << "Failed to store Secondary manifest: " << db.errmsg();
     return;
@@ -984,8 +1033,8 @@ bool SQLStorage::loadCachedEcuManifest(const Uptane::EcuSerial& ecu_serial, std:
 
   bool empty = false;
 
-  auto statement = db.prepareStatement<std::string>("SELECT manifest FROM secondary_ecus WHERE (serial = ?);",
-                                                    ecu_serial.ToString());
+  auto statement = db.prepareStatement("SELECT manifest FROM secondary_ecus WHERE (serial = ?);",
+                                       ecu_serial.ToString());
 
   if (statement.step() != SQLITE_ROW) {
     LOG_WARNING << "Could not find manifest for ECU " << ecu_serial;
@@ -1006,9 +1055,8 @@ bool SQLStorage::loadCachedEcuManifest(const Uptane::EcuSerial& ecu_serial, std:
 void SQLStorage::saveMisconfiguredEcu(const MisconfiguredEcu& ecu) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string, std::string, int>(
-      "INSERT OR REPLACE INTO misconfigured_ecus VALUES (?,?,?);", ecu.serial.ToString(), ecu.hardware_id.ToString(),
-      static_cast<int>(ecu.state));
+  auto statement = db.prepareStatement("INSERT OR REPLACE INTO misconfigured_ecus VALUES (?,?,?);",
+                                       ecu.serial.ToString(), ecu.hardware_id.ToString(), static_cast<int>(ecu.state));
   if (statement.step() != SQLITE_DONE) {
     throw SQLException(db.errmsg().insert(0, "Failed to set misconfigured ECUs: "));
   }
@@ -1080,7 +1128,7 @@ void SQLStorage::saveInstalledVersion(const std::string& ecu_serial, const Uptan
   boost::optional<int64_t> old_id;
   bool old_was_installed = false;
   {
-    auto statement = db.prepareStatement<std::string>(
+    auto statement = db.prepareStatement(
         "SELECT id, sha256, name, was_installed FROM installed_versions WHERE ecu_serial = ? ORDER BY id DESC "
         "LIMIT 1;",
         ecu_serial_real);
@@ -1100,7 +1148,7 @@ void SQLStorage::saveInstalledVersion(const std::string& ecu_serial, const Uptan
 
   if (update_mode == InstalledVersionUpdateMode::kCurrent) {
     // unset 'current' and 'pending' on all versions for this ecu
-    auto statement = db.prepareStatement<std::string>(
+    auto statement = db.prepareStatement(
         "UPDATE installed_versions SET is_current = 0, is_pending = 0 WHERE ecu_serial = ?", ecu_serial_real);
     if (statement.step() != SQLITE_DONE) {
       LOG_ERROR << "Failed to save installed versions: " << db.errmsg();
@@ -1108,8 +1156,8 @@ void SQLStorage::saveInstalledVersion(const std::string& ecu_serial, const Uptan
     }
   } else if (update_mode == InstalledVersionUpdateMode::kPending) {
     // unset 'pending' on all versions for this ecu
-    auto statement = db.prepareStatement<std::string>(
-        "UPDATE installed_versions SET is_pending = 0 WHERE ecu_serial = ?", ecu_serial_real);
+    auto statement = db.prepareStatement("UPDATE installed_versions SET is_pending = 0 WHERE ecu_serial = ?",
+                                         ecu_serial_real);
     if (statement.step() != SQLITE_DONE) {
       LOG_ERROR << "Failed to save installed versions: " << db.errmsg();
       return;
@@ -1117,7 +1165,7 @@ void SQLStorage::saveInstalledVersion(const std::string& ecu_serial, const Uptan
   }
 
   if (!!old_id) {
-    auto statement = db.prepareStatement<std::string, int, int, int64_t>(
+    auto statement = db.prepareStatement(
         "UPDATE installed_versions SET correlation_id = ?, is_current = ?, is_pending = ?, was_installed = ? WHERE id "
         "= ?;",
         correlation_id, static_cast<int>(update_mode == InstalledVersionUpdateMode::kCurrent),
@@ -1130,8 +1178,7 @@ void SQLStorage::saveInstalledVersion(const std::string& ecu_serial, const Uptan
     }
   } else {
     std::string custom = Utils::jsonToCanonicalStr(target.custom_data());
-    auto statement = db.prepareStatement<std::string, std::string, std::string, std::string, int64_t, std::string,
-                                         std::string, int, int>(
+    auto statement = db.prepareStatement(
         "INSERT INTO installed_versions(ecu_serial, sha256, name, hashes, length, custom_meta, correlation_id, "
         "is_current, is_pending, was_installed) VALUES (?,?,?,?,?,?,?,?,?,?);",
         ecu_serial_real, target.sha256Hash(), target.filename(), hashes_encoded, static_cast<int64_t>(target.length()),
@@ -1163,7 +1210,7 @@ static void loadEcuMap(SQLite3Guard& db, std::string& ecu_serial, Uptane::EcuMap
   }
 
   if (!ecu_serial.empty()) {
-    auto statement = db.prepareStatement<std::string>("SELECT hardware_id FROM ecus WHERE serial = ?;", ecu_serial);
+    auto statement = db.prepareStatement("SELECT hardware_id FROM ecus WHERE serial = ?;", ecu_serial);
     if (statement.step() == SQLITE_ROW) {
       ecu_map.insert(
           {Uptane::EcuSerial(ecu_serial), Uptane::HardwareIdentifier(statement.get_result_col_str(0).value())});
@@ -1192,7 +1239,7 @@ bool SQLStorage::loadInstallationLog(const std::string& ecu_serial, std::vector<
         "ecu_serial = ? AND was_installed = 1 ORDER BY id;";
   }
 
-  auto statement = db.prepareStatement<std::string>(query, ecu_serial_real);
+  auto statement = db.prepareStatement(query, ecu_serial_real);
   int statement_state;
 
   std::vector<Uptane::Target> new_log;
@@ -1296,7 +1343,7 @@ bool SQLStorage::loadInstalledVersions(const std::string& ecu_serial, boost::opt
   };
 
   if (current_version != nullptr) {
-    auto statement = db.prepareStatement<std::string>(
+    auto statement = db.prepareStatement(
         "SELECT sha256, name, hashes, length, correlation_id, custom_meta FROM installed_versions WHERE "
         "ecu_serial = ? AND is_current = 1 LIMIT 1;",
         ecu_serial_real);
@@ -1318,7 +1365,7 @@ bool SQLStorage::loadInstalledVersions(const std::string& ecu_serial, boost::opt
   }
 
   if (pending_version != nullptr) {
-    auto statement = db.prepareStatement<std::string>(
+    auto statement = db.prepareStatement(
         "SELECT sha256, name, hashes, length, correlation_id, custom_meta FROM installed_versions WHERE "
         "ecu_serial = ? AND is_pending = 1 LIMIT 1;",
         ecu_serial_real);
@@ -1394,7 +1441,7 @@ void SQLStorage::saveEcuInstallationResult(const Uptane::EcuSerial& ecu_serial,
                                            const data::InstallationResult& result) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string, int, std::string, std::string>(
+  auto statement = db.prepareStatement(
       "INSERT OR REPLACE INTO ecu_installation_results (ecu_serial, success, result_code, description) VALUES "
       "(?,?,?,?);",
       ecu_serial.ToString(), static_cast<int>(result.success), result.result_code.toRepr(), result.description);
@@ -1449,7 +1496,7 @@ void SQLStorage::storeDeviceInstallationResult(const data::InstallationResult& r
                                                const std::string& correlation_id) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<int, std::string, std::string, std::string, std::string>(
+  auto statement = db.prepareStatement(
       "INSERT OR REPLACE INTO device_installation_result (unique_mark, success, result_code, description, raw_report, "
       "correlation_id) "
       "VALUES (0,?,?,?,?,?);",
@@ -1462,7 +1509,7 @@ void SQLStorage::storeDeviceInstallationResult(const data::InstallationResult& r
 
 bool SQLStorage::storeDeviceInstallationRawReport(const std::string& raw_report) {
   SQLite3Guard db = dbConnection();
-  auto statement = db.prepareStatement<std::string>("UPDATE device_installation_result SET raw_report=?;", raw_report);
+  auto statement = db.prepareStatement("UPDATE device_installation_result SET raw_report=?;", raw_report);
   if (statement.step() != SQLITE_DONE || sqlite3_changes(db.get()) != 1) {
     LOG_ERROR << "Failed to store device installation raw report: " << db.errmsg();
     return false;
@@ -1519,7 +1566,7 @@ bool SQLStorage::loadDeviceInstallationResult(data::InstallationResult* result,
 void SQLStorage::saveEcuReportCounter(const Uptane::EcuSerial& ecu_serial, const int64_t counter) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string, int64_t>(
+  auto statement = db.prepareStatement(
       "INSERT OR REPLACE INTO ecu_report_counter (ecu_serial, counter) VALUES "
       "(?,?);",
       ecu_serial.ToString(), counter);
@@ -1570,8 +1617,8 @@ bool SQLStorage::loadEcuReportCounter(std::vector<std::pair<Uptane::EcuSerial, i
 void SQLStorage::saveReportEvent(const Json::Value& json_value) {
   std::string json_string = Utils::jsonToCanonicalStr(json_value);
   SQLite3Guard db = dbConnection();
-  auto statement = db.prepareStatement<std::string>(
-      "INSERT INTO report_events SELECT MAX(id) + 1, ? FROM report_events", json_string);
+  auto statement = db.prepareStatement("INSERT INTO report_events SELECT MAX(id) + 1, ? FROM report_events",
+                                       json_string);
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to save report event: " << db.errmsg();
     return;
@@ -1580,7 +1627,7 @@ void SQLStorage::saveReportEvent(const Json::Value& json_value) {
 
 bool SQLStorage::loadReportEvents(Json::Value* report_array, int64_t* id_max, int limit) const {
   SQLite3Guard db = dbConnection();
-  auto statement = db.prepareStatement<int>("SELECT id, json_string FROM report_events LIMIT ?;", limit);
+  auto statement = db.prepareStatement("SELECT id, json_string FROM report_events LIMIT ?;", limit);
   int statement_result = statement.step();
   if (statement_result != SQLITE_DONE && statement_result != SQLITE_ROW) {
     LOG_ERROR << "Failed to get report events: " << db.errmsg();
@@ -1615,7 +1662,7 @@ bool SQLStorage::loadReportEvents(Json::Value* report_array, int64_t* id_max, in
 void SQLStorage::deleteReportEvents(int64_t id_max) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<int64_t>("DELETE FROM report_events WHERE id <= ?;", id_max);
+  auto statement = db.prepareStatement("DELETE FROM report_events WHERE id <= ?;", id_max);
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to clear report events: " << db.errmsg();
   }
@@ -1642,8 +1689,8 @@ void SQLStorage::clearInstallationResults() {
 void SQLStorage::storeDeviceDataHash(const std::string& data_type, const std::string& hash) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string, std::string>(
-      "INSERT OR REPLACE INTO device_data(data_type,hash) VALUES (?,?);", data_type, hash);
+  auto statement = db.prepareStatement("INSERT OR REPLACE INTO device_data(data_type,hash) VALUES (?,?);", data_type,
+                                       hash);
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to store " << data_type << " hash: " << db.errmsg();
     throw SQLException("Failed to store " + data_type + " hash: " + db.errmsg());
@@ -1653,8 +1700,7 @@ void SQLStorage::storeDeviceDataHash(const std::string& data_type, const std::st
 bool SQLStorage::loadDeviceDataHash(const std::string& data_type, std::string* hash) const {
   SQLite3Guard db = dbConnection();
 
-  auto statement =
-      db.prepareStatement<std::string>("SELECT hash FROM device_data WHERE data_type = ? LIMIT 1;", data_type);
+  auto statement = db.prepareStatement("SELECT hash FROM device_data WHERE data_type = ? LIMIT 1;", data_type);
 
   int result = statement.step();
   if (result == SQLITE_DONE) {
@@ -1683,8 +1729,8 @@ void SQLStorage::clearDeviceData() {
 
 void SQLStorage::storeTargetFilename(const std::string& targetname, const std::string& filename) const {
   SQLite3Guard db = dbConnection();
-  auto statement = db.prepareStatement<std::string, std::string>(
-      "INSERT OR REPLACE INTO target_images (targetname, filename) VALUES (?, ?);", targetname, filename);
+  auto statement = db.prepareStatement("INSERT OR REPLACE INTO target_images (targetname, filename) VALUES (?, ?);",
+                                       targetname, filename);
 
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to store Target filename: " << db.errmsg();
@@ -1695,8 +1741,7 @@ void SQLStorage::storeTargetFilename(const std::string& targetname, const std::s
 std::string SQLStorage::getTargetFilename(const std::string& targetname) const {
   SQLite3Guard db = dbConnection();
 
-  auto statement =
-      db.prepareStatement<std::string>("SELECT filename FROM target_images WHERE targetname = ?;", targetname);
+  auto statement = db.prepareStatement("SELECT filename FROM target_images WHERE targetname = ?;", targetname);
 
   switch (statement.step()) {
     case SQLITE_ROW:
@@ -1711,7 +1756,7 @@ std::string SQLStorage::getTargetFilename(const std::string& targetname) const {
 std::vector<std::string> SQLStorage::getAllTargetNames() const {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<>("SELECT targetname FROM target_images;");
+  auto statement = db.prepareStatement("SELECT targetname FROM target_images;");
 
   std::vector<std::string> names;
 
@@ -1730,10 +1775,24 @@ std::vector<std::string> SQLStorage::getAllTargetNames() const {
 void SQLStorage::deleteTargetInfo(const std::string& targetname) const {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string>("DELETE FROM target_images WHERE targetname=?;", targetname);
+  auto statement = db.prepareStatement("DELETE FROM target_images WHERE targetname=?;", targetname);
 
   if (statement.step() != SQLITE_DONE) {
     LOG_ERROR << "Failed to clear Target filenames: " << db.errmsg();
     throw SQLException(std::string("Failed to clear Target filenames: ") + db.errmsg());
   }
 }
+
+class SQLStorageBatch : public StorageBatch {
+ public:
+  explicit SQLStorageBatch(SQLite3Guard db) : db_(std::move(db)) { db_.beginTransaction(); }
+  void commit() override { db_.commitTransaction(); }
+
+ private:
+  // keeps the storage locked for the calling thread until the batch is over
+  SQLite3Guard db_;
+};
+
+std::unique_ptr<StorageBatch> SQLStorage::beginBatch() {
+  return std_::make_unique<SQLStorageBatch>(dbConnection());
+}
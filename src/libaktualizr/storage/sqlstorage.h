@@ -51,6 +51,10 @@ class SQLStorage : public SQLStorageBase, public INvStorage {
   void storeNonRoot(const std::string& data, Uptane::RepositoryType repo, Uptane::Role role) override;
   bool loadNonRoot(std::string* data, Uptane::RepositoryType repo, Uptane::Role role) const override;
   void clearNonRootMeta(Uptane::RepositoryType repo) override;
+  void storeMetaValidators(const Uptane::MetaValidators& validators, Uptane::RepositoryType repo,
+                           Uptane::Role role) override;
+  bool loadMetaValidators(Uptane::MetaValidators* validators, Uptane::RepositoryType repo,
+                          Uptane::Role role) const override;
   void clearMetadata() override;
   void storeDelegation(const std::string& data, Uptane::Role role) override;
   bool loadDelegation(std::string* data, Uptane::Role role) const override;
@@ -111,6 +115,8 @@ class SQLStorage : public SQLStorageBase, public INvStorage {
   std::vector<std::string> getAllTargetNames() const override;
   void deleteTargetInfo(const std::string& targetname) const override;
 
+  std::unique_ptr<StorageBatch> beginBatch() override;
+
   StorageType type() override { return StorageType::kSqlite; };
 
  private:
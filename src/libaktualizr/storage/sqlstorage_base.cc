@@ -36,7 +36,7 @@ SQLStorageBase::SQLStorageBase(boost::filesystem::path sqldb_path, bool readonly
                                int current_schema_version)
     : sqldb_path_(std::move(sqldb_path)),
       readonly_(readonly),
-      mutex_(new std::mutex()),
+      mutex_(new std::recursive_mutex()),
       schema_migrations_(std::move(schema_migrations)),
       schema_rollback_migrations_(std::move(schema_rollback_migrations)),
       current_schema_(std::move(current_schema)),
@@ -78,19 +78,48 @@ SQLStorageBase::SQLStorageBase(boost::filesystem::path sqldb_path, bool readonly
   }
 }
 
-SQLite3Guard SQLStorageBase::dbConnection() const {
-  SQLite3Guard db(dbPath(), readonly_, mutex_);
+std::shared_ptr<SQLite3Connection> SQLStorageBase::dbOpen() const {
+  SQLite3Guard db(dbPath(), readonly_);
   if (db.get_rc() != SQLITE_OK) {
     throw SQLInternalException(std::string("Can't open database: ") + db.errmsg());
   }
-  return db;
+
+  if (!readonly_) {
+    // WAL lets readers (e.g. aktualizr-info) proceed while we write and only
+    // needs one fsync per commit
+    if (db.exec("PRAGMA journal_mode=WAL;", nullptr, nullptr) != SQLITE_OK) {
+      LOG_WARNING << "Can't enable write-ahead logging for " << dbPath() << ": " << db.errmsg();
+    }
+  }
+
+  struct stat st {};
+  db_inode_ = (stat(dbPath().c_str(), &st) == 0) ? st.st_ino : 0;
+  return std::make_shared<SQLite3Connection>(db.handle());
+}
+
+SQLite3Guard SQLStorageBase::dbConnection() const {
+  std::unique_lock<std::recursive_mutex> guard_lock(*mutex_);
+
+  // The connection is kept open for the lifetime of the storage, but the
+  // database file may have been removed or replaced in the meantime. It is
+  // left alone while an enclosing guard of this thread still uses it.
+  struct stat st {};
+  if (!db_connection_ ||
+      (db_connection_->users() == 0 && (stat(dbPath().c_str(), &st) < 0 || st.st_ino != db_inode_))) {
+    // close the previous connection first so that its WAL gets checkpointed
+    // and removed before a new database is created in its place
+    db_connection_.reset();
+    db_connection_ = dbOpen();
+  }
+
+  return SQLite3Guard(db_connection_, std::move(guard_lock));
 }
 
 std::string SQLStorageBase::getTableSchemaFromDb(const std::string& tablename) {
   SQLite3Guard db = dbConnection();
 
-  auto statement = db.prepareStatement<std::string>(
-      "SELECT sql FROM sqlite_master WHERE type='table' AND tbl_name=? LIMIT 1;", tablename);
+  auto statement = db.prepareStatement("SELECT sql FROM sqlite_master WHERE type='table' AND tbl_name=? LIMIT 1;",
+                                       tablename);
 
   if (statement.step() != SQLITE_ROW) {
     LOG_ERROR << "Can't get schema of " << tablename << ": " << db.errmsg();
@@ -1,6 +1,8 @@
 #ifndef SQLSTORAGE_BASE_H_
 #define SQLSTORAGE_BASE_H_
 
+#include <sys/types.h>
+
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
@@ -47,7 +49,10 @@ class SQLStorageBase {
   bool readonly_{false};
 
   StorageLock lock;
-  std::shared_ptr<std::mutex> mutex_;
+  std::shared_ptr<std::recursive_mutex> mutex_;
+  // Long-lived connection shared by all the operations, guarded by `mutex_`
+  mutable std::shared_ptr<SQLite3Connection> db_connection_;
+  mutable ino_t db_inode_{0};
 
   const std::vector<std::string> schema_migrations_;
   std::vector<std::string> schema_rollback_migrations_;
@@ -55,6 +60,7 @@ class SQLStorageBase {
   const int current_schema_version_;
 
   SQLite3Guard dbConnection() const;
+  std::shared_ptr<SQLite3Connection> dbOpen() const;
   bool dbInsertBackMigrations(SQLite3Guard &db, int version_latest);
 };
 
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <chrono>
+
 #include <boost/filesystem.hpp>
 #include <boost/tokenizer.hpp>
 
@@ -543,6 +545,115 @@ TEST(sqlstorage, store_and_load_report_events) {
   }
 }
 
+/* Writes made within a batch are only persisted when it is committed. */
+TEST(sqlstorage, Batch) {
+  TemporaryDirectory temp_dir;
+  StorageConfig config;
+  config.path = temp_dir.Path();
+  SQLStorage storage(config, false);
+
+  {
+    auto batch = storage.beginBatch();
+    storage.storeDeviceId("device");
+    storage.storeNeedReboot();
+    EXPECT_TRUE(storage.loadDeviceId(nullptr));
+  }
+  EXPECT_FALSE(storage.loadDeviceId(nullptr));
+
+  {
+    auto batch = storage.beginBatch();
+    storage.storeDeviceId("device");
+    storage.storeNeedReboot();
+    batch->commit();
+  }
+  std::string device_id;
+  EXPECT_TRUE(storage.loadDeviceId(&device_id));
+  EXPECT_EQ(device_id, "device");
+  bool need_reboot = false;
+  EXPECT_TRUE(storage.loadNeedReboot(&need_reboot));
+  EXPECT_TRUE(need_reboot);
+}
+
+/* The storage keeps its connection open, but still notices a replaced database file. */
+TEST(sqlstorage, ReopenAfterRemoval) {
+  TemporaryDirectory temp_dir;
+  StorageConfig config;
+  config.path = temp_dir.Path();
+
+  SQLStorage storage(config, false);
+  storage.storeDeviceId("device");
+  EXPECT_TRUE(storage.loadDeviceId(nullptr));
+
+  boost::filesystem::remove_all(config.sqldb_path.get(config.path));
+  EXPECT_TRUE(storage.dbMigrate());
+  EXPECT_FALSE(storage.loadDeviceId(nullptr));
+  storage.storeDeviceId("device");
+  EXPECT_TRUE(storage.loadDeviceId(nullptr));
+}
+
+/* Compare the persistent connection against opening the database for every operation.
+ * Benchmark only, run it explicitly with --gtest_also_run_disabled_tests. */
+TEST(sqlstorage, DISABLED_ConnectionThroughput) {
+  TemporaryDirectory temp_dir;
+  StorageConfig config;
+  config.path = temp_dir.Path();
+  const int iterations = 1000;
+
+  SQLStorage storage(config, false);
+  storage.storeDeviceId("device");
+
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < iterations; ++k) {
+    std::string device_id;
+    ASSERT_TRUE(storage.loadDeviceId(&device_id));
+  }
+  const std::chrono::duration<double> persistent = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int k = 0; k < iterations; ++k) {
+    SQLite3Guard db(config.sqldb_path.get(config.path));
+    auto statement = db.prepareStatement("SELECT device_id FROM device_info LIMIT 1;");
+    ASSERT_EQ(statement.step(), SQLITE_ROW);
+  }
+  const std::chrono::duration<double> per_call = std::chrono::steady_clock::now() - start;
+
+  LOG_INFO << "Persistent connection: " << iterations / persistent.count() << " ops/s";
+  LOG_INFO << "Connection per call: " << iterations / per_call.count() << " ops/s";
+}
+
+/* Compare cached prepared statements against preparing the metadata query every time.
+ * Benchmark only, run it explicitly with --gtest_also_run_disabled_tests. */
+TEST(sqlstorage, DISABLED_StatementCacheThroughput) {
+  TemporaryDirectory temp_dir;
+  StorageConfig config;
+  config.path = temp_dir.Path();
+  const int iterations = 1000;
+
+  SQLStorage storage(config, false);
+  storage.storeNonRoot(Utils::randomUuid(), Uptane::RepositoryType::Director(), Uptane::Role::Targets());
+
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < iterations; ++k) {
+    std::string data;
+    ASSERT_TRUE(storage.loadNonRoot(&data, Uptane::RepositoryType::Director(), Uptane::Role::Targets()));
+  }
+  const std::chrono::duration<double> cached = std::chrono::steady_clock::now() - start;
+
+  // a connection that is not wrapped in an SQLite3Connection has no statement cache
+  SQLite3Guard db(config.sqldb_path.get(config.path));
+  start = std::chrono::steady_clock::now();
+  for (int k = 0; k < iterations; ++k) {
+    auto statement =
+        db.prepareStatement("SELECT meta FROM meta WHERE (repo=? AND meta_type=?) ORDER BY version DESC LIMIT 1;",
+                            static_cast<int>(Uptane::RepositoryType::Director()), Uptane::Role::Targets().ToInt());
+    ASSERT_EQ(statement.step(), SQLITE_ROW);
+  }
+  const std::chrono::duration<double> uncached = std::chrono::steady_clock::now() - start;
+
+  LOG_INFO << "Cached statements: " << iterations / cached.count() << " ops/s";
+  LOG_INFO << "Statements prepared per call: " << iterations / uncached.count() << " ops/s";
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,8 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <boost/filesystem.hpp>
+
+#include "crypto/crypto.h"
 #include "directorrepository.h"
 #include "logging/logging.h"
+#include "storage/sqlstorage.h"
 #include "test_utils.h"
+#include "uptane/exceptions.h"
+#include "uptane/fetcher.h"
 #include "utilities/utils.h"
 
 boost::filesystem::path uptane_generator_path;
@@ -48,6 +54,132 @@ TEST(Director, EmptyTargets) {
   EXPECT_TRUE(director.latest_targets.targets.empty());
 }
 
+/*
+ * Verify that the signatures of metadata that has already been verified are
+ * not checked again, unless the metadata or the Root changes.
+ */
+TEST(Director, VerifiedMetaCache) {
+  TemporaryDirectory meta_dir;
+
+  Process uptane_gen(uptane_generator_path.string());
+  uptane_gen.run({"generate", "--path", meta_dir.PathString(), "--correlationid", "cid1"});
+
+  const std::string root_raw = Utils::readFile(meta_dir.Path() / "repo/director/root.json");
+  const std::string targets_raw = Utils::readFile(meta_dir.Path() / "repo/director/targets.json");
+  const std::string digest = Crypto::sha256digest(targets_raw);
+
+  DirectorRepository director;
+  director.initRoot(Uptane::RepositoryType(Uptane::RepositoryType::DIRECTOR), root_raw);
+  EXPECT_EQ(std::dynamic_pointer_cast<Root>(director.rootSigner(Role::Targets(), digest)), nullptr);
+
+  director.verifyTargets(targets_raw);
+  EXPECT_NE(std::dynamic_pointer_cast<Root>(director.rootSigner(Role::Targets(), digest)), nullptr);
+
+  // Modified metadata is checked in full.
+  Json::Value tampered = Utils::parseJSON(targets_raw);
+  tampered["signed"]["version"] = tampered["signed"]["version"].asInt() + 1;
+  EXPECT_THROW(director.verifyTargets(Utils::jsonToCanonicalStr(tampered)), Uptane::Exception);
+
+  // The cache survives reloading the same Root, but not a reset.
+  director.resetMeta();
+  EXPECT_EQ(std::dynamic_pointer_cast<Root>(director.rootSigner(Role::Targets(), digest)), nullptr);
+  director.initRoot(Uptane::RepositoryType(Uptane::RepositoryType::DIRECTOR), root_raw);
+  EXPECT_NE(std::dynamic_pointer_cast<Root>(director.rootSigner(Role::Targets(), digest)), nullptr);
+}
+
+/* Serves the Director metadata generated by uptane-generator, with the hash
+ * of the content as ETag. */
+class ConditionalFetcher : public IMetadataFetcher {
+ public:
+  explicit ConditionalFetcher(boost::filesystem::path director_dir) : director_dir_(std::move(director_dir)) {}
+
+  void fetchRole(std::string* result, int64_t maxsize, RepositoryType repo, const Role& role, Version version,
+                 const api::FlowControlToken* flow_control) const override {
+    (void)maxsize;
+    (void)flow_control;
+    const boost::filesystem::path path = director_dir_ / version.RoleFileName(role);
+    if (repo != RepositoryType::Director() || !boost::filesystem::exists(path)) {
+      throw MetadataFetchFailure(repo.ToString(), role.ToString());
+    }
+    *result = Utils::readFile(path);
+  }
+
+  bool fetchLatestRoleIfModified(std::string* result, MetaValidators* validators, int64_t maxsize, RepositoryType repo,
+                                 const Role& role, const api::FlowControlToken* flow_control) const override {
+    std::string latest;
+    fetchRole(&latest, maxsize, repo, role, Version(), flow_control);
+    const std::string etag = std::to_string(std::hash<std::string>()(latest));
+    if (validators->etag == etag) {
+      ++not_modified;
+      return false;
+    }
+    *result = latest;
+    validators->etag = etag;
+    return true;
+  }
+
+  mutable int not_modified{0};
+
+ private:
+  boost::filesystem::path director_dir_;
+};
+
+/*
+ * Verify that unchanged Director Targets metadata is not downloaded again and
+ * that the stored copy is used instead.
+ */
+TEST(Director, ConditionalFetch) {
+  TemporaryDirectory temp_dir;
+  TemporaryDirectory meta_dir;
+
+  Process uptane_gen(uptane_generator_path.string());
+  uptane_gen.run({"generate", "--path", meta_dir.PathString(), "--correlationid", "cid1"});
+  uptane_gen.run({"image", "--path", meta_dir.PathString(), "--filename", "tests/test_data/firmware.txt",
+                  "--targetname", "firmware.txt", "--hwid", "primary_hw"});
+  uptane_gen.run({"addtarget", "--path", meta_dir.PathString(), "--targetname", "firmware.txt", "--hwid", "primary_hw",
+                  "--serial", "CA:FE:A6:D2:84:9D"});
+  uptane_gen.run({"signtargets", "--path", meta_dir.PathString()});
+
+  StorageConfig config;
+  config.path = temp_dir.Path();
+  SQLStorage storage(config, false);
+  ConditionalFetcher fetcher(meta_dir.Path() / "repo/director");
+
+  DirectorRepository director;
+  director.updateMeta(storage, fetcher, nullptr);
+  EXPECT_EQ(fetcher.not_modified, 0);
+  EXPECT_EQ(director.getTargets().targets.size(), 1);
+
+  MetaValidators validators;
+  EXPECT_TRUE(storage.loadMetaValidators(&validators, RepositoryType::Director(), Role::Targets()));
+  EXPECT_FALSE(validators.etag.empty());
+
+  const int version = director.getTargets().version();
+  director.updateMeta(storage, fetcher, nullptr);
+  EXPECT_EQ(fetcher.not_modified, 1);
+  EXPECT_EQ(director.getTargets().targets.size(), 1);
+  EXPECT_EQ(director.getTargets().version(), version);
+  EXPECT_EQ(director.getCorrelationId(), "cid1");
+
+  // New content is fetched and stored, along with its validators.
+  uptane_gen.run({"emptytargets", "--path", meta_dir.PathString()});
+  uptane_gen.run({"addtarget", "--path", meta_dir.PathString(), "--targetname", "firmware.txt", "--hwid", "primary_hw",
+                  "--serial", "CA:FE:A6:D2:84:9D"});
+  uptane_gen.run({"signtargets", "--path", meta_dir.PathString()});
+
+  director.updateMeta(storage, fetcher, nullptr);
+  EXPECT_EQ(fetcher.not_modified, 1);
+  EXPECT_EQ(director.getTargets().version(), version + 1);
+
+  MetaValidators new_validators;
+  EXPECT_TRUE(storage.loadMetaValidators(&new_validators, RepositoryType::Director(), Role::Targets()));
+  EXPECT_NE(new_validators.etag, validators.etag);
+
+  // Dropping the stored metadata drops the validators too.
+  director.dropTargets(storage);
+  EXPECT_FALSE(storage.loadMetaValidators(nullptr, RepositoryType::Director(), Role::Targets()));
+}
+
 }  // namespace Uptane
 
 #ifndef __NO_MAIN__
@@ -1,5 +1,6 @@
 #include "directorrepository.h"
 
+#include "crypto/crypto.h"
 #include "fetcher.h"
 #include "logging/logging.h"
 #include "storage/invstorage.h"
@@ -50,8 +51,10 @@ bool DirectorRepository::usePreviousTargets() const {
 void DirectorRepository::verifyTargets(const std::string& targets_raw) {
   try {
     // Verify the signature:
+    const std::string digest = Crypto::sha256digest(targets_raw);
     latest_targets = Targets(RepositoryType::Director(), Role::Targets(), Utils::parseJSON(targets_raw),
-                             std::make_shared<MetaWithKeys>(root));
+                             rootSigner(Role::Targets(), digest));
+    setVerified(Role::Targets(), digest);
     if (!usePreviousTargets()) {
       targets = latest_targets;
       correlation_id_ = latest_targets.correlation_id();
@@ -112,16 +115,16 @@ void DirectorRepository::updateMeta(INvStorage& storage, const IMetadataFetcher&
   {
     std::string director_targets;
 
-    fetcher.fetchLatestRole(&director_targets, kMaxDirectorTargetsSize, RepositoryType::Director(), Role::Targets(),
-                            flow_control);
-    int remote_version = extractVersionUntrusted(director_targets);
-
     int local_version;
     std::string director_targets_stored;
+    MetaValidators validators;
     if (storage.loadNonRoot(&director_targets_stored, RepositoryType::Director(), Role::Targets())) {
       local_version = extractVersionUntrusted(director_targets_stored);
       try {
         verifyTargets(director_targets_stored);
+        // Only ask the server whether the stored copy is still current if
+        // that copy can actually be used.
+        storage.loadMetaValidators(&validators, RepositoryType::Director(), Role::Targets());
       } catch (const std::exception& e) {
         LOG_WARNING << "Unable to verify stored Director Targets metadata.";
       }
@@ -129,15 +132,27 @@ void DirectorRepository::updateMeta(INvStorage& storage, const IMetadataFetcher&
       local_version = -1;
     }
 
-    verifyTargets(director_targets);
+    if (fetcher.fetchLatestRoleIfModified(&director_targets, &validators, kMaxDirectorTargetsSize,
+                                          RepositoryType::Director(), Role::Targets(), flow_control)) {
+      int remote_version = extractVersionUntrusted(director_targets);
+
+      verifyTargets(director_targets);
 
-    // TODO(OTA-4940): check if versions are equal but content is different. In
-    // that case, the member variable targets is updated, but it isn't stored in
-    // the database, which can cause some minor confusion.
-    if (local_version > remote_version) {
-      throw Uptane::SecurityException(RepositoryType::DIRECTOR, "Rollback attempt");
-    } else if (local_version < remote_version && !usePreviousTargets()) {
-      storage.storeNonRoot(director_targets, RepositoryType::Director(), Role::Targets());
+      // TODO(OTA-4940): check if versions are equal but content is different. In
+      // that case, the member variable targets is updated, but it isn't stored in
+      // the database, which can cause some minor confusion.
+      if (local_version > remote_version) {
+        throw Uptane::SecurityException(RepositoryType::DIRECTOR, "Rollback attempt");
+      } else if (local_version < remote_version && !usePreviousTargets()) {
+        storage.storeNonRoot(director_targets, RepositoryType::Director(), Role::Targets());
+        director_targets_stored = director_targets;
+      }
+      // The validators are only valid for the copy that is actually stored
+      if (!validators.empty() && director_targets == director_targets_stored) {
+        storage.storeMetaValidators(validators, RepositoryType::Director(), Role::Targets());
+      }
+    } else {
+      LOG_DEBUG << "Director Targets metadata has not changed.";
     }
 
     checkTargetsExpired();
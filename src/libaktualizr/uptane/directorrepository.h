@@ -30,6 +30,7 @@ class DirectorRepository : public RepositoryCommon {
 
  private:
   FRIEND_TEST(Director, EmptyTargets);
+  FRIEND_TEST(Director, VerifiedMetaCache);
 
   void resetMeta();
   void checkTargetsExpired();
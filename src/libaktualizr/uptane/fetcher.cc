@@ -4,14 +4,17 @@
 
 namespace Uptane {
 
-void Fetcher::fetchRole(std::string* result, int64_t maxsize, RepositoryType repo, const Uptane::Role& role,
-                        Version version, const api::FlowControlToken* flow_control) const {
+std::string Fetcher::roleUrl(RepositoryType repo, const Uptane::Role& role, Version version) const {
   std::string url = (repo == RepositoryType::Director()) ? director_server : repo_server;
   if (role.IsDelegation()) {
     url += "/delegations";
   }
-  url += "/" + version.RoleFileName(role);
-  HttpResponse response = http->get(url, maxsize, flow_control);
+  return url + "/" + version.RoleFileName(role);
+}
+
+void Fetcher::fetchRole(std::string* result, int64_t maxsize, RepositoryType repo, const Uptane::Role& role,
+                        Version version, const api::FlowControlToken* flow_control) const {
+  HttpResponse response = http->get(roleUrl(repo, role, version), maxsize, flow_control);
   if (flow_control != nullptr && flow_control->hasAborted()) {
     throw Uptane::LocallyAborted(repo);
   }
@@ -21,4 +24,25 @@ void Fetcher::fetchRole(std::string* result, int64_t maxsize, RepositoryType rep
   *result = response.body;
 }
 
+bool Fetcher::fetchLatestRoleIfModified(std::string* result, MetaValidators* validators, int64_t maxsize,
+                                        RepositoryType repo, const Uptane::Role& role,
+                                        const api::FlowControlToken* flow_control) const {
+  HttpResponse response = http->getIfModified(roleUrl(repo, role, Version()), maxsize, flow_control, validators->etag,
+                                              validators->last_modified);
+  if (flow_control != nullptr && flow_control->hasAborted()) {
+    throw Uptane::LocallyAborted(repo);
+  }
+  if (response.isNotModified() && !validators->empty()) {
+    return false;
+  }
+  // A 304 is only expected in response to a conditional request
+  if (!response.isOk() || response.isNotModified()) {
+    throw Uptane::MetadataFetchFailure(repo.ToString(), role.ToString());
+  }
+  *result = response.body;
+  validators->etag = response.etag;
+  validators->last_modified = response.last_modified;
+  return true;
+}
+
 }  // namespace Uptane
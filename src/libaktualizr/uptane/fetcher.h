@@ -47,6 +47,26 @@ class IMetadataFetcher {
     fetchRole(result, maxsize, repo, role, Version(), flow_control);
   }
 
+  /**
+   * Fetch the latest version of a role unless it is unchanged since the fetch
+   * that returned `validators`.
+   *
+   * The default implementation always fetches the role.
+   * @param validators Validators of the stored copy of the role on input, and
+   *                   of the fetched copy on output.
+   * @return false if the server reported the role as not modified, in which
+   *         case `result` and `validators` are left untouched.
+   * @throws Uptane::MetadataFetchFailure If fetching metadata fails (e.g. network error)
+   * @throws Uptane::LocallyAborted If the caller aborts with flow_control->hasAborted()
+   */
+  virtual bool fetchLatestRoleIfModified(std::string* result, MetaValidators* validators, int64_t maxsize,
+                                         RepositoryType repo, const Uptane::Role& role,
+                                         const api::FlowControlToken* flow_control) const {
+    fetchLatestRole(result, maxsize, repo, role, flow_control);
+    *validators = MetaValidators();
+    return true;
+  }
+
  protected:
   IMetadataFetcher() = default;
   IMetadataFetcher(IMetadataFetcher&&) = default;
@@ -62,10 +82,15 @@ class Fetcher : public IMetadataFetcher {
         director_server(std::move(director_server_in)) {}
   void fetchRole(std::string* result, int64_t maxsize, RepositoryType repo, const Uptane::Role& role, Version version,
                  const api::FlowControlToken* flow_control) const override;
+  bool fetchLatestRoleIfModified(std::string* result, MetaValidators* validators, int64_t maxsize,
+                                 RepositoryType repo, const Uptane::Role& role,
+                                 const api::FlowControlToken* flow_control) const override;
 
   std::string getRepoServer() const { return repo_server; }
 
  private:
+  std::string roleUrl(RepositoryType repo, const Uptane::Role& role, Version version) const;
+
   std::shared_ptr<HttpInterface> http;
   std::string repo_server;
   std::string director_server;
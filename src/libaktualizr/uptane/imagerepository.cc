@@ -8,6 +8,19 @@
 
 namespace Uptane {
 
+// Metadata hashes are computed over the canonical JSON form. Servers normally
+// send metadata in that form, so the raw bytes are hashed first and the
+// canonical form is only rebuilt (once) if they do not match.
+static bool metaHashMatches(const std::string& meta_raw, std::string* canonical, const Hash& expected) {
+  if (Hash::generate(expected.type(), meta_raw) == expected) {
+    return true;
+  }
+  if (canonical->empty()) {
+    *canonical = Utils::jsonToCanonicalStr(Utils::parseJSON(meta_raw));
+  }
+  return Hash::generate(expected.type(), *canonical) == expected;
+}
+
 void ImageRepository::resetMeta() {
   resetRoot();
   targets.reset();
@@ -18,8 +31,10 @@ void ImageRepository::resetMeta() {
 void ImageRepository::verifyTimestamp(const std::string& timestamp_raw) {
   try {
     // Verify the signature:
+    const std::string digest = Crypto::sha256digest(timestamp_raw);
     timestamp =
-        TimestampMeta(RepositoryType::Image(), Utils::parseJSON(timestamp_raw), std::make_shared<MetaWithKeys>(root));
+        TimestampMeta(RepositoryType::Image(), Utils::parseJSON(timestamp_raw), rootSigner(Role::Timestamp(), digest));
+    setVerified(Role::Timestamp(), digest);
   } catch (const Exception& e) {
     LOG_ERROR << "Signature verification for Timestamp metadata failed";
     throw;
@@ -55,21 +70,13 @@ void ImageRepository::fetchSnapshot(INvStorage& storage, const IMetadataFetcher&
 }
 
 void ImageRepository::verifySnapshot(const std::string& snapshot_raw, bool prefetch) {
-  const std::string canonical = Utils::jsonToCanonicalStr(Utils::parseJSON(snapshot_raw));
+  std::string canonical;
   bool hash_exists = false;
   for (const auto& it : timestamp.snapshot_hashes()) {
     switch (it.type()) {
       case Hash::Type::kSha256:
-        if (Hash(Hash::Type::kSha256, Crypto::sha256digestHex(canonical)) != it) {
-          if (!prefetch) {
-            LOG_ERROR << "Hash verification for Snapshot metadata failed";
-          }
-          throw Uptane::SecurityException(RepositoryType::IMAGE, "Snapshot metadata hash verification failed");
-        }
-        hash_exists = true;
-        break;
       case Hash::Type::kSha512:
-        if (Hash(Hash::Type::kSha512, Crypto::sha512digestHex(canonical)) != it) {
+        if (!metaHashMatches(snapshot_raw, &canonical, it)) {
           if (!prefetch) {
             LOG_ERROR << "Hash verification for Snapshot metadata failed";
           }
@@ -89,7 +96,9 @@ void ImageRepository::verifySnapshot(const std::string& snapshot_raw, bool prefe
 
   try {
     // Verify the signature:
-    snapshot = Snapshot(RepositoryType::Image(), Utils::parseJSON(snapshot_raw), std::make_shared<MetaWithKeys>(root));
+    const std::string digest = Crypto::sha256digest(snapshot_raw);
+    snapshot = Snapshot(RepositoryType::Image(), Utils::parseJSON(snapshot_raw), rootSigner(Role::Snapshot(), digest));
+    setVerified(Role::Snapshot(), digest);
   } catch (const Exception& e) {
     LOG_ERROR << "Signature verification for Snapshot metadata failed";
     throw;
@@ -130,13 +139,14 @@ void ImageRepository::fetchTargets(INvStorage& storage, const IMetadataFetcher&
 }
 
 void ImageRepository::verifyRoleHashes(const std::string& role_data, const Uptane::Role& role, bool prefetch) const {
-  const std::string canonical = Utils::jsonToCanonicalStr(Utils::parseJSON(role_data));
+  std::string canonical;
   // Hashes are not required in snapshot metadata. If present, however, we may as well check them.
   // This provides no security benefit, but may help with fault detection.
   for (const auto& it : snapshot.role_hashes(role)) {
     switch (it.type()) {
       case Hash::Type::kSha256:
-        if (Hash(Hash::Type::kSha256, Crypto::sha256digestHex(canonical)) != it) {
+      case Hash::Type::kSha512:
+        if (!metaHashMatches(role_data, &canonical, it)) {
           // If prefetch is true, it means we're checking a local copy of the metadata.
           // Failures in that case just indicate we need to refresh it from the server, so
           // we only actually log the error if the metadata comes directly from the server.
@@ -147,15 +157,6 @@ void ImageRepository::verifyRoleHashes(const std::string& role_data, const Uptan
                                           "Snapshot hash mismatch for " + role.ToString() + " metadata");
         }
         break;
-      case Hash::Type::kSha512:
-        if (Hash(Hash::Type::kSha512, Crypto::sha512digestHex(canonical)) != it) {
-          if (!prefetch) {
-            LOG_ERROR << "Hash verification for " << role << " metadata failed";
-          }
-          throw Uptane::SecurityException(RepositoryType::IMAGE,
-                                          "Snapshot hash mismatch for " + role.ToString() + " metadata");
-        }
-        break;
       default:
         break;
     }
@@ -173,9 +174,10 @@ void ImageRepository::verifyTargets(const std::string& targets_raw, bool prefetc
     auto targets_json = Utils::parseJSON(targets_raw);
 
     // Verify the signature:
-    auto signer = std::make_shared<MetaWithKeys>(root);
+    const std::string digest = Crypto::sha256digest(targets_raw);
     targets = std::make_shared<Uptane::Targets>(
-        Targets(RepositoryType::Image(), Uptane::Role::Targets(), targets_json, signer));
+        Targets(RepositoryType::Image(), Uptane::Role::Targets(), targets_json, rootSigner(Role::Targets(), digest)));
+    setVerified(Role::Targets(), digest);
 
     if (targets->version() != snapshot.role_version(Uptane::Role::Targets())) {
       throw Uptane::VersionMismatch(RepositoryType::IMAGE, Uptane::Role::TARGETS);
@@ -192,13 +194,14 @@ void ImageRepository::verifyTargets(const std::string& targets_raw, bool prefetc
 
 std::shared_ptr<Uptane::Targets> ImageRepository::verifyDelegation(const std::string& delegation_raw,
                                                                    const Uptane::Role& role,
-                                                                   const Targets& parent_target) {
+                                                                   const Targets& parent_target) const {
   try {
     const Json::Value delegation_json = Utils::parseJSON(delegation_raw);
     const std::string canonical = Utils::jsonToCanonicalStr(delegation_json);
 
     // Verify the signature:
     auto signer = std::make_shared<MetaWithKeys>(parent_target);
+    signer->setMaxParallelVerifications(maxParallelVerifications());
     return std::make_shared<Uptane::Targets>(Targets(RepositoryType::Image(), role, delegation_json, signer));
   } catch (const Exception& e) {
     LOG_ERROR << "Signature verification for Image repo delegated Targets metadata failed";
@@ -224,27 +227,48 @@ void ImageRepository::updateMeta(INvStorage& storage, const IMetadataFetcher& fe
   {
     std::string image_timestamp;
 
-    fetcher.fetchLatestRole(&image_timestamp, kMaxTimestampSize, RepositoryType::Image(), Role::Timestamp());
-    int remote_version = extractVersionUntrusted(image_timestamp);
-
     int local_version;
     std::string image_timestamp_stored;
+    MetaValidators validators;
     if (storage.loadNonRoot(&image_timestamp_stored, RepositoryType::Image(), Role::Timestamp())) {
       local_version = extractVersionUntrusted(image_timestamp_stored);
+      storage.loadMetaValidators(&validators, RepositoryType::Image(), Role::Timestamp());
     } else {
       local_version = -1;
     }
 
-    const auto timestamp_stored_signature{timestamp.isInitialized() ? timestamp.signature() : ""};
-    verifyTimestamp(image_timestamp);
+    bool modified = fetcher.fetchLatestRoleIfModified(&image_timestamp, &validators, kMaxTimestampSize,
+                                                      RepositoryType::Image(), Role::Timestamp(), nullptr);
+    if (!modified) {
+      try {
+        verifyTimestamp(image_timestamp_stored);
+        LOG_DEBUG << "Image repo Timestamp metadata has not changed.";
+      } catch (const Uptane::Exception& e) {
+        LOG_INFO << "Downloading Image repo Timestamp metadata again because verification of local copy failed: "
+                 << e.what();
+        validators = MetaValidators();
+        fetcher.fetchLatestRole(&image_timestamp, kMaxTimestampSize, RepositoryType::Image(), Role::Timestamp());
+        modified = true;
+      }
+    }
+
+    if (modified) {
+      int remote_version = extractVersionUntrusted(image_timestamp);
 
-    if (local_version > remote_version) {
-      throw Uptane::SecurityException(RepositoryType::IMAGE, "Rollback attempt");
-    } else if (local_version < remote_version || timestamp_stored_signature != timestamp.signature()) {
-      // If local and remote versions are the same but their content actually differ then store/update the metadata in
-      // DB We assume that the metadata contains just one signature, otherwise the comparison might not always work
-      // correctly.
-      storage.storeNonRoot(image_timestamp, RepositoryType::Image(), Role::Timestamp());
+      const auto timestamp_stored_signature{timestamp.isInitialized() ? timestamp.signature() : ""};
+      verifyTimestamp(image_timestamp);
+
+      if (local_version > remote_version) {
+        throw Uptane::SecurityException(RepositoryType::IMAGE, "Rollback attempt");
+      } else if (local_version < remote_version || timestamp_stored_signature != timestamp.signature()) {
+        // If local and remote versions are the same but their content actually differ then store/update the metadata
+        // in DB We assume that the metadata contains just one signature, otherwise the comparison might not always
+        // work correctly.
+        storage.storeNonRoot(image_timestamp, RepositoryType::Image(), Role::Timestamp());
+      }
+      if (!validators.empty()) {
+        storage.storeMetaValidators(validators, RepositoryType::Image(), Role::Timestamp());
+      }
     }
 
     checkTimestampExpired();
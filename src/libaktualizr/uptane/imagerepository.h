@@ -22,8 +22,8 @@ class ImageRepository : public RepositoryCommon {
 
   void verifySnapshot(const std::string& snapshot_raw, bool prefetch);
 
-  static std::shared_ptr<Uptane::Targets> verifyDelegation(const std::string& delegation_raw, const Uptane::Role& role,
-                                                           const Targets& parent_target);
+  std::shared_ptr<Uptane::Targets> verifyDelegation(const std::string& delegation_raw, const Uptane::Role& role,
+                                                    const Targets& parent_target) const;
   std::shared_ptr<const Uptane::Targets> getTargets() const { return targets; }
 
   void verifyRoleHashes(const std::string& role_data, const Uptane::Role& role, bool prefetch) const;
@@ -2,6 +2,7 @@
 
 #include "storage/invstorage.h"
 #include "uptane/exceptions.h"
+#include "utilities/utils.h"
 
 namespace Uptane {
 
@@ -44,7 +45,7 @@ Targets getTrustedDelegation(const Role &delegate_role, const Targets &parent_ta
     throw Uptane::DelegationHashMismatch(delegate_role.ToString());
   }
 
-  auto delegation = ImageRepository::verifyDelegation(delegation_meta, delegate_role, parent_targets);
+  auto delegation = image_repo.verifyDelegation(delegation_meta, delegate_role, parent_targets);
   if (delegation == nullptr) {
     throw SecurityException("image", "Delegation verification failed");
   }
@@ -78,7 +79,9 @@ LazyTargetsList::DelegationIterator::DelegationIterator(const ImageRepository &r
 void LazyTargetsList::DelegationIterator::renewTargetsData() {
   auto role = tree_node_->role;
 
-  if (role == Role::Targets()) {
+  if (tree_node_->targets) {
+    cur_targets_ = tree_node_->targets;
+  } else if (role == Role::Targets()) {
     cur_targets_ = repo_.getTargets();
   } else {
     // go to the top of the delegation tree
@@ -100,9 +103,47 @@ void LazyTargetsList::DelegationIterator::renewTargetsData() {
     }
     cur_targets_ = std::make_shared<Targets>(
         getTrustedDelegation(role, *parent_targets, repo_, *storage_, *fetcher_, false, flow_control_));
+    tree_node_->targets = cur_targets_;
   }
 }
 
+// Fetch and verify the sibling delegations that the search visits next
+// concurrently, before they are visited one by one: at most one per worker,
+// starting with the next child and stopping at the first terminating one, as
+// the search never gets past it. Failures are not reported here: the role is
+// left unverified and fails again, in order, when it is visited.
+void LazyTargetsList::DelegationIterator::prefetchChildren() {
+  const auto &children = tree_node_->children;
+  const uint64_t max_workers = repo_.maxParallelVerifications();
+  if (max_workers <= 1) {
+    return;
+  }
+
+  std::vector<DelegatedTargetTreeNode *> next;
+  for (auto idx = children_idx_; idx < children.size() && next.size() < max_workers; ++idx) {
+    if (!children[idx]->targets) {
+      next.push_back(children[idx].get());
+    }
+    auto terminating_it = cur_targets_->terminating_role_.find(children[idx]->role);
+    if (terminating_it != cur_targets_->terminating_role_.end() && terminating_it->second) {
+      break;
+    }
+  }
+  if (next.size() <= 1) {
+    return;
+  }
+
+  const std::shared_ptr<const Targets> parent_targets = cur_targets_;
+  Utils::parallelFor(next.size(), max_workers, [&](size_t k) {
+    try {
+      next[k]->targets = std::make_shared<const Targets>(
+          getTrustedDelegation(next[k]->role, *parent_targets, repo_, *storage_, *fetcher_, false, flow_control_));
+    } catch (const std::exception &e) {
+      LOG_DEBUG << "Prefetching delegation " << next[k]->role << " failed: " << e.what();
+    }
+  });
+}
+
 bool LazyTargetsList::DelegationIterator::operator==(const LazyTargetsList::DelegationIterator &other) const {
   if (is_end_ && other.is_end_) {
     return true;
@@ -167,6 +208,9 @@ LazyTargetsList::DelegationIterator LazyTargetsList::DelegationIterator::operato
   }
 
   if (children_idx_ < tree_node_->children.size()) {
+    if (!tree_node_->children[children_idx_]->targets) {
+      prefetchChildren();
+    }
     auto *new_tree_node = tree_node_->children[children_idx_].get();
     target_idx_ = 0;
     children_idx_ = 0;
@@ -18,6 +18,8 @@ class LazyTargetsList {
     DelegatedTargetTreeNode *parent{nullptr};
     std::vector<std::shared_ptr<DelegatedTargetTreeNode>>::size_type parent_idx{0};
     std::vector<std::shared_ptr<DelegatedTargetTreeNode>> children;
+    // Verified metadata of the role, once it has been visited or prefetched
+    std::shared_ptr<const Targets> targets;
   };
 
   class DelegationIterator {
@@ -38,6 +40,7 @@ class LazyTargetsList {
 
    private:
     void renewTargetsData();
+    void prefetchChildren();
 
     std::shared_ptr<DelegatedTargetTreeNode> tree_;
     DelegatedTargetTreeNode *tree_node_;
@@ -1,9 +1,17 @@
 #include "manifest.h"
 
+#include <sys/stat.h>
+
+#include <array>
+#include <fstream>
+
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
 
+#include "crypto/crypto.h"
 #include "crypto/keymanager.h"
 #include "logging/logging.h"
+#include "utilities/utils.h"
 
 namespace Uptane {
 
@@ -95,4 +103,115 @@ Manifest ManifestIssuer::assembleAndSignManifest(const InstalledImageInfo &insta
   return key_mngr_->signTuf(assembleManifest(installed_image_info));
 }
 
+ImageFileInfoCache::ImageFileInfoCache(boost::filesystem::path image_path)
+    : image_path_(std::move(image_path)), cache_path_(image_path_.string() + ".info") {}
+
+bool ImageFileInfoCache::get(uint64_t *len, std::string *hash) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!loaded_) {
+    load();
+    loaded_ = true;
+  }
+
+  auto current = statFile(image_path_);
+  if (!current) {
+    return false;
+  }
+  if (!entry_ || !sameFile(*entry_, *current)) {
+    LOG_DEBUG << "Hashing installed image " << image_path_.string();
+    std::ifstream image(image_path_.string(), std::ios::binary);
+    if (!image.good()) {
+      return false;
+    }
+    auto hasher = MultiPartHasher::create(Hash::Type::kSha256);
+    std::array<char, 64 * 1024> buf{};
+    while (image.read(buf.data(), buf.size()) || image.gcount() > 0) {
+      hasher->update(reinterpret_cast<const unsigned char *>(buf.data()), static_cast<uint64_t>(image.gcount()));
+    }
+    current->hash = boost::algorithm::to_lower_copy(hasher->getHexDigest());
+
+    // Don't keep the result if the image was replaced while it was being read
+    auto after = statFile(image_path_);
+    if (after && sameFile(*after, *current)) {
+      entry_ = current;
+      store();
+    }
+  } else {
+    current->hash = entry_->hash;
+  }
+
+  *len = current->length;
+  *hash = current->hash;
+  return true;
+}
+
+void ImageFileInfoCache::set(const std::string &hash) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  loaded_ = true;
+  entry_ = statFile(image_path_);
+  if (entry_) {
+    entry_->hash = boost::algorithm::to_lower_copy(hash);
+  }
+  store();
+}
+
+boost::optional<ImageFileInfoCache::Entry> ImageFileInfoCache::statFile(const boost::filesystem::path &path) {
+  struct stat st {};
+  if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return boost::none;
+  }
+  Entry entry;
+  entry.device = st.st_dev;
+  entry.inode = st.st_ino;
+  entry.mtime_sec = st.st_mtim.tv_sec;
+  entry.mtime_nsec = st.st_mtim.tv_nsec;
+  entry.length = static_cast<uint64_t>(st.st_size);
+  return entry;
+}
+
+bool ImageFileInfoCache::sameFile(const Entry &a, const Entry &b) {
+  return a.device == b.device && a.inode == b.inode && a.mtime_sec == b.mtime_sec && a.mtime_nsec == b.mtime_nsec &&
+         a.length == b.length;
+}
+
+void ImageFileInfoCache::load() const {
+  if (!boost::filesystem::exists(cache_path_)) {
+    return;
+  }
+  try {
+    const Json::Value json = Utils::parseJSONFile(cache_path_);
+    Entry entry;
+    entry.device = static_cast<dev_t>(json["device"].asUInt64());
+    entry.inode = static_cast<ino_t>(json["inode"].asUInt64());
+    entry.mtime_sec = json["mtime_sec"].asInt64();
+    entry.mtime_nsec = json["mtime_nsec"].asInt64();
+    entry.length = json["length"].asUInt64();
+    entry.hash = json["sha256"].asString();
+    if (!entry.hash.empty()) {
+      entry_ = entry;
+    }
+  } catch (const std::exception &ex) {
+    LOG_WARNING << "Ignoring unreadable installed image info " << cache_path_.string() << ": " << ex.what();
+  }
+}
+
+void ImageFileInfoCache::store() const {
+  try {
+    if (!entry_) {
+      boost::filesystem::remove(cache_path_);
+      return;
+    }
+    Json::Value json;
+    json["device"] = Json::UInt64(entry_->device);
+    json["inode"] = Json::UInt64(entry_->inode);
+    json["mtime_sec"] = Json::Int64(entry_->mtime_sec);
+    json["mtime_nsec"] = Json::Int64(entry_->mtime_nsec);
+    json["length"] = Json::UInt64(entry_->length);
+    json["sha256"] = entry_->hash;
+    Utils::writeFile(cache_path_, json);
+  } catch (const std::exception &ex) {
+    LOG_WARNING << "Failed to store installed image info " << cache_path_.string() << ": " << ex.what();
+  }
+}
+
 }  // namespace Uptane
@@ -1,7 +1,13 @@
 #ifndef AKTUALIZR_UPTANE_MANIFEST_H
 #define AKTUALIZR_UPTANE_MANIFEST_H
 
+#include <sys/types.h>
+
 #include <memory>
+#include <mutex>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
 
 #include "json/json.h"
 #include "libaktualizr/types.h"
@@ -33,6 +39,40 @@ class ManifestIssuer {
   std::shared_ptr<KeyManager> key_mngr_;
 };
 
+/* Length and SHA-256 hash of an installed image file, as reported in ECU
+ * manifests. They are kept in a small file next to the image and are only
+ * computed again when the image's inode, modification time or size changes. */
+class ImageFileInfoCache {
+ public:
+  explicit ImageFileInfoCache(boost::filesystem::path image_path);
+
+  // Length and hash of the image; false if it doesn't exist or can't be read
+  bool get(uint64_t *len, std::string *hash) const;
+  // Record the hash of an image that has just been installed, to avoid reading it again
+  void set(const std::string &hash);
+
+ private:
+  struct Entry {
+    dev_t device{0};
+    ino_t inode{0};
+    int64_t mtime_sec{0};
+    int64_t mtime_nsec{0};
+    uint64_t length{0};
+    std::string hash;
+  };
+
+  static boost::optional<Entry> statFile(const boost::filesystem::path &path);
+  static bool sameFile(const Entry &a, const Entry &b);
+  void load() const;
+  void store() const;
+
+  const boost::filesystem::path image_path_;
+  const boost::filesystem::path cache_path_;
+  mutable std::mutex mutex_;
+  mutable bool loaded_{false};
+  mutable boost::optional<Entry> entry_;
+};
+
 }  // namespace Uptane
 
 #endif  // AKTUALIZR_UPTANE_MANIFEST_H
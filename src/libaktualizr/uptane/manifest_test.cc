@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "logging/logging.h"
+#include "uptane/manifest.h"
+#include "utilities/utils.h"
+
+/* The length and hash of an installed image are kept across restarts and only
+ * computed again when the image changes. */
+TEST(Manifest, ImageFileInfoCache) {
+  TemporaryDirectory temp_dir;
+  const boost::filesystem::path image_path = temp_dir / "image.bin";
+  uint64_t len = 0;
+  std::string hash;
+
+  EXPECT_FALSE(Uptane::ImageFileInfoCache(image_path).get(&len, &hash));
+
+  Utils::writeFile(image_path, std::string("first image"));
+  Uptane::ImageFileInfoCache cache(image_path);
+  ASSERT_TRUE(cache.get(&len, &hash));
+  EXPECT_EQ(len, 11);
+  EXPECT_EQ(hash, Uptane::ManifestIssuer::generateVersionHashStr("first image"));
+
+  // A hash recorded at install time is trusted as long as the file is unchanged
+  cache.set("ABCDEF");
+  ASSERT_TRUE(Uptane::ImageFileInfoCache(image_path).get(&len, &hash));
+  EXPECT_EQ(hash, "abcdef");
+
+  Utils::writeFile(image_path, std::string("second, longer image"));
+  ASSERT_TRUE(cache.get(&len, &hash));
+  EXPECT_EQ(len, 20);
+  EXPECT_EQ(hash, Uptane::ManifestIssuer::generateVersionHashStr("second, longer image"));
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  logger_set_threshold(boost::log::trivial::trace);
+  return RUN_ALL_TESTS();
+}
+#endif
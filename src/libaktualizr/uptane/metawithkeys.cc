@@ -1,5 +1,7 @@
 #include "uptane/tuf.h"
 
+#include <algorithm>
+
 #include <boost/algorithm/string/case_conv.hpp>
 
 #include "logging/logging.h"
@@ -81,6 +83,12 @@ void Uptane::MetaWithKeys::UnpackSignedObject(const RepositoryType repo, const R
   int valid_signatures = 0;
 
   std::set<std::string> used_keyids;
+  struct PendingSignature {
+    KeyId keyid;
+    const PublicKey *key;
+    std::string signature;
+  };
+  std::vector<PendingSignature> to_verify;
   for (auto sig = signatures.begin(); sig != signatures.end(); ++sig) {
     const std::string keyid = (*sig)["keyid"].asString();
     if (used_keyids.count(keyid) != 0) {
@@ -104,11 +112,23 @@ void Uptane::MetaWithKeys::UnpackSignedObject(const RepositoryType repo, const R
       LOG_WARNING << "KeyId " << keyid << " is not valid to sign for this role (" << role << ").";
       continue;
     }
-    const std::string signature = (*sig)["sig"].asString();
-    if (keys_[keyid].VerifySignature(signature, canonical)) {
+    to_verify.push_back({keyid, &keys_.at(keyid), (*sig)["sig"].asString()});
+  }
+
+  // All the structural checks above are done in order, so that the same
+  // exception is thrown whatever the number of workers. Only the independent
+  // cryptographic checks are spread over the pool.
+  std::vector<char> valid(to_verify.size(), 0);
+  Utils::parallelFor(to_verify.size(), max_parallel_verifications_, [&](size_t k) {
+    valid[k] = static_cast<char>(to_verify[k].key->VerifySignature(to_verify[k].signature, canonical));
+  });
+
+  for (size_t k = 0; k < to_verify.size(); ++k) {
+    if (valid[k] != 0) {
       valid_signatures++;
     } else {
-      LOG_WARNING << "Signature was present but invalid: " << signature << " with KeyId: " << keyid;
+      LOG_WARNING << "Signature was present but invalid: " << to_verify[k].signature
+                  << " with KeyId: " << to_verify[k].keyid;
     }
   }
   const int64_t threshold = thresholds_for_role_[role];
@@ -6,6 +6,7 @@ using Uptane::Root;
 
 Root::Root(const RepositoryType repo, const Json::Value &json, Root &root) : Root(repo, json) {
   root.UnpackSignedObject(repo, Role::Root(), json);
+  setMaxParallelVerifications(root.maxParallelVerifications());
   this->Root::UnpackSignedObject(repo, Role::Root(), json);
 }
 
@@ -5,6 +5,7 @@
  * Base data types that are used in The Update Framework (TUF), part of Uptane.
  */
 
+#include <algorithm>
 #include <functional>
 #include <map>
 #include <ostream>
@@ -139,6 +140,16 @@ class Version {
 
 std::ostream &operator<<(std::ostream &os, const Version &v);
 
+/**
+ * HTTP cache validators (ETag and Last-Modified) of the stored copy of a role,
+ * used to ask the server for the role only if it has changed since.
+ */
+struct MetaValidators {
+  std::string etag;
+  std::string last_modified;
+  bool empty() const { return etag.empty() && last_modified.empty(); }
+};
+
 /* Metadata objects */
 class MetaWithKeys;
 class BaseMeta {
@@ -210,6 +221,14 @@ class MetaWithKeys : public BaseMeta {
    */
   virtual void UnpackSignedObject(RepositoryType repo, const Role &role, const Json::Value &signed_object);
 
+  /**
+   * Set the maximum number of signatures that are verified at the same time
+   * when this object is used as a signer. 1 (the default) verifies them one
+   * after the other on the calling thread.
+   */
+  void setMaxParallelVerifications(uint64_t max) { max_parallel_verifications_ = std::max<uint64_t>(max, 1); }
+  uint64_t maxParallelVerifications() const { return max_parallel_verifications_; }
+
   bool operator==(const MetaWithKeys &rhs) const {
     return version_ == rhs.version_ && expiry_ == rhs.expiry_ && keys_ == rhs.keys_ &&
            keys_for_role_ == rhs.keys_for_role_ && thresholds_for_role_ == rhs.thresholds_for_role_;
@@ -226,6 +245,9 @@ class MetaWithKeys : public BaseMeta {
   std::map<KeyId, PublicKey> keys_;
   std::set<std::pair<Role, KeyId>> keys_for_role_;
   std::map<Role, int64_t> thresholds_for_role_;
+
+ private:
+  uint64_t max_parallel_verifications_{1};
 };
 
 // Implemented in uptane/root.cc
@@ -241,6 +263,10 @@ class Root : public MetaWithKeys {
    * @param json - The contents of the 'signed' portion
    */
   Root(RepositoryType repo, const Json::Value &json);
+  /**
+   * A 'real' Root that has been verified by the given Root. It takes over the
+   * signer's limit on signatures that are verified at the same time.
+   */
   Root(RepositoryType repo, const Json::Value &json, Root &root);
 
   /**
@@ -4,10 +4,16 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/filesystem.hpp>
@@ -129,6 +135,29 @@ TEST(Uptane, VerifyDataBadThreshold) {
   }
 }
 
+/* Verifying signatures in parallel gives the same results as one at a time. */
+TEST(Uptane, VerifyDataParallel) {
+  TemporaryDirectory temp_dir;
+  auto http = std::make_shared<HttpFake>(temp_dir.Path());
+  const Json::Value data_json = http->get(http->tls_server + "/director/root.json", HttpInterface::kNoLimit).getJson();
+  ASSERT_GT(data_json["signatures"].size(), 1);
+
+  Uptane::Root root(Uptane::Root::Policy::kAcceptAll);
+  root.setMaxParallelVerifications(4);
+  EXPECT_NO_THROW(Uptane::Root(Uptane::RepositoryType::Director(), data_json, root));
+
+  Json::Value bad_sigs = data_json;
+  for (auto &sig : bad_sigs["signatures"]) {
+    sig["sig"] = Utils::toBase64("not a signature");
+  }
+  EXPECT_THROW(Uptane::Root(Uptane::RepositoryType::Director(), bad_sigs, root), Uptane::UnmetThreshold);
+
+  Json::Value duplicated = data_json;
+  duplicated["signatures"][1] = duplicated["signatures"][0];
+  duplicated["signatures"][1]["sig"] = Utils::toBase64("not a signature");
+  EXPECT_THROW(Uptane::Root(Uptane::RepositoryType::Director(), duplicated, root), Uptane::NonUniqueSignatures);
+}
+
 /* Get manifest from Primary.
  * Get manifest from Secondaries. */
 TEST(Uptane, AssembleManifestGood) {
@@ -668,6 +697,244 @@ TEST(Uptane, SendMetadataToSecondary) {
   EXPECT_TRUE(EcuInstallationStartedReportGot);
 }
 
+/* Counts the calls made to a group of Secondaries and how many of them were
+ * running at the same time. */
+class SecondaryCallTracker {
+ public:
+  void enter() {
+    std::lock_guard<std::mutex> lock(m_);
+    ++active_;
+    max_active_ = std::max(max_active_, active_);
+  }
+  void leave() {
+    std::lock_guard<std::mutex> lock(m_);
+    --active_;
+    ++finished_;
+    cv_.notify_all();
+  }
+  // Returns false if fewer than `count` calls have returned after a while
+  bool waitFinished(int count) {
+    std::unique_lock<std::mutex> lock(m_);
+    return cv_.wait_for(lock, std::chrono::seconds(10), [this, count]() { return finished_ >= count; });
+  }
+  int maxActive() const {
+    std::lock_guard<std::mutex> lock(m_);
+    return max_active_;
+  }
+  void reset() {
+    std::lock_guard<std::mutex> lock(m_);
+    active_ = max_active_ = finished_ = 0;
+  }
+  std::atomic<bool> armed{false};
+
+ private:
+  mutable std::mutex m_;
+  std::condition_variable cv_;
+  int active_{0};
+  int max_active_{0};
+  int finished_{0};
+};
+
+/* Secondary whose manifest, metadata and firmware calls take some time, wait
+ * for the other Secondaries of the group or fail as if it was offline. The
+ * calls only behave that way once the tracker is armed. */
+class SecondaryParallelMock : public SecondaryInterfaceMock {
+ public:
+  enum class Mode { kDelay, kWaitForOthers, kOffline };
+
+  SecondaryParallelMock(Primary::VirtualSecondaryConfig &sconfig_in, std::shared_ptr<SecondaryCallTracker> tracker,
+                        Mode mode, std::chrono::milliseconds delay = std::chrono::milliseconds(0))
+      : SecondaryInterfaceMock(sconfig_in), tracker_(std::move(tracker)), mode_(mode), delay_(delay) {}
+
+  Uptane::Manifest getManifest() const override {
+    call();
+    return manifest_;
+  }
+  int32_t getRootVersion(bool) const override { return 1; }
+  data::InstallationResult putMetadata(const Uptane::Target &) override {
+    call();
+    return data::InstallationResult(data::ResultCode::Numeric::kOk, "");
+  }
+  data::InstallationResult sendFirmware(const Uptane::Target &, const api::FlowControlToken *) override {
+    call();
+    return data::InstallationResult(data::ResultCode::Numeric::kOk, "");
+  }
+
+  // Number of other calls of the group that a kWaitForOthers Secondary waits for
+  int others{0};
+  // Called by a kWaitForOthers Secondary once the others have returned
+  std::function<void()> after_wait;
+  mutable std::atomic<bool> others_finished{false};
+
+ private:
+  void call() const {
+    if (!tracker_->armed) {
+      return;
+    }
+    tracker_->enter();
+    switch (mode_) {
+      case Mode::kDelay:
+        std::this_thread::sleep_for(delay_);
+        break;
+      case Mode::kWaitForOthers:
+        others_finished = tracker_->waitFinished(others);
+        if (after_wait) {
+          after_wait();
+        }
+        break;
+      case Mode::kOffline:
+        tracker_->leave();
+        throw std::runtime_error("Secondary is offline");
+    }
+    tracker_->leave();
+  }
+
+  std::shared_ptr<SecondaryCallTracker> tracker_;
+  Mode mode_;
+  std::chrono::milliseconds delay_;
+};
+
+class UptaneParallelSecondaries : public ::testing::Test {
+ protected:
+  UptaneParallelSecondaries() {
+    http_ = std::make_shared<HttpFake>(temp_dir_.Path());
+    config_ = config_common();
+    config_.storage.path = temp_dir_.Path();
+    boost::filesystem::copy_file("tests/test_data/cred.zip", temp_dir_ / "cred.zip");
+    config_.provision.provision_path = temp_dir_ / "cred.zip";
+    config_.provision.mode = ProvisionMode::kSharedCred;
+    config_.uptane.director_server = http_->tls_server + "/director";
+    config_.uptane.repo_server = http_->tls_server + "/repo";
+    config_.provision.primary_ecu_serial = "testecuserial";
+    config_.pacman.type = PACKAGE_MANAGER_NONE;
+    storage_ = INvStorage::newStorage(config_.storage);
+  }
+
+  // Creates the client with Secondaries sec_0 ... sec_<modes.size() - 1>.
+  // kDelay Secondaries with a higher serial take less time, so that the
+  // workers finish in the reverse order of the serials.
+  void createClient(const std::vector<SecondaryParallelMock::Mode> &modes) {
+    client_ = std_::make_unique<UptaneTestCommon::TestUptaneClient>(config_, storage_, http_);
+    for (size_t k = 0; k < modes.size(); ++k) {
+      Primary::VirtualSecondaryConfig ecu_config;
+      ecu_config.ecu_serial = "sec_" + std::to_string(k);
+      ecu_config.ecu_hardware_id = "sec_hw_" + std::to_string(k);
+      auto delay = std::chrono::milliseconds(50 + 20 * (modes.size() - k));
+      auto sec = std::make_shared<SecondaryParallelMock>(ecu_config, tracker_, modes[k], delay);
+      sec->others = static_cast<int>(modes.size()) - 1;
+      secondaries_.push_back(sec);
+      client_->addSecondary(sec);
+    }
+    ASSERT_NO_THROW(client_->initialize());
+    tracker_->armed = true;
+  }
+
+  // One target for all the Secondaries
+  std::vector<Uptane::Target> targets() const {
+    Uptane::EcuMap ecus;
+    for (const auto &sec : secondaries_) {
+      ecus.emplace(sec->getSerial(), sec->getHwId());
+    }
+    std::vector<Hash> hashes{Hash(Hash::Type::kSha256, std::string(64, 'a'))};
+    return {Uptane::Target("secondary_firmware.txt", ecus, hashes, 1)};
+  }
+
+  TemporaryDirectory temp_dir_;
+  std::shared_ptr<HttpFake> http_;
+  Config config_;
+  std::shared_ptr<INvStorage> storage_;
+  std::shared_ptr<SecondaryCallTracker> tracker_{std::make_shared<SecondaryCallTracker>()};
+  std::vector<std::shared_ptr<SecondaryParallelMock>> secondaries_;
+  std::unique_ptr<UptaneTestCommon::TestUptaneClient> client_;
+};
+
+using Mode = SecondaryParallelMock::Mode;
+
+/* A slow or offline Secondary does not hold up the manifests of the others,
+ * and the manifests are merged the same way whatever order they come in. */
+TEST_F(UptaneParallelSecondaries, AssembleManifest) {
+  createClient({Mode::kWaitForOthers, Mode::kDelay, Mode::kDelay, Mode::kDelay, Mode::kDelay, Mode::kOffline});
+
+  Json::Value manifest = client_->AssembleManifest()["ecu_version_manifests"];
+  EXPECT_TRUE(secondaries_[0]->others_finished);
+  // The offline Secondary has no cached manifest yet
+  EXPECT_EQ(manifest.size(), secondaries_.size());
+  EXPECT_TRUE(manifest.isMember("testecuserial"));
+  for (size_t k = 0; k + 1 < secondaries_.size(); ++k) {
+    EXPECT_EQ(manifest["sec_" + std::to_string(k)], secondaries_[k]->manifest_);
+  }
+  EXPECT_FALSE(manifest.isMember("sec_5"));
+}
+
+/* Images are sent to all the Secondaries at once. The result of each ECU is
+ * stored as soon as it is known and the reports are in a fixed order. */
+TEST_F(UptaneParallelSecondaries, SendImages) {
+  createClient({Mode::kWaitForOthers, Mode::kDelay, Mode::kDelay, Mode::kDelay, Mode::kDelay, Mode::kOffline});
+  // The others store their results right after their firmware call returns,
+  // so give them a moment
+  size_t stored_before_slow = 0;
+  secondaries_[0]->after_wait = [this, &stored_before_slow]() {
+    for (int attempt = 0; attempt < 500 && stored_before_slow < secondaries_.size() - 1; ++attempt) {
+      std::vector<std::pair<Uptane::EcuSerial, data::InstallationResult>> results;
+      storage_->loadEcuInstallationResults(&results);
+      stored_before_slow = results.size();
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+
+  auto reports = client_->sendImagesToEcus(targets());
+  EXPECT_TRUE(secondaries_[0]->others_finished);
+  EXPECT_EQ(stored_before_slow, secondaries_.size() - 1);
+  ASSERT_EQ(reports.size(), secondaries_.size());
+  for (size_t k = 0; k < reports.size(); ++k) {
+    EXPECT_EQ(reports[k].serial, secondaries_[k]->getSerial());
+    EXPECT_EQ(reports[k].install_res.isSuccess(), k != 5);
+  }
+
+  std::vector<std::pair<Uptane::EcuSerial, data::InstallationResult>> results;
+  ASSERT_TRUE(storage_->loadEcuInstallationResults(&results));
+  EXPECT_EQ(results.size(), secondaries_.size());
+}
+
+/* Metadata is pushed to all the Secondaries at once. Failures are reported in
+ * a fixed order. */
+TEST_F(UptaneParallelSecondaries, SendMetadata) {
+  createClient({Mode::kWaitForOthers, Mode::kDelay, Mode::kOffline, Mode::kDelay, Mode::kOffline});
+  const std::string root = Utils::jsonToStr(Utils::parseJSON(R"({"signed": {"version": 1}})"));
+  storage_->storeRoot(root, Uptane::RepositoryType::Director(), Uptane::Version(1));
+  storage_->storeRoot(root, Uptane::RepositoryType::Image(), Uptane::Version(1));
+
+  data::InstallationResult result;
+  std::string raw_report;
+  client_->sendMetadataToEcus(targets(), &result, &raw_report);
+  EXPECT_TRUE(secondaries_[0]->others_finished);
+  EXPECT_EQ(result.result_code.num_code, data::ResultCode::Numeric::kVerificationFailed);
+  EXPECT_EQ(result.result_code.ToString(), "sec_hw_2:INTERNAL_ERROR|sec_hw_4:INTERNAL_ERROR");
+}
+
+/* No more than uptane.max_parallel_secondaries Secondaries are busy at once. */
+TEST_F(UptaneParallelSecondaries, MaxParallel) {
+  config_.uptane.max_parallel_secondaries = 2;
+  createClient(std::vector<Mode>(6, Mode::kDelay));
+  const std::string root = Utils::jsonToStr(Utils::parseJSON(R"({"signed": {"version": 1}})"));
+  storage_->storeRoot(root, Uptane::RepositoryType::Director(), Uptane::Version(1));
+  storage_->storeRoot(root, Uptane::RepositoryType::Image(), Uptane::Version(1));
+
+  EXPECT_EQ(client_->AssembleManifest()["ecu_version_manifests"].size(), secondaries_.size() + 1);
+  EXPECT_EQ(tracker_->maxActive(), 2);
+
+  tracker_->reset();
+  data::InstallationResult result;
+  client_->sendMetadataToEcus(targets(), &result, nullptr);
+  EXPECT_TRUE(result.isSuccess());
+  EXPECT_EQ(tracker_->maxActive(), 2);
+
+  tracker_->reset();
+  auto reports = client_->sendImagesToEcus(targets());
+  EXPECT_EQ(reports.size(), secondaries_.size());
+  EXPECT_EQ(tracker_->maxActive(), 2);
+}
+
 /* Register Secondary ECUs with Director. */
 TEST(Uptane, UptaneSecondaryAdd) {
   TemporaryDirectory temp_dir;
@@ -2,6 +2,7 @@
 
 #include <boost/algorithm/string/trim.hpp>
 
+#include "crypto/crypto.h"
 #include "fetcher.h"
 #include "logging/logging.h"
 #include "storage/invstorage.h"
@@ -15,8 +16,11 @@ const std::string RepositoryType::IMAGE = "image";
 
 void RepositoryCommon::initRoot(RepositoryType repo_type, const std::string& root_raw) {
   try {
+    root_digest_.clear();
     root = Root(type, Utils::parseJSON(root_raw));        // initialization and format check
+    root.setMaxParallelVerifications(max_parallel_verifications_);
     root = Root(type, Utils::parseJSON(root_raw), root);  // signature verification against itself
+    root_digest_ = Crypto::sha256digest(root_raw);
   } catch (const std::exception& e) {
     LOG_ERROR << "Loading initial " << repo_type << " Root metadata failed: " << e.what();
     throw;
@@ -26,6 +30,7 @@ void RepositoryCommon::initRoot(RepositoryType repo_type, const std::string& roo
 void RepositoryCommon::verifyRoot(const std::string& root_raw) {
   try {
     int prev_version = rootVersion();
+    root_digest_.clear();
     // 5.4.4.3.2.3. Version N+1 of the Root metadata file MUST have been signed
     // by the following: (1) a threshold of keys specified in the latest Root
     // metadata file (version N), and (2) a threshold of keys specified in the
@@ -40,13 +45,39 @@ void RepositoryCommon::verifyRoot(const std::string& root_raw) {
                 << prev_version + 1;
       throw Uptane::RootRotationError(type.ToString());
     }
+    root_digest_ = Crypto::sha256digest(root_raw);
   } catch (const std::exception& e) {
     LOG_ERROR << "Signature verification for Root metadata failed: " << e.what();
     throw;
   }
 }
 
-void RepositoryCommon::resetRoot() { root = Root(Root::Policy::kAcceptAll); }
+void RepositoryCommon::resetRoot() {
+  root = Root(Root::Policy::kAcceptAll);
+  root.setMaxParallelVerifications(max_parallel_verifications_);
+  root_digest_.clear();
+}
+
+void RepositoryCommon::setMaxParallelVerifications(const uint64_t max) {
+  root.setMaxParallelVerifications(max);
+  max_parallel_verifications_ = root.maxParallelVerifications();
+}
+
+std::shared_ptr<MetaWithKeys> RepositoryCommon::rootSigner(const Role& role, const std::string& meta_digest) const {
+  if (!root_digest_.empty()) {
+    const auto it = verified_meta_.find(role);
+    if (it != verified_meta_.end() && it->second == root_digest_ + meta_digest) {
+      return std::make_shared<Root>(Root::Policy::kAcceptAll);
+    }
+  }
+  return std::make_shared<MetaWithKeys>(root);
+}
+
+void RepositoryCommon::setVerified(const Role& role, const std::string& meta_digest) {
+  if (!root_digest_.empty()) {
+    verified_meta_[role] = root_digest_ + meta_digest;
+  }
+}
 
 void RepositoryCommon::updateRoot(INvStorage& storage, const IMetadataFetcher& fetcher,
                                   const RepositoryType repo_type) {
@@ -2,6 +2,8 @@
 #define UPTANE_REPOSITORY_H_
 
 #include <cstdint>               // for int64_t
+#include <map>                   // for map
+#include <memory>                // for shared_ptr
 #include <string>                // for string
 #include "libaktualizr/types.h"  // for TimeStamp
 #include "uptane/tuf.h"          // for Root, RepositoryType
@@ -24,6 +26,12 @@ class RepositoryCommon {
   void verifyRoot(const std::string &root_raw);
   int rootVersion() const { return root.version(); }
   bool rootExpired() const { return root.isExpired(TimeStamp::Now()); }
+  /**
+   * Set the maximum number of signatures of a single metadata object of this
+   * repository that are verified at the same time.
+   */
+  void setMaxParallelVerifications(uint64_t max);
+  uint64_t maxParallelVerifications() const { return max_parallel_verifications_; }
 
   /**
    * Load the initial state of the repository from storage.
@@ -38,10 +46,32 @@ class RepositoryCommon {
   void resetRoot();
   void updateRoot(INvStorage &storage, const IMetadataFetcher &fetcher, RepositoryType repo_type);
 
+  /**
+   * Signer to check metadata signed by the Root with. Metadata that is byte
+   * for byte identical to metadata which already passed verification against
+   * the current Root is accepted without checking its signatures again.
+   * @param role - The Uptane role of the metadata
+   * @param meta_digest - SHA-256 digest of the raw metadata
+   */
+  std::shared_ptr<MetaWithKeys> rootSigner(const Role &role, const std::string &meta_digest) const;
+  /**
+   * Record that the metadata passed verification against the current Root.
+   */
+  void setVerified(const Role &role, const std::string &meta_digest);
+
   static const int64_t kMaxRotations = 1000;
 
   Root root{Root::Policy::kRejectAll};
   RepositoryType type;
+
+ private:
+  // Digest of the raw current Root, empty for the placeholder Roots
+  std::string root_digest_;
+  // Root digest and metadata digest of the last verified metadata of each
+  // role. Kept across resetRoot() so that unchanged metadata is only verified
+  // once.
+  std::map<Role, std::string> verified_meta_;
+  uint64_t max_parallel_verifications_{1};
 };
 }  // namespace Uptane
 
@@ -1,53 +1,66 @@
 #include "utilities/dequeue_buffer.h"
 
-#include <cassert>
-#include <cstring>
+#include <algorithm>
 #include <stdexcept>
 
+DequeueBuffer::DequeueBuffer(size_t max_size)
+    : max_size_{std::max(max_size, kInitialSize)}, buffer_(kInitialSize) {}
+
 char* DequeueBuffer::Head() {
-  assert(sentinel_ == kSentinel);
-  return buffer_.data();
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  return buffer_.data() + head_;
 }
 
-size_t DequeueBuffer::Size() const {
-  assert(sentinel_ == kSentinel);
-  return written_bytes_;
-}
+size_t DequeueBuffer::Size() const { return tail_ - head_; }
 
 void DequeueBuffer::Consume(size_t bytes) {
-  assert(sentinel_ == kSentinel);
-  // It would be possible to have a smarter algorithm here that
-  // only shuffles bytes down when Tail() is called and we are getting
-  // close to the end of the buffer, or when the buffer is nearly empty
-  // the memmove operation is cheap. This isn't performance critical code.
-  if (written_bytes_ < bytes) {
+  if (Size() < bytes) {
     throw std::logic_error("Attempt to DequeueBuffer::Consume() more bytes than are valid");
   }
-  // Shuffle up the buffer
-  auto* next_unconsumed_byte = buffer_.begin() + bytes;
-  auto* end_of_written_area = buffer_.begin() + written_bytes_;
-  std::copy(next_unconsumed_byte, end_of_written_area, buffer_.begin());
-  written_bytes_ -= bytes;
+  // Bytes are only shuffled down by Reserve(), when the space is needed
+  head_ += bytes;
+  if (head_ == tail_) {
+    head_ = tail_ = 0;
+    // Don't hold on to the memory of one large message for the lifetime of
+    // the connection
+    if (buffer_.size() > kInitialSize) {
+      std::vector<char>(kInitialSize).swap(buffer_);
+    }
+  }
 }
 
 char* DequeueBuffer::Tail() {
-  assert(sentinel_ == kSentinel);
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-  return buffer_.data() + written_bytes_;
+  return buffer_.data() + tail_;
 }
 
-size_t DequeueBuffer::TailSpace() {
-  assert(sentinel_ == kSentinel);
-  return buffer_.size() - written_bytes_;
-}
+size_t DequeueBuffer::TailSpace() const { return buffer_.size() - tail_; }
 
 void DequeueBuffer::HaveEnqueued(size_t bytes) {
-  // Assert first. If we have corrupted memory, there is
-  // no amount of exception handling that will save us. Abort rather
-  // than risk a security hole
-  assert(sentinel_ == kSentinel);
-  if (buffer_.size() < written_bytes_ + bytes) {
+  if (buffer_.size() < tail_ + bytes) {
     throw std::logic_error("Wrote bytes beyond the end of the buffer");
   }
-  written_bytes_ += bytes;
+  tail_ += bytes;
+}
+
+bool DequeueBuffer::Reserve(size_t bytes) {
+  if (buffer_.size() - tail_ >= bytes) {
+    return true;
+  }
+  const size_t size = Size();
+  if (bytes > max_size_ - size) {
+    return false;
+  }
+  if (head_ > 0) {
+    std::copy(buffer_.begin() + static_cast<std::ptrdiff_t>(head_),
+              buffer_.begin() + static_cast<std::ptrdiff_t>(tail_), buffer_.begin());
+    head_ = 0;
+    tail_ = size;
+  }
+  if (buffer_.size() - tail_ < bytes) {
+    // Grow geometrically, so that a message arriving in many pieces does not
+    // reallocate for each of them
+    buffer_.resize(std::min(max_size_, std::max(size + bytes, 2 * buffer_.size())));
+  }
+  return true;
 }
@@ -1,15 +1,27 @@
 #ifndef UPTANE_DEQUEUE_BUFFER_H_
 #define UPTANE_DEQUEUE_BUFFER_H_
 
-#include <array>
 #include <cstddef>
+#include <vector>
 
 /**
  * A dequeue based on a contiguous buffer in memory. Used for buffering
  * data between recv() and ber_decode()
+ *
+ * The buffer starts small and grows on demand (see Reserve()) up to a limit,
+ * so that a complete message can be received and decoded in one go.
  */
 class DequeueBuffer {
  public:
+  static constexpr size_t kInitialSize = 4096;
+  /**
+   * Large enough for a putMetaReq carrying an Image repo targets.json of the
+   * maximum size we accept (kMaxImageTargetsSize) and the other metadata.
+   */
+  static constexpr size_t kDefaultMaxSize = 16 * 1024 * 1024;
+
+  explicit DequeueBuffer(size_t max_size = kDefaultMaxSize);
+
   /**
    * A pointer to the first element that has not been Consumed().
    */
@@ -22,7 +34,9 @@ class DequeueBuffer {
 
   /**
    * Called after bytes have been read from Head(). Remove them from the head
-   * of the queue.
+   * of the queue. Once the queue is empty, a buffer that has grown is shrunk
+   * back to kInitialSize, which invalidates pointers returned by Head() and
+   * Tail().
    */
   void Consume(size_t bytes);
 
@@ -33,8 +47,9 @@ class DequeueBuffer {
 
   /**
    * The number of bytes beyond Tail() that are allocated and may be written to.
+   * Call Reserve() first to make sure that there is any.
    */
-  size_t TailSpace();
+  size_t TailSpace() const;
 
   /**
    * Call to indicate that bytes have been written in the range
@@ -42,16 +57,24 @@ class DequeueBuffer {
    */
   void HaveEnqueued(size_t bytes);
 
- private:
-  static constexpr int kSentinel = 1337161494;
+  /**
+   * Make TailSpace() at least `bytes`, first by moving the valid elements to
+   * the start of the buffer and then by growing it. Returns false, and leaves
+   * the buffer as it is, if Size() + bytes would exceed the maximum size.
+   * Invalidates pointers returned by Head() and Tail().
+   */
+  bool Reserve(size_t bytes);
 
+  size_t MaxSize() const { return max_size_; }
+
+ private:
   /**
-   * buffer_[0..written_bytes_] contains to contents of this dequeue
+   * buffer_[head_..tail_] contains the contents of this dequeue
    */
-  size_t written_bytes_{0};
-  std::array<char, 4096> buffer_{};  // Zero initialise as a security pesimisation
-  // NOLINTNEXTLINE (should be just for clang-diagnostic-unused-private-field but it won't work)
-  int sentinel_{kSentinel};  // Sentinel to check for writers overflowing buffer_
+  size_t head_{0};
+  size_t tail_{0};
+  size_t max_size_;
+  std::vector<char> buffer_;  // Zero initialise as a security pesimisation
 };
 
 #endif  // UPTANE_DEQUEUE_BUFFER_H_
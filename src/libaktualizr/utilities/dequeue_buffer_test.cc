@@ -20,6 +20,67 @@ TEST(DequeueBuffer, Simple) {
   EXPECT_EQ(std::string(dut.Head(), dut.Size()), "lo world");
 }
 
+/* Reserve() makes room for a whole message, up to the maximum size. */
+TEST(DequeueBuffer, Reserve) {
+  DequeueBuffer dut(3 * DequeueBuffer::kInitialSize);
+
+  dut.HaveEnqueued(static_cast<size_t>(snprintf(dut.Tail(), dut.TailSpace(), "hello world")));
+  dut.Consume(6);
+  EXPECT_TRUE(dut.Reserve(2 * DequeueBuffer::kInitialSize));
+  EXPECT_GE(dut.TailSpace(), 2 * DequeueBuffer::kInitialSize);
+  EXPECT_EQ(std::string(dut.Head(), dut.Size()), "world");
+
+  const std::string big(2 * DequeueBuffer::kInitialSize, 'x');
+  memcpy(dut.Tail(), big.data(), big.size());
+  dut.HaveEnqueued(big.size());
+  EXPECT_EQ(std::string(dut.Head(), dut.Size()), "world" + big);
+
+  // Past the maximum size the buffer is left alone
+  EXPECT_FALSE(dut.Reserve(DequeueBuffer::kInitialSize));
+  EXPECT_EQ(dut.Size(), 5 + big.size());
+  EXPECT_THROW(dut.HaveEnqueued(dut.TailSpace() + 1), std::logic_error);
+
+  // Consumed bytes are reused
+  dut.Consume(5 + big.size() - 1);
+  EXPECT_TRUE(dut.Reserve(DequeueBuffer::kInitialSize));
+  EXPECT_EQ(std::string(dut.Head(), dut.Size()), "x");
+  EXPECT_THROW(dut.Consume(2), std::logic_error);
+}
+
+/* Only Reserve() moves the data, so a pointer from Tail() stays valid while
+ * TailSpace() is asked for. */
+TEST(DequeueBuffer, TailSpaceKeepsData) {
+  DequeueBuffer dut;
+  const std::string full(DequeueBuffer::kInitialSize, 'x');
+  memcpy(dut.Tail(), full.data(), full.size());
+  dut.HaveEnqueued(full.size());
+  dut.Consume(10);
+
+  char *tail = dut.Tail();
+  EXPECT_EQ(dut.TailSpace(), 0);
+  EXPECT_EQ(dut.Tail(), tail);
+  EXPECT_EQ(dut.Size(), full.size() - 10);
+
+  EXPECT_TRUE(dut.Reserve(1));
+  EXPECT_EQ(dut.TailSpace(), 10);
+  EXPECT_EQ(std::string(dut.Head(), dut.Size()), full.substr(10));
+}
+
+/* A buffer that has grown for a large message shrinks again once it is empty. */
+TEST(DequeueBuffer, ShrinkWhenEmpty) {
+  DequeueBuffer dut;
+  EXPECT_TRUE(dut.Reserve(4 * DequeueBuffer::kInitialSize));
+  const std::string big(4 * DequeueBuffer::kInitialSize, 'x');
+  memcpy(dut.Tail(), big.data(), big.size());
+  dut.HaveEnqueued(big.size());
+
+  dut.Consume(big.size() - 1);
+  EXPECT_EQ(std::string(dut.Head(), dut.Size()), "x");
+  dut.Consume(1);
+  EXPECT_EQ(dut.Size(), 0);
+  EXPECT_EQ(dut.TailSpace(), DequeueBuffer::kInitialSize);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
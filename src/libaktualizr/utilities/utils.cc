@@ -2,11 +2,14 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <sstream>
 #include <stdexcept>
@@ -814,6 +817,38 @@ std::string Utils::urlEncode(const std::string &input) {
   return res;
 }
 
+void Utils::parallelFor(const size_t count, const uint64_t max_workers, const std::function<void(size_t)> &task) {
+  std::atomic<size_t> next_task{0};
+  std::exception_ptr first_exception;
+  std::mutex exception_mutex;
+  auto worker = [&]() {
+    for (size_t k = next_task++; k < count; k = next_task++) {
+      try {
+        task(k);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(exception_mutex);
+        if (!first_exception) {
+          first_exception = std::current_exception();
+        }
+        next_task = count;
+      }
+    }
+  };
+
+  const auto workers_count = static_cast<size_t>(std::min<uint64_t>(std::max<uint64_t>(max_workers, 1), count));
+  std::vector<std::future<void>> workers;
+  for (size_t k = 1; k < workers_count; ++k) {
+    workers.push_back(std::async(std::launch::async, worker));
+  }
+  worker();
+  for (auto &w : workers) {
+    w.get();
+  }
+  if (first_exception) {
+    std::rethrow_exception(first_exception);
+  }
+}
+
 CURL *Utils::curlDupHandleWrapper(CURL *const curl_in, const bool using_pkcs11) {
   CURL *curl = curl_easy_duphandle(curl_in);
 
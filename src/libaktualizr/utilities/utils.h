@@ -2,6 +2,7 @@
 #define UTILS_H_
 
 #include <boost/filesystem/path.hpp>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -45,6 +46,10 @@ struct Utils {
   static bool createSecureDirectory(const boost::filesystem::path &path);
   static std::string urlEncode(const std::string &input);
   static CURL *curlDupHandleWrapper(CURL *curl_in, bool using_pkcs11);
+  // Calls task(0) ... task(count - 1) on up to max_workers threads, the
+  // calling thread included, and returns when they have all finished. Once a
+  // task throws, no further tasks are started and the exception is rethrown.
+  static void parallelFor(size_t count, uint64_t max_workers, const std::function<void(size_t)> &task);
   static std::vector<boost::filesystem::path> getDirEntriesByExt(const boost::filesystem::path &dir_path,
                                                                  const std::string &ext);
   static void setStorageRootPath(const std::string &storage_root_path);
@@ -5,10 +5,13 @@
 #include <gtest/gtest.h>
 
 #include <sys/stat.h>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <map>
 #include <random>
 #include <set>
+#include <thread>
 
 #include <boost/algorithm/hex.hpp>
 #include <boost/archive/iterators/dataflow_exception.hpp>
@@ -396,6 +399,49 @@ TEST(Utils, TrimNewline) {
   EXPECT_EQ(output, input);
 }
 
+/* Every task runs exactly once, on no more threads than requested. */
+TEST(Utils, parallelFor) {
+  for (const uint64_t max_workers : {0, 1, 3, 100}) {
+    const size_t count = 20;
+    std::vector<std::atomic<int>> runs(count);
+    std::atomic<int> running{0};
+    std::atomic<int> max_running{0};
+    Utils::parallelFor(count, max_workers, [&](size_t k) {
+      const int now = ++running;
+      int seen = max_running;
+      while (now > seen && !max_running.compare_exchange_weak(seen, now)) {
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      ++runs[k];
+      --running;
+    });
+    for (size_t k = 0; k < count; ++k) {
+      EXPECT_EQ(runs[k], 1) << "task " << k << " with " << max_workers << " workers";
+    }
+    EXPECT_GE(max_running, 1);
+    EXPECT_LE(static_cast<uint64_t>(max_running), std::max<uint64_t>(max_workers, 1));
+  }
+
+  bool called = false;
+  Utils::parallelFor(0, 4, [&called](size_t) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+/* An exception thrown by a task reaches the caller once the other workers are done. */
+TEST(Utils, parallelForException) {
+  std::atomic<int> finished{0};
+  EXPECT_THROW(Utils::parallelFor(10, 4,
+                                  [&finished](size_t k) {
+                                    if (k == 2) {
+                                      throw std::runtime_error("task failed");
+                                    }
+                                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                                    ++finished;
+                                  }),
+               std::runtime_error);
+  EXPECT_LT(finished, 10);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -24,7 +24,8 @@ bool CheckPoolState(const OSTreeObject::ptr &root_object, const RequestPool &req
 }
 
 bool UploadToTreehub(const OSTreeRepo::ptr &src_repo, TreehubServer &push_server, const OSTreeHash &ostree_commit,
-                     const RunMode mode, const int max_curl_requests, const bool fsck_on_upload) {
+                     const RunMode mode, const int max_curl_requests, const bool fsck_on_upload,
+                     PresenceIndex *presence_index) {
   assert(max_curl_requests > 0);
 
   OSTreeObject::ptr root_object;
@@ -35,7 +36,7 @@ bool UploadToTreehub(const OSTreeRepo::ptr &src_repo, TreehubServer &push_server
     return false;
   }
 
-  RequestPool request_pool(push_server, max_curl_requests, mode, fsck_on_upload);
+  RequestPool request_pool(push_server, max_curl_requests, mode, fsck_on_upload, presence_index);
 
   // Add commit object to the queue.
   request_pool.AddQuery(root_object);
@@ -60,6 +61,15 @@ bool UploadToTreehub(const OSTreeRepo::ptr &src_repo, TreehubServer &push_server
     LOG_ERROR << "One or more errors while pushing";
   }
 
+  if (presence_index != nullptr) {
+    LOG_INFO << request_pool.index_hits() << " presence checks were answered from the index.";
+    if (request_pool.index_stale()) {
+      LOG_ERROR << "The presence index is out of date with the server. It has been cleared; please run again.";
+      presence_index->Clear();
+    }
+    presence_index->Save();
+  }
+
   return root_object->is_on_server() == PresenceOnServer::kObjectPresent;
 }
 
@@ -6,6 +6,7 @@
 #include "garage_common.h"
 #include "ostree_ref.h"
 #include "ostree_repo.h"
+#include "presence_index.h"
 #include "server_credentials.h"
 
 /*
@@ -26,9 +27,13 @@ bool CheckPoolState(const OSTreeObject::ptr& root_object, const RequestPool& req
  * \param mode
  * \param max_curl_requests
  * \param fsck_on_upload Validate objects on disk before uploading them
+ * \param presence_index Optional index of objects known to be on push_server.
+ *                       It is consulted instead of the server and updated
+ *                       with the objects confirmed during the upload.
  */
 bool UploadToTreehub(const OSTreeRepo::ptr& src_repo, TreehubServer& push_server, const OSTreeHash& ostree_commit,
-                     RunMode mode, int max_curl_requests, bool fsck_on_upload);
+                     RunMode mode, int max_curl_requests, bool fsck_on_upload,
+                     PresenceIndex* presence_index = nullptr);
 
 /**
  * Use the garage-sign tool and the Image repo targets.json keys in credentials.zip
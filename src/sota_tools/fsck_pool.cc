@@ -0,0 +1,99 @@
+#include "fsck_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "logging/logging.h"
+
+FsckPool::FsckPool(size_t workers, std::function<void()> on_result) : on_result_(std::move(on_result)) {
+  if (workers == 0) {
+    workers = std::max(1U, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(workers);
+  for (size_t i = 0; i < workers; ++i) {
+    workers_.emplace_back(&FsckPool::Work, this);
+  }
+}
+
+FsckPool::~FsckPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+    jobs_.clear();
+  }
+  jobs_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void FsckPool::Add(const OSTreeObject::ptr &object) {
+  if (!objects_.emplace(object.get(), object).second) {
+    return;  // Already being checked
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(object.get());
+  }
+  jobs_cv_.notify_one();
+}
+
+std::vector<std::pair<OSTreeObject::ptr, bool>> FsckPool::TakeResults() {
+  std::vector<std::pair<OSTreeObject *, bool>> finished;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished.swap(results_);
+  }
+
+  std::vector<std::pair<OSTreeObject::ptr, bool>> results;
+  results.reserve(finished.size());
+  for (const auto &result : finished) {
+    auto it = objects_.find(result.first);
+    assert(it != objects_.end());
+    results.emplace_back(it->second, result.second);
+    objects_.erase(it);
+  }
+  return results;
+}
+
+void FsckPool::Cancel() {
+  std::deque<OSTreeObject *> cancelled;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled.swap(jobs_);
+  }
+  for (OSTreeObject *object : cancelled) {
+    objects_.erase(object);
+  }
+}
+
+void FsckPool::WaitForResults(const std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  results_cv_.wait_for(lock, timeout, [this] { return !results_.empty(); });
+}
+
+void FsckPool::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    jobs_cv_.wait(lock, [this] { return shutdown_ || !jobs_.empty(); });
+    if (shutdown_) {
+      return;
+    }
+    OSTreeObject *object = jobs_.front();
+    jobs_.pop_front();
+
+    lock.unlock();
+    // Fsck() only reads members that never change after construction, so it
+    // is safe while the owner thread keeps working with the object.
+    const bool ok = object->Fsck();
+    lock.lock();
+
+    results_.emplace_back(object, ok);
+    results_cv_.notify_all();
+    if (on_result_) {
+      on_result_();
+    }
+  }
+}
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -0,0 +1,72 @@
+#ifndef SOTA_CLIENT_TOOLS_FSCK_POOL_H_
+#define SOTA_CLIENT_TOOLS_FSCK_POOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ostree_object.h"
+
+/**
+ * Checks the integrity of OSTree objects on a set of worker threads, so that
+ * the thread driving curl never waits for an object to be checksummed.
+ *
+ * OSTreeObject reference counts are not atomic, so the workers only ever see
+ * raw pointers. The references are held here and only touched by the thread
+ * that owns the pool, in Add() and TakeResults().
+ */
+class FsckPool {
+ public:
+  /**
+   * \param workers Number of worker threads, 0 for one per CPU.
+   * \param on_result Called from a worker thread whenever a check has
+   *                  finished, e.g. to wake up the owner's event loop.
+   */
+  explicit FsckPool(size_t workers = 0, std::function<void()> on_result = nullptr);
+  ~FsckPool();
+  FsckPool(const FsckPool&) = delete;
+  FsckPool(FsckPool&&) = delete;
+  FsckPool& operator=(const FsckPool&) = delete;
+  FsckPool& operator=(FsckPool&&) = delete;
+
+  /** Queue an object to be checked. */
+  void Add(const OSTreeObject::ptr& object);
+
+  /**
+   * Return the objects that have been checked since the last call, together
+   * with the result of the check.
+   */
+  std::vector<std::pair<OSTreeObject::ptr, bool>> TakeResults();
+
+  /** Drop the objects that no worker has started on yet. */
+  void Cancel();
+
+  /** Wait until a result is available, or for at most timeout. */
+  void WaitForResults(std::chrono::milliseconds timeout);
+
+  /** Number of objects added and not yet returned by TakeResults(). */
+  size_t outstanding() const { return objects_.size(); }
+
+ private:
+  void Work();
+
+  std::function<void()> on_result_;
+  std::mutex mutex_;
+  std::condition_variable jobs_cv_;
+  std::condition_variable results_cv_;
+  std::deque<OSTreeObject*> jobs_;
+  std::vector<std::pair<OSTreeObject*, bool>> results_;
+  bool shutdown_{false};
+  // Owner thread only.
+  std::unordered_map<OSTreeObject*, OSTreeObject::ptr> objects_;
+  std::vector<std::thread> workers_;
+};
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
+#endif  // SOTA_CLIENT_TOOLS_FSCK_POOL_H_
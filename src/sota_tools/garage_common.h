@@ -1,6 +1,7 @@
 #ifndef GARAGE_COMMON_H_
 #define GARAGE_COMMON_H_
 
+#include <curl/curl.h>
 #include "ostree-core.h"
 
 /** \file */
@@ -32,4 +33,10 @@ enum class RunMode {
  */
 const OstreeObjectType OSTREE_OBJECT_TYPE_UNKNOWN = static_cast<OstreeObjectType>(0);
 
+/* curl_multi_poll() and curl_multi_wakeup() appeared in curl 7.68.0. Older
+ * versions fall back to curl_multi_wait(). */
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define CURL_HAS_MULTI_POLL
+#endif
+
 #endif  // GARAGE_COMMON_H_
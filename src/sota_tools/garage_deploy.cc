@@ -110,13 +110,14 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
-  OSTreeRepo::ptr src_repo = std::make_shared<OSTreeHttpRepo>(&fetch_server);
+  auto http_repo = std::make_shared<OSTreeHttpRepo>(&fetch_server);
+  // The children of each commit and dirtree are fetched in parallel, with the
+  // same limit as the uploads.
+  http_repo->max_parallel_fetches(max_curl_requests);
+  OSTreeRepo::ptr src_repo = http_repo;
   try {
     OSTreeHash commit(OSTreeHash::Parse(ostree_commit));
     bool fsck = vm.count("disable-integrity-checks") == 0;
-    // Since the fetches happen on a single thread in OSTreeHttpRepo, there
-    // isn't much reason to upload in parallel, but why hold the system back if
-    // the fetching is faster than the uploading?
     if (!UploadToTreehub(src_repo, push_server, commit, mode, max_curl_requests, fsck)) {
       LOG_FATAL << "Upload to treehub failed";
       return EXIT_FAILURE;
@@ -10,6 +10,7 @@
 #include "logging/logging.h"
 #include "ostree_dir_repo.h"
 #include "ostree_repo.h"
+#include "presence_index.h"
 #include "utilities/xml2json.h"
 
 namespace po = boost::program_options;
@@ -22,6 +23,7 @@ int main(int argc, char **argv) {
   boost::filesystem::path credentials_path;
   std::string cacerts;
   boost::filesystem::path manifest_path;
+  boost::filesystem::path index_path;
   int max_curl_requests;
   RunMode mode = RunMode::kDefault;
   po::options_description desc("garage-push command line options");
@@ -40,7 +42,9 @@ int main(int argc, char **argv) {
     ("jobs", po::value<int>(&max_curl_requests)->default_value(30), "maximum number of parallel requests")
     ("dry-run,n", "check arguments and authenticate but don't upload")
     ("walk-tree,w", "walk entire tree and upload all missing objects")
-    ("disable-integrity-checks", "Don't validate the checksums of objects before uploading them");
+    ("disable-integrity-checks", "Don't validate the checksums of objects before uploading them")
+    ("index", po::value<boost::filesystem::path>(&index_path), "file recording the objects known to be on the server, to skip checking them again")
+    ("verify-index", "check a random 10% of the objects found in the --index file on the server anyway");
   // clang-format on
 
   po::variables_map vm;
@@ -108,6 +112,11 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+  if (vm.count("verify-index") != 0U && index_path.empty()) {
+    LOG_FATAL << "--verify-index requires --index";
+    return EXIT_FAILURE;
+  }
+
   OSTreeRepo::ptr src_repo = std::make_shared<OSTreeDirRepo>(repo_path);
   if (!src_repo->LooksValid()) {
     LOG_FATAL << "The OSTree src repository does not appear to contain a valid OSTree repository";
@@ -137,7 +146,12 @@ int main(int argc, char **argv) {
       return EXIT_FAILURE;
     }
     bool fsck = vm.count("disable-integrity-checks") == 0;
-    if (!UploadToTreehub(src_repo, push_server, *commit, mode, max_curl_requests, fsck)) {
+    std::unique_ptr<PresenceIndex> index;
+    if (!index_path.empty()) {
+      const double verify_fraction = vm.count("verify-index") != 0 ? 0.1 : 0.0;
+      index = std_::make_unique<PresenceIndex>(index_path, push_server.root_url(), verify_fraction);
+    }
+    if (!UploadToTreehub(src_repo, push_server, *commit, mode, max_curl_requests, fsck, index.get())) {
       LOG_FATAL << "Upload to treehub failed";
       return EXIT_FAILURE;
     }
@@ -1,5 +1,17 @@
 #include <gtest/gtest.h>
 
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "logging/logging.h"
 #include "ostree_dir_repo.h"
 #include "ostree_ref.h"
 
@@ -94,6 +106,60 @@ TEST(dir_repo, GetPathForHashExtensions) {
   EXPECT_ANY_THROW(OSTreeDirRepo::GetPathForHash(hash, OSTREE_OBJECT_TYPE_UNKNOWN));
 }
 
+static size_t ResidentBytes() {
+  std::ifstream statm("/proc/self/statm");
+  size_t total = 0;
+  size_t resident = 0;
+  statm >> total >> resident;
+  return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/* Load a synthetic repo of file objects into the object graph, the way
+ * garage-push does, and report the time and memory it takes. Not run by
+ * default, as it creates a couple of hundred thousand files; run it with
+ * --gtest_also_run_disabled_tests. */
+TEST(dir_repo, DISABLED_GetObjectBenchmark) {
+  const size_t count = 200000;
+  logger_set_threshold(boost::log::trivial::warning);
+  TemporaryDirectory temp_dir;
+  std::mt19937_64 rng(count);
+  std::vector<OSTreeHash> hashes;
+  hashes.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::array<uint8_t, 32> bytes{};
+    for (auto &byte : bytes) {
+      byte = static_cast<uint8_t>(rng());
+    }
+    hashes.emplace_back(bytes);
+    const auto path = temp_dir.Path() / "objects" / OSTreeRepo::GetPathForHash(hashes.back(), OSTREE_OBJECT_TYPE_FILE);
+    boost::filesystem::create_directories(path.parent_path());
+    std::ofstream{path.string()};
+  }
+
+  using clock = std::chrono::steady_clock;
+  auto ms = [](clock::duration d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+  OSTreeDirRepo repo(temp_dir.Path());
+  std::vector<OSTreeObject::ptr> objects;
+  objects.reserve(count);
+  const size_t memory_before = ResidentBytes();
+  auto start = clock::now();
+  for (const auto &hash : hashes) {
+    objects.push_back(repo.GetObject(hash, OSTREE_OBJECT_TYPE_FILE));
+  }
+  const auto load = clock::now() - start;
+  const size_t memory_used = ResidentBytes() - memory_before;
+
+  start = clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(repo.GetObject(hashes[i], OSTREE_OBJECT_TYPE_FILE), objects[i]);
+  }
+  const auto lookup = clock::now() - start;
+
+  std::cout << count << " objects: load " << ms(load) << " ms, lookup " << ms(lookup) << " ms, "
+            << memory_used / 1024 << " KiB (" << memory_used / count << " bytes per object, OSTreeObject is "
+            << sizeof(OSTreeObject) << ")\n";
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
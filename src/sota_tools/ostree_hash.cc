@@ -52,6 +52,16 @@ bool OSTreeHash::operator<(const OSTreeHash& other) const {
   return memcmp(hash_.data(), other.hash_.data(), hash_.size()) < 0;
 }
 
+bool OSTreeHash::operator==(const OSTreeHash& other) const {
+  return memcmp(hash_.data(), other.hash_.data(), hash_.size()) == 0;
+}
+
+size_t OSTreeHash::Hasher::operator()(const OSTreeHash& hash) const {
+  size_t value;
+  std::memcpy(&value, hash.hash_.data(), sizeof(value));
+  return value;
+}
+
 std::ostream& operator<<(std::ostream& os, const OSTreeHash& obj) {
   os << obj.string();
   return os;
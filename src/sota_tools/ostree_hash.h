@@ -2,6 +2,7 @@
 #define SOTA_CLIENT_TOOLS_OSTREE_HASH_H_
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <string>
@@ -22,6 +23,12 @@ class OSTreeHash {
   std::string string() const;
 
   bool operator<(const OSTreeHash& other) const;
+  bool operator==(const OSTreeHash& other) const;
+
+  /** The hash is already uniformly distributed, so its first bytes are used as is. */
+  struct Hasher {
+    size_t operator()(const OSTreeHash& hash) const;
+  };
   friend std::ostream& operator<<(std::ostream& os, const OSTreeHash& obj);
 
  private:
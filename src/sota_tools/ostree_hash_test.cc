@@ -35,6 +35,16 @@ TEST(ostree_hash, parse_junk) {
   EXPECT_THROW(OSTreeHash::Parse(str), OSTreeCommitParseError);
 }
 
+/* Compare OSTree hashes and hash them for lookups. */
+TEST(ostree_hash, equality) {
+  OSTreeHash a = OSTreeHash::Parse("1f3378927c2d062e40a372414c920219e506afeb8ef25f9ff72a27b792cd093a");
+  OSTreeHash b = OSTreeHash::Parse("1F3378927C2d062e40a372414c920219e506afeb8ef25f9ff72a27b792cd093a");
+  OSTreeHash c = OSTreeHash::Parse("1f3378927c2d062e40a372414c920219e506afeb8ef25f9ff72a27b792cd093b");
+  EXPECT_TRUE(a == b);
+  EXPECT_FALSE(a == c);
+  EXPECT_EQ(OSTreeHash::Hasher()(a), OSTreeHash::Hasher()(b));
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,6 +1,7 @@
 #include "ostree_http_repo.h"
 
 #include <fcntl.h>
+#include <list>
 #include <string>
 
 #include <boost/filesystem.hpp>
@@ -8,6 +9,15 @@
 
 namespace pt = boost::property_tree;
 
+namespace {
+// One download started by OSTreeHttpRepo::PrefetchObjects().
+struct PrefetchTransfer {
+  boost::filesystem::path path;
+  int fd{-1};
+  CurlEasyWrapper handle;
+};
+}  // namespace
+
 bool OSTreeHttpRepo::LooksValid() const {
   if (FetchObject("config")) {
     pt::ptree config;
@@ -33,7 +43,105 @@ bool OSTreeHttpRepo::LooksValid() const {
 
 OSTreeRef OSTreeHttpRepo::GetRef(const std::string &refname) const { return OSTreeRef(*server_, refname); }
 
+void OSTreeHttpRepo::PrefetchObjects(const std::vector<std::pair<OSTreeHash, OstreeObjectType>> &objects) const {
+  std::vector<boost::filesystem::path> pending;
+  for (const auto &object : objects) {
+    if (ObjectTable.Contains(object.first)) {
+      continue;
+    }
+    boost::filesystem::path path("objects");
+    path /= GetPathForHash(object.first, object.second);
+    if (prefetched_.count(path.string()) == 0) {
+      pending.push_back(path);
+    }
+  }
+  // A single object is fetched just as well by FetchObject().
+  if (pending.size() < 2) {
+    return;
+  }
+
+  std::list<PrefetchTransfer> running;
+  size_t next = 0;
+  size_t fetched = 0;
+  while (next < pending.size() || !running.empty()) {
+    while (next < pending.size() && running.size() < static_cast<size_t>(max_parallel_fetches_)) {
+      const boost::filesystem::path &path = pending[next++];
+      boost::filesystem::create_directories((root_ / path).parent_path());
+      const std::string filename = (root_ / path).string();
+      const int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH);
+      if (fd == -1) {
+        LOG_ERROR << "Failed to open file: " << filename;
+        continue;
+      }
+      running.emplace_back();
+      PrefetchTransfer &transfer = running.back();
+      transfer.path = path;
+      transfer.fd = fd;
+      CURL *handle = transfer.handle.get();
+      server_->InjectIntoCurl(path.string(), handle);
+      curlEasySetoptWrapper(handle, CURLOPT_VERBOSE, get_curlopt_verbose());
+      curlEasySetoptWrapper(handle, CURLOPT_WRITEFUNCTION, &OSTreeHttpRepo::curl_handle_write);
+      curlEasySetoptWrapper(handle, CURLOPT_WRITEDATA, &transfer.fd);
+      curlEasySetoptWrapper(handle, CURLOPT_FAILONERROR, true);
+      curlEasySetoptWrapper(handle, CURLOPT_PRIVATE, &transfer);
+      const CURLMcode err = curl_multi_add_handle(multi_, handle);
+      if (err != CURLM_OK) {
+        LOG_ERROR << "curl_multi_add_handle error: " << curl_multi_strerror(err);
+        close(fd);
+        remove(filename.c_str());
+        running.pop_back();
+      }
+    }
+
+    int still_running = 0;
+    CURLMcode mc = curl_multi_perform(multi_, &still_running);
+    if (mc == CURLM_OK && still_running > 0) {
+#ifdef CURL_HAS_MULTI_POLL
+      mc = curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+#else
+      mc = curl_multi_wait(multi_, nullptr, 0, 1000, nullptr);
+#endif
+    }
+    if (mc != CURLM_OK) {
+      LOG_ERROR << "Prefetching OSTree objects failed: " << curl_multi_strerror(mc);
+      for (auto &transfer : running) {
+        curl_multi_remove_handle(multi_, transfer.handle.get());
+        close(transfer.fd);
+        remove((root_ / transfer.path).c_str());
+      }
+      return;
+    }
+
+    int msgs_in_queue = 0;
+    CURLMsg *msg = nullptr;
+    while ((msg = curl_multi_info_read(multi_, &msgs_in_queue)) != nullptr) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      void *p = nullptr;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &p);
+      auto *transfer = static_cast<PrefetchTransfer *>(p);
+      curl_multi_remove_handle(multi_, msg->easy_handle);
+      close(transfer->fd);
+      if (msg->data.result == CURLE_OK) {
+        prefetched_.insert(transfer->path.string());
+        ++fetched;
+      } else {
+        // FetchObject() will try again and report the error.
+        LOG_DEBUG << "Prefetching " << transfer->path << " failed: " << curl_easy_strerror(msg->data.result);
+        remove((root_ / transfer->path).c_str());
+      }
+      running.remove_if([transfer](const PrefetchTransfer &t) { return &t == transfer; });
+    }
+  }
+  LOG_DEBUG << "Prefetched " << fetched << " of " << pending.size() << " OSTree objects";
+}
+
 bool OSTreeHttpRepo::FetchObject(const boost::filesystem::path &path) const {
+  if (prefetched_.erase(path.string()) != 0) {
+    return true;
+  }
+
   CURLcode err = CURLE_OK;
   server_->InjectIntoCurl(path.string(), easy_handle_.get());
   boost::filesystem::create_directories((root_ / path).parent_path());
@@ -1,6 +1,11 @@
 #ifndef SOTA_CLIENT_TOOLS_OSTREE_HTTP_REPO_H_
 #define SOTA_CLIENT_TOOLS_OSTREE_HTTP_REPO_H_
 
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <boost/filesystem/path.hpp>
 
 #include "logging/logging.h"
@@ -19,11 +24,22 @@ class OSTreeHttpRepo : public OSTreeRepo {
     curlEasySetoptWrapper(easy_handle_.get(), CURLOPT_VERBOSE, get_curlopt_verbose());
     curlEasySetoptWrapper(easy_handle_.get(), CURLOPT_WRITEFUNCTION, &OSTreeHttpRepo::curl_handle_write);
     curlEasySetoptWrapper(easy_handle_.get(), CURLOPT_FAILONERROR, true);
+    multi_ = curl_multi_init();
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_HTTP1 | CURLPIPE_MULTIPLEX);
   }
+  ~OSTreeHttpRepo() override { curl_multi_cleanup(multi_); }
+  OSTreeHttpRepo(const OSTreeHttpRepo&) = delete;
+  OSTreeHttpRepo(OSTreeHttpRepo&&) = delete;
+  OSTreeHttpRepo& operator=(const OSTreeHttpRepo&) = delete;
+  OSTreeHttpRepo& operator=(OSTreeHttpRepo&&) = delete;
 
   bool LooksValid() const override;
   OSTreeRef GetRef(const std::string& refname) const override;
   boost::filesystem::path root() const override { return root_; }
+  void PrefetchObjects(const std::vector<std::pair<OSTreeHash, OstreeObjectType>>& objects) const override;
+
+  /** Maximum number of objects downloaded at the same time by PrefetchObjects(). */
+  void max_parallel_fetches(int max) { max_parallel_fetches_ = max; }
 
  private:
   bool FetchObject(const boost::filesystem::path& path) const override;
@@ -33,6 +49,11 @@ class OSTreeHttpRepo : public OSTreeRepo {
   boost::filesystem::path root_;
   const TemporaryDirectory root_tmp_;
   mutable CurlEasyWrapper easy_handle_;
+  // Shared by all the prefetches so that connections to the server are reused.
+  CURLM* multi_;
+  int max_parallel_fetches_{30};
+  // Objects that PrefetchObjects() has completely downloaded.
+  mutable std::set<std::string> prefetched_;
 };
 
 // vim: set tabstop=2 shiftwidth=2 expandtab:
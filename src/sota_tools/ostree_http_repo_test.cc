@@ -63,6 +63,23 @@ TEST(http_repo, GetWrongObject) {
   EXPECT_THROW(src_repo->GetObject(hash, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META), OSTreeObjectMissing);
 }
 
+/* Prefetch several OSTree objects at once.
+ * Objects that are missing on the server are skipped. */
+TEST(http_repo, PrefetchObjects) {
+  TreehubServer server;
+  server.root_url("http://localhost:" + port);
+  OSTreeRepo::ptr src_repo = std::make_shared<OSTreeHttpRepo>(&server);
+  const auto present = OSTreeHash::Parse("446a0ef11b7cc167f3b603e585c7eeeeb675faa412d5ec73f62988eb0b6c5488");
+  const auto missing = OSTreeHash::Parse("0028dac42b76c2015ee3c41cc4183bb8b5c790fd21fa5cfa0802c6e11fd0edbe");
+  src_repo->PrefetchObjects({{present, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META},
+                             {missing, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META}});
+
+  const boost::filesystem::path objects = src_repo->root() / "objects";
+  EXPECT_TRUE(boost::filesystem::exists(objects / OSTreeRepo::GetPathForHash(present, OSTREE_OBJECT_TYPE_DIR_META)));
+  EXPECT_FALSE(boost::filesystem::exists(objects / OSTreeRepo::GetPathForHash(missing, OSTREE_OBJECT_TYPE_DIR_META)));
+  EXPECT_NO_THROW(src_repo->GetObject(present, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META));
+}
+
 /* Retry fetch if not found after first try.
  *
  * This test uses servers that drop every other request. The test should pass
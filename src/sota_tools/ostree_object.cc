@@ -7,6 +7,8 @@
 #include <cassert>
 #include <cstring>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #include "logging/logging.h"
 #include "ostree_repo.h"
@@ -36,44 +38,40 @@ OSTreeObject::~OSTreeObject() {
   }
 }
 
-void OSTreeObject::AddParent(OSTreeObject *parent, std::list<OSTreeObject::ptr>::iterator parent_it) {
-  parentref par;
+void OSTreeObject::AddParent(OSTreeObject *parent) { parents_.push_back(parent); }
 
-  par.first = parent;
-  par.second = parent_it;
-  parents_.push_back(par);
-}
-
-void OSTreeObject::ChildNotify(std::list<OSTreeObject::ptr>::iterator child_it) {
-  assert((*child_it)->is_on_server() == PresenceOnServer::kObjectPresent);
-  children_.erase(child_it);
+void OSTreeObject::ChildNotify() {
+  assert(pending_children_ > 0);
+  pending_children_--;
 }
 
 void OSTreeObject::NotifyParents(RequestPool &pool) {
   assert(is_on_server_ == PresenceOnServer::kObjectPresent);
 
-  for (parentref parent : parents_) {
-    parent.first->ChildNotify(parent.second);
-    if (parent.first->children_ready()) {
-      pool.AddUpload(parent.first);
+  // Parents are kept alive by the repo's object table.
+  std::vector<OSTreeObject *> parents;
+  parents.swap(parents_);
+  for (OSTreeObject *parent : parents) {
+    parent->ChildNotify();
+    if (parent->children_ready()) {
+      pool.AddUpload(parent);
     }
   }
 }
 
-void OSTreeObject::AppendChild(const OSTreeObject::ptr &child) {
+bool OSTreeObject::AppendChild(const OSTreeObject::ptr &child) {
   // the child could be already queried/uploaded by another parent
   if (child->is_on_server() == PresenceOnServer::kObjectPresent) {
-    return;
+    return false;
   }
 
-  children_.push_back(child);
-  auto last = children_.end();
-  last--;
-  child->AddParent(this, last);
+  pending_children_++;
+  child->AddParent(this);
+  return true;
 }
 
 // Can throw OSTreeObjectMissing if the repo is corrupt
-void OSTreeObject::PopulateChildren() {
+std::vector<OSTreeObject::ptr> OSTreeObject::PopulateChildren() {
   const GVariantType *content_type;
   bool is_commit;
 
@@ -84,7 +82,7 @@ void OSTreeObject::PopulateChildren() {
     content_type = OSTREE_TREE_GVARIANT_FORMAT;
     is_commit = false;
   } else {
-    return;
+    return {};
   }
 
   GError *gerror = nullptr;
@@ -100,6 +98,7 @@ void OSTreeObject::PopulateChildren() {
                               reinterpret_cast<GDestroyNotify>(g_mapped_file_unref), mfile);
   g_variant_ref_sink(contents);
 
+  std::vector<std::pair<OSTreeHash, OstreeObjectType>> children;
   if (is_commit) {
     // * - ay - Root tree contents
     GVariant *content_csum_variant = nullptr;
@@ -108,14 +107,14 @@ void OSTreeObject::PopulateChildren() {
     gsize n_elts;
     const auto *csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(content_csum_variant, &n_elts, 1));
     assert(n_elts == 32);
-    AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE));
+    children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE);
 
     // * - ay - Root tree metadata
     GVariant *meta_csum_variant = nullptr;
     g_variant_get_child(contents, 7, "@ay", &meta_csum_variant);
     csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(meta_csum_variant, &n_elts, 1));
     assert(n_elts == 32);
-    AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META));
+    children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META);
 
     g_variant_unref(meta_csum_variant);
     g_variant_unref(content_csum_variant);
@@ -138,7 +137,7 @@ void OSTreeObject::PopulateChildren() {
       gsize n_elts;
       const auto *csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(csum_variant, &n_elts, 1));
       assert(n_elts == 32);
-      AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_FILE));
+      children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_FILE);
 
       g_variant_unref(csum_variant);
     }
@@ -153,12 +152,12 @@ void OSTreeObject::PopulateChildren() {
       // First the .dirtree:
       const auto *csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(content_csum_variant, &n_elts, 1));
       assert(n_elts == 32);
-      AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE));
+      children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE);
 
       // Then the .dirmeta:
       csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(meta_csum_variant, &n_elts, 1));
       assert(n_elts == 32);
-      AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META));
+      children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META);
 
       g_variant_unref(meta_csum_variant);
       g_variant_unref(content_csum_variant);
@@ -168,10 +167,21 @@ void OSTreeObject::PopulateChildren() {
     g_variant_unref(files_variant);
   }
   g_variant_unref(contents);
+
+  // Let a remote repo fetch all the children at once rather than one by one.
+  repo_.PrefetchObjects(children);
+  std::vector<OSTreeObject::ptr> pending;
+  for (const auto &child : children) {
+    OSTreeObject::ptr object = repo_.GetObject(child.first, child.second);
+    if (AppendChild(object)) {
+      pending.push_back(std::move(object));
+    }
+  }
+  return pending;
 }
 
-void OSTreeObject::QueryChildren(RequestPool &pool) {
-  for (const OSTreeObject::ptr &child : children_) {
+void OSTreeObject::QueryChildren(RequestPool &pool, const std::vector<OSTreeObject::ptr> &children) {
+  for (const OSTreeObject::ptr &child : children) {
     if (child->is_on_server() == PresenceOnServer::kObjectStateUnknown) {
       pool.AddQuery(child);
     }
@@ -209,7 +219,7 @@ void OSTreeObject::MakeTestRequest(const TreehubServer &push_target, CURLM *curl
   curlEasySetoptWrapper(curl_handle_, CURLOPT_WRITEFUNCTION, &OSTreeObject::curl_handle_write);
   curlEasySetoptWrapper(curl_handle_, CURLOPT_WRITEDATA, this);
   curlEasySetoptWrapper(curl_handle_, CURLOPT_PRIVATE, this);  // Used by ostree_object_from_curl
-  http_response_.str("");                                      // Empty the response buffer
+  http_response_.clear();                                      // Empty the response buffer
 
   const CURLMcode err = curl_multi_add_handle(curl_multi_handle, curl_handle_);
   if (err != 0) {
@@ -219,6 +229,13 @@ void OSTreeObject::MakeTestRequest(const TreehubServer &push_target, CURLM *curl
   request_start_time_ = std::chrono::steady_clock::now();
 }
 
+void OSTreeObject::PresentInIndex(RequestPool &pool) {
+  LOG_DEBUG << "Present according to index: " << *this;
+  is_on_server_ = PresenceOnServer::kObjectPresent;
+  last_operation_result_ = ServerResponse::kOk;
+  NotifyParents(pool);
+}
+
 void OSTreeObject::Upload(TreehubServer &push_target, CURLM *curl_multi_handle, const RunMode mode) {
   if (mode == RunMode::kDefault || mode == RunMode::kPushTree) {
     LOG_INFO << "Uploading " << *this;
@@ -240,7 +257,7 @@ void OSTreeObject::Upload(TreehubServer &push_target, CURLM *curl_multi_handle,
   curlEasySetoptWrapper(curl_handle_, CURLOPT_USERAGENT, Utils::getUserAgent());
   curlEasySetoptWrapper(curl_handle_, CURLOPT_WRITEFUNCTION, &OSTreeObject::curl_handle_write);
   curlEasySetoptWrapper(curl_handle_, CURLOPT_WRITEDATA, this);
-  http_response_.str("");  // Empty the response buffer
+  http_response_.clear();  // Empty the response buffer
 
   struct stat file_info {};
   auto file_path = PathOnDisk();
@@ -268,14 +285,14 @@ void OSTreeObject::Upload(TreehubServer &push_target, CURLM *curl_multi_handle,
 
 void OSTreeObject::CheckChildren(RequestPool &pool, const long rescode) {  // NOLINT(google-runtime-int)
   try {
-    PopulateChildren();
-    LOG_TRACE << "Children of " << *this << ": " << children_.size();
+    const std::vector<OSTreeObject::ptr> children = PopulateChildren();
+    LOG_TRACE << "Children of " << *this << ": " << children.size();
     if (children_ready()) {
       if (rescode != 200) {
         pool.AddUpload(this);
       }
     } else {
-      QueryChildren(pool);
+      QueryChildren(pool, children);
     }
   } catch (const OSTreeObjectMissing &error) {
     LOG_ERROR << "Source OSTree repo does not contain object " << error.missing_object();
@@ -287,7 +304,7 @@ void OSTreeObject::PresenceError(RequestPool &pool, const int64_t rescode) {
   is_on_server_ = PresenceOnServer::kObjectStateUnknown;
   LOG_WARNING << "OSTree query reported an error code: " << rescode << " retrying...";
   LOG_DEBUG << "Http response code:" << rescode;
-  LOG_DEBUG << http_response_.str();
+  LOG_DEBUG << http_response_;
   last_operation_result_ = ServerResponse::kTemporaryFailure;
   pool.AddQuery(this);
 }
@@ -295,7 +312,7 @@ void OSTreeObject::PresenceError(RequestPool &pool, const int64_t rescode) {
 void OSTreeObject::UploadError(RequestPool &pool, const int64_t rescode) {
   LOG_WARNING << "OSTree upload reported an error code:" << rescode << " retrying...";
   LOG_DEBUG << "Http response code:" << rescode;
-  LOG_DEBUG << http_response_.str();
+  LOG_DEBUG << http_response_;
   is_on_server_ = PresenceOnServer::kObjectMissing;
   last_operation_result_ = ServerResponse::kTemporaryFailure;
   pool.AddUpload(this);
@@ -359,11 +376,13 @@ void OSTreeObject::CurlDone(CURLM *curl_multi_handle, RequestPool &pool) {
   curl_multi_remove_handle(curl_multi_handle, curl_handle_);
   curl_easy_cleanup(curl_handle_);
   curl_handle_ = nullptr;
+  // Only keep a response buffer while a request is in flight.
+  std::string().swap(http_response_);
 }
 
 size_t OSTreeObject::curl_handle_write(void *buffer, size_t size, size_t nmemb, void *userp) {
   auto *that = static_cast<OSTreeObject *>(userp);
-  that->http_response_.write(static_cast<const char *>(buffer), static_cast<std::streamsize>(size * nmemb));
+  that->http_response_.append(static_cast<const char *>(buffer), size * nmemb);
   return size * nmemb;
 }
 
@@ -375,27 +394,65 @@ OSTreeObject::ptr ostree_object_from_curl(CURL *curlhandle) {
   return boost::intrusive_ptr<OSTreeObject>(h);
 }
 
-bool OSTreeObject::Fsck() const {
-  GFile *repo_path_file = g_file_new_for_path(repo_.root().c_str());  // Never fails
-  OstreeRepo *repo = ostree_repo_new(repo_path_file);
-  GError *err = nullptr;
-  auto ok = ostree_repo_open(repo, nullptr, &err);
-
-  if (ok == FALSE) {
-    LOG_ERROR << "ostree_repo_open failed";
-    if (err != nullptr) {
-      LOG_ERROR << "err:" << err->message;
-      g_error_free(err);
+namespace {
+// Opening an OSTree repo reads its config and sets up caches, so each thread
+// that checks objects opens the repo once and keeps it until it exits.
+class OpenedRepo {
+ public:
+  OpenedRepo() = default;
+  ~OpenedRepo() { Reset(); }
+  OpenedRepo(const OpenedRepo &) = delete;
+  OpenedRepo(OpenedRepo &&) = delete;
+  OpenedRepo &operator=(const OpenedRepo &) = delete;
+  OpenedRepo &operator=(OpenedRepo &&) = delete;
+
+  OstreeRepo *Get(const boost::filesystem::path &root) {
+    if (repo_ != nullptr && root == root_) {
+      return repo_;
     }
+    Reset();
+
+    GFile *repo_path_file = g_file_new_for_path(root.c_str());  // Never fails
+    OstreeRepo *repo = ostree_repo_new(repo_path_file);
     g_object_unref(repo_path_file);
-    g_object_unref(repo);
-    return false;
+    GError *err = nullptr;
+    if (ostree_repo_open(repo, nullptr, &err) == FALSE) {
+      LOG_ERROR << "ostree_repo_open failed";
+      if (err != nullptr) {
+        LOG_ERROR << "err:" << err->message;
+        g_error_free(err);
+      }
+      g_object_unref(repo);
+      return nullptr;
+    }
+    repo_ = repo;
+    root_ = root;
+    return repo_;
   }
 
-  ok = ostree_repo_fsck_object(repo, type_, hash_.string().c_str(), nullptr, &err);
+ private:
+  void Reset() {
+    if (repo_ != nullptr) {
+      g_object_unref(repo_);
+      repo_ = nullptr;
+    }
+  }
 
-  g_object_unref(repo_path_file);
-  g_object_unref(repo);
+  OstreeRepo *repo_{nullptr};
+  boost::filesystem::path root_;
+};
+
+thread_local OpenedRepo opened_repo;
+}  // namespace
+
+bool OSTreeObject::Fsck() const {
+  OstreeRepo *repo = opened_repo.Get(repo_.root());
+  if (repo == nullptr) {
+    return false;
+  }
+
+  GError *err = nullptr;
+  auto ok = ostree_repo_fsck_object(repo, type_, hash_.string().c_str(), nullptr, &err);
 
   if (ok == FALSE) {
     LOG_WARNING << "Object " << *this << " is corrupt";
@@ -4,6 +4,8 @@
 #include <chrono>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include <curl/curl.h>
 #include <boost/filesystem/path.hpp>
@@ -54,6 +56,10 @@ class OSTreeObject {
    * present there. */
   void MakeTestRequest(const TreehubServer& push_target, CURLM* curl_multi_handle);
 
+  /* The presence index says this object is already on the destination server,
+   * so treat it as if a presence check had succeeded. */
+  void PresentInIndex(RequestPool& pool);
+
   /* Upload this object to the destination server. */
   void Upload(TreehubServer& push_target, CURLM* curl_multi_handle, RunMode mode);
 
@@ -62,9 +68,10 @@ class OSTreeObject {
 
   uintmax_t GetSize() const;
 
+  const OSTreeHash& hash() const { return hash_; }
   PresenceOnServer is_on_server() const { return is_on_server_; }
   CurrentOp operation() const { return current_operation_; }
-  bool children_ready() const { return children_.empty(); }
+  bool children_ready() const { return pending_children_ == 0; }
   void LaunchNotify() { is_on_server_ = PresenceOnServer::kObjectInProgress; }
   std::chrono::steady_clock::time_point RequestStartTime() const { return request_start_time_; }
   ServerResponse LastOperationResult() const { return last_operation_result_; }
@@ -72,25 +79,23 @@ class OSTreeObject {
   bool Fsck() const;
 
  private:
-  using childiter = std::list<OSTreeObject::ptr>::iterator;
-  using parentref = std::pair<OSTreeObject*, childiter>;
-
   /* Add parent to this object. */
-  void AddParent(OSTreeObject* parent, std::list<OSTreeObject::ptr>::iterator parent_it);
+  void AddParent(OSTreeObject* parent);
 
-  /* Child object of this object has been uploaded, remove it from the list. */
-  void ChildNotify(std::list<OSTreeObject::ptr>::iterator child_it);
+  /* Child object of this object has been uploaded, one less to wait for. */
+  void ChildNotify();
 
-  /* If the child has is not already on the server, add it to this object's list
-   * of children and add this object as the parent of the new child. */
-  void AppendChild(const OSTreeObject::ptr& child);
+  /* If the child is not already on the server, count it as pending and add
+   * this object as the parent of the new child. Returns true if it was added. */
+  bool AppendChild(const OSTreeObject::ptr& child);
 
-  /* Parse this object for children. */
-  void PopulateChildren();
+  /* Parse this object for children. Returns the children that are not on the
+   * server yet. */
+  std::vector<OSTreeObject::ptr> PopulateChildren();
 
   /* Add queries to the queue for any children whose presence on the server is
    * unknown. */
-  void QueryChildren(RequestPool& pool);
+  void QueryChildren(RequestPool& pool, const std::vector<OSTreeObject::ptr>& children);
 
   std::string Url() const;
 
@@ -127,11 +132,15 @@ class OSTreeObject {
   PresenceOnServer is_on_server_;
   CurrentOp current_operation_{};
 
-  std::stringstream http_response_;
+  // Only holds data while a request is in flight.
+  std::string http_response_;
   CURL* curl_handle_;
   FILE* fd_;
-  std::list<parentref> parents_;
-  std::list<OSTreeObject::ptr> children_;
+  // Objects that wait for this one to be on the server. The object table in
+  // OSTreeRepo owns them, so plain pointers are enough.
+  std::vector<OSTreeObject*> parents_;
+  // Number of children that are not yet known to be on the server.
+  size_t pending_children_{0};
 
   std::chrono::steady_clock::time_point request_start_time_;
   ServerResponse last_operation_result_{ServerResponse::kNoResponse};
@@ -0,0 +1,100 @@
+#ifndef SOTA_CLIENT_TOOLS_OSTREE_OBJECT_TABLE_H_
+#define SOTA_CLIENT_TOOLS_OSTREE_OBJECT_TABLE_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "ostree_hash.h"
+
+/**
+ * Hash table of OSTree objects, keyed on their OSTree hash.
+ *
+ * Repos with millions of objects made a node-based map both large and slow to
+ * search, so this uses open addressing with linear probing in a single flat
+ * array. Each slot holds the object pointer and the first bytes of its hash,
+ * so that most failed probes do not touch the object itself. Objects are never
+ * removed.
+ *
+ * T is a pointer-like type, e.g. OSTreeObject::ptr, and T->hash() must return
+ * the object's OSTreeHash.
+ */
+template <typename T>
+class OSTreeObjectTable {
+ public:
+  /** Return the object with the given hash, or a null T. */
+  T Find(const OSTreeHash& hash) const {
+    if (slots_.empty()) {
+      return T();
+    }
+    const size_t code = OSTreeHash::Hasher()(hash);
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = code & mask;; i = (i + 1) & mask) {
+      const Slot& slot = slots_[i];
+      if (!slot.value) {
+        return T();
+      }
+      if (slot.code == code && slot.value->hash() == hash) {
+        return slot.value;
+      }
+    }
+  }
+
+  bool Contains(const OSTreeHash& hash) const { return static_cast<bool>(Find(hash)); }
+
+  /** Add an object, replacing any object with the same hash. */
+  void Insert(T value) {
+    if ((size_ + 1) * 4 > slots_.size() * 3) {
+      Grow();
+    }
+    const size_t code = OSTreeHash::Hasher()(value->hash());
+    Place(code, std::move(value));
+  }
+
+  size_t size() const { return size_; }
+
+  /** Bytes used by the table itself, not counting the objects. */
+  size_t memory_used() const { return slots_.capacity() * sizeof(Slot); }
+
+ private:
+  static constexpr size_t kInitialSlots = 1024;
+
+  struct Slot {
+    size_t code{0};
+    T value{};
+  };
+
+  void Place(const size_t code, T value) {
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = code & mask;; i = (i + 1) & mask) {
+      Slot& slot = slots_[i];
+      if (!slot.value) {
+        slot.code = code;
+        slot.value = std::move(value);
+        size_++;
+        return;
+      }
+      if (slot.code == code && slot.value->hash() == value->hash()) {
+        slot.value = std::move(value);
+        return;
+      }
+    }
+  }
+
+  void Grow() {
+    std::vector<Slot> old(std::max(kInitialSlots, slots_.size() * 2));
+    old.swap(slots_);
+    size_ = 0;
+    for (Slot& slot : old) {
+      if (slot.value) {
+        Place(slot.code, std::move(slot.value));
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;  // Always empty or a power of two long
+  size_t size_{0};
+};
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
+#endif  // SOTA_CLIENT_TOOLS_OSTREE_OBJECT_TABLE_H_
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "ostree_object_table.h"
+
+namespace {
+
+struct FakeObject {
+  explicit FakeObject(const OSTreeHash& h) : hash_(h) {}
+  const OSTreeHash& hash() const { return hash_; }
+  OSTreeHash hash_;
+};
+
+using FakeTable = OSTreeObjectTable<std::shared_ptr<FakeObject>>;
+
+std::vector<OSTreeHash> SyntheticHashes(size_t count) {
+  std::mt19937_64 rng(count);
+  std::vector<OSTreeHash> hashes;
+  hashes.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::array<uint8_t, 32> bytes{};
+    for (auto& byte : bytes) {
+      byte = static_cast<uint8_t>(rng());
+    }
+    hashes.emplace_back(bytes);
+  }
+  return hashes;
+}
+
+}  // namespace
+
+/* Find objects that were inserted and nothing else. */
+TEST(ostree_object_table, insert_find) {
+  const auto hashes = SyntheticHashes(10000);
+  FakeTable table;
+  EXPECT_FALSE(table.Contains(hashes[0]));
+
+  for (size_t i = 0; i < hashes.size(); i += 2) {
+    table.Insert(std::make_shared<FakeObject>(hashes[i]));
+  }
+  EXPECT_EQ(table.size(), hashes.size() / 2);
+  for (size_t i = 0; i < hashes.size(); ++i) {
+    auto found = table.Find(hashes[i]);
+    if (i % 2 == 0) {
+      ASSERT_TRUE(found);
+      EXPECT_EQ(found->hash(), hashes[i]);
+    } else {
+      EXPECT_FALSE(found);
+    }
+  }
+}
+
+/* Inserting the same hash twice replaces the object. */
+TEST(ostree_object_table, replace) {
+  const auto hashes = SyntheticHashes(1);
+  FakeTable table;
+  auto first = std::make_shared<FakeObject>(hashes[0]);
+  auto second = std::make_shared<FakeObject>(hashes[0]);
+  table.Insert(first);
+  table.Insert(second);
+  EXPECT_EQ(table.size(), 1);
+  EXPECT_EQ(table.Find(hashes[0]), second);
+}
+
+/* Compare the table with the std::map it replaced, on a synthetic set of a
+ * million hashes. This only reports the numbers; it does not fail on them.
+ * Not run by default; run it with --gtest_also_run_disabled_tests. The
+ * dir_repo GetObjectBenchmark measures the whole object graph. */
+TEST(ostree_object_table, DISABLED_benchmark) {
+  const size_t count = 1000000;
+  const auto hashes = SyntheticHashes(count);
+  std::vector<std::shared_ptr<FakeObject>> objects;
+  objects.reserve(count);
+  for (const auto& hash : hashes) {
+    objects.push_back(std::make_shared<FakeObject>(hash));
+  }
+  using clock = std::chrono::steady_clock;
+  auto ms = [](clock::duration d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+
+  auto start = clock::now();
+  FakeTable table;
+  for (const auto& object : objects) {
+    table.Insert(object);
+  }
+  const auto table_insert = clock::now() - start;
+  start = clock::now();
+  size_t found = 0;
+  for (const auto& hash : hashes) {
+    found += table.Contains(hash) ? 1 : 0;
+  }
+  const auto table_find = clock::now() - start;
+  EXPECT_EQ(found, count);
+
+  start = clock::now();
+  std::map<OSTreeHash, std::shared_ptr<FakeObject>> map;
+  for (const auto& object : objects) {
+    map[object->hash()] = object;
+  }
+  const auto map_insert = clock::now() - start;
+  start = clock::now();
+  found = 0;
+  for (const auto& hash : hashes) {
+    found += map.count(hash);
+  }
+  const auto map_find = clock::now() - start;
+  EXPECT_EQ(found, count);
+
+  // A std::map node holds the key, the value and three pointers and a color,
+  // plus allocator overhead.
+  const size_t map_memory = count * (sizeof(OSTreeHash) + sizeof(std::shared_ptr<FakeObject>) + 4 * sizeof(void*) + 16);
+  std::cout << count << " objects:\n"
+            << "  open addressing: insert " << ms(table_insert) << " ms, find " << ms(table_find) << " ms, "
+            << table.memory_used() / (1024 * 1024) << " MiB\n"
+            << "  std::map:        insert " << ms(map_insert) << " ms, find " << ms(map_find) << " ms, ~"
+            << map_memory / (1024 * 1024) << " MiB\n";
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
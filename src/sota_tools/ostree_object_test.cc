@@ -1,9 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <map>
+
 #include <curl/curl.h>
 #include <boost/process.hpp>
 
 #include "authenticate.h"
+#include "fsck_pool.h"
 #include "garage_common.h"
 #include "ostree_dir_repo.h"
 #include "ostree_object.h"
@@ -61,6 +64,34 @@ TEST(OstreeObject, Fsck) {
   EXPECT_FALSE(corrupt_object->Fsck());
 }
 
+/* Check objects on worker threads and collect the results. */
+TEST(OstreeObject, FsckPool) {
+  OSTreeDirRepo repo("tests/sota_tools/corrupt-repo");
+  auto good_object =
+      repo.GetObject(OSTreeHash::Parse("2ee758031340b51db1c0229bddd8f64bca4b131728d2bfb20c0c8671b1259a38"),
+                     OstreeObjectType::OSTREE_OBJECT_TYPE_FILE);
+  auto corrupt_object =
+      repo.GetObject(OSTreeHash::Parse("4145b1a9bade30efb28ff921f7a555ff82ba7d3b7b83b968084436167912fa83"),
+                     OstreeObjectType::OSTREE_OBJECT_TYPE_FILE);
+
+  FsckPool pool(2);
+  pool.Add(good_object);
+  pool.Add(corrupt_object);
+  pool.Add(good_object);  // Ignored, already queued
+  EXPECT_EQ(pool.outstanding(), 2);
+
+  std::map<OSTreeObject*, bool> results;
+  while (pool.outstanding() > 0) {
+    pool.WaitForResults(std::chrono::milliseconds(100));
+    for (const auto& result : pool.TakeResults()) {
+      results[result.first.get()] = result.second;
+    }
+  }
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_TRUE(results[good_object.get()]);
+  EXPECT_FALSE(results[corrupt_object.get()]);
+}
+
 // This is a class solely for the purpose of being a FRIEND_TEST to
 // OSTreeObject. The name is carefully constructed for this purpose.
 class OstreeObject_Request_Test {
@@ -9,9 +9,9 @@ OSTreeObject::ptr OSTreeRepo::GetObject(const uint8_t sha256[32], const OstreeOb
 
 OSTreeObject::ptr OSTreeRepo::GetObject(const OSTreeHash hash, const OstreeObjectType type) const {
   // If we've already seen this object, return another pointer to it
-  auto obj_it = ObjectTable.find(hash);
-  if (obj_it != ObjectTable.cend()) {
-    return obj_it->second;
+  OSTreeObject::ptr known = ObjectTable.Find(hash);
+  if (known) {
+    return known;
   }
 
   OSTreeObject::ptr object;
@@ -50,7 +50,7 @@ bool OSTreeRepo::CheckForObject(const OSTreeHash &hash, OstreeObjectType type, O
   path /= GetPathForHash(hash, type);
   if (FetchObject(path)) {
     auto object = OSTreeObject::ptr(new OSTreeObject(*this, hash, type));
-    ObjectTable[hash] = object;
+    ObjectTable.Insert(object);
     *object_out = object;
     LOG_DEBUG << "Fetched OSTree object " << path;
     return true;
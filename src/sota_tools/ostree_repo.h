@@ -1,14 +1,16 @@
 #ifndef SOTA_CLIENT_TOOLS_OSTREE_REPO_H_
 #define SOTA_CLIENT_TOOLS_OSTREE_REPO_H_
 
-#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/filesystem/path.hpp>
 
 #include "garage_common.h"
 #include "ostree_hash.h"
 #include "ostree_object.h"
+#include "ostree_object_table.h"
 
 class OSTreeRef;
 
@@ -35,6 +37,15 @@ class OSTreeRepo {
   // NOLINTNEXTLINE(modernize-avoid-c-arrays, cppcoreguidelines-avoid-c-arrays, hicpp-avoid-c-arrays)
   OSTreeObject::ptr GetObject(const uint8_t sha256[32], OstreeObjectType type) const;
 
+  /**
+   * Hint that the given objects will be requested with GetObject() soon.
+   * Repositories that have to download objects can fetch them in parallel
+   * here. Failures are ignored; GetObject() will try again.
+   */
+  virtual void PrefetchObjects(const std::vector<std::pair<OSTreeHash, OstreeObjectType>>& objects) const {
+    (void)objects;
+  }
+
   static boost::filesystem::path GetPathForHash(OSTreeHash hash, OstreeObjectType type);
 
  protected:
@@ -52,7 +63,7 @@ class OSTreeRepo {
 
   bool CheckForObject(const OSTreeHash& hash, OstreeObjectType type, OSTreeObject::ptr* object) const;
 
-  using otable = std::map<OSTreeHash, OSTreeObject::ptr>;
+  using otable = OSTreeObjectTable<OSTreeObject::ptr>;
   mutable otable ObjectTable;  // Makes sure that the same commit object is not added twice
 };
 
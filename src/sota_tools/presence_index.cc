@@ -0,0 +1,100 @@
+#include "presence_index.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#include <boost/filesystem.hpp>
+
+#include "logging/logging.h"
+
+PresenceIndex::PresenceIndex(boost::filesystem::path path, std::string server_url, const double verify_fraction)
+    : path_(std::move(path)),
+      server_url_(std::move(server_url)),
+      rng_(std::random_device{}()),
+      verify_(verify_fraction) {
+  Load();
+}
+
+void PresenceIndex::Load() {
+  std::ifstream in(path_.string());
+  if (!in) {
+    LOG_DEBUG << "No presence index at " << path_ << ", starting an empty one";
+    return;
+  }
+
+  std::string line;
+  if (!std::getline(in, line) || line != kHeader + server_url_) {
+    LOG_WARNING << "Presence index " << path_ << " was not written for " << server_url_ << ", ignoring it";
+    return;
+  }
+
+  bool sorted = true;
+  while (std::getline(in, line)) {
+    try {
+      OSTreeHash hash = OSTreeHash::Parse(line);
+      if (!present_.empty() && !(present_.back() < hash)) {
+        sorted = false;
+      }
+      present_.push_back(hash);
+    } catch (const OSTreeCommitParseError &e) {
+      LOG_WARNING << "Presence index " << path_ << " is corrupt, ignoring it";
+      present_.clear();
+      return;
+    }
+  }
+  if (!sorted) {
+    std::sort(present_.begin(), present_.end());
+  }
+  LOG_INFO << "Loaded " << present_.size() << " objects from presence index " << path_;
+}
+
+bool PresenceIndex::Contains(const OSTreeHash &hash) const {
+  return std::binary_search(present_.begin(), present_.end(), hash) || added_.count(hash) != 0;
+}
+
+bool PresenceIndex::ShouldVerify() { return verify_(rng_); }
+
+void PresenceIndex::Insert(const OSTreeHash &hash) {
+  if (!std::binary_search(present_.begin(), present_.end(), hash)) {
+    added_.insert(hash);
+  }
+}
+
+void PresenceIndex::Clear() {
+  present_.clear();
+  added_.clear();
+}
+
+bool PresenceIndex::Save() {
+  std::vector<OSTreeHash> merged;
+  merged.reserve(present_.size() + added_.size());
+  std::merge(present_.begin(), present_.end(), added_.begin(), added_.end(), std::back_inserter(merged));
+  present_ = std::move(merged);
+  added_.clear();
+
+  const boost::filesystem::path tmp_path = path_.string() + ".tmp";
+  {
+    std::ofstream out(tmp_path.string(), std::ios::trunc);
+    out << kHeader << server_url_ << '\n';
+    for (const auto &hash : present_) {
+      out << hash.string() << '\n';
+    }
+    if (!out.flush()) {
+      LOG_ERROR << "Could not write presence index " << tmp_path;
+      return false;
+    }
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::rename(tmp_path, path_, ec);
+  if (ec) {
+    LOG_ERROR << "Could not replace presence index " << path_ << ": " << ec.message();
+    return false;
+  }
+  LOG_DEBUG << "Saved " << present_.size() << " objects to presence index " << path_;
+  return true;
+}
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -0,0 +1,72 @@
+#ifndef SOTA_CLIENT_TOOLS_PRESENCE_INDEX_H_
+#define SOTA_CLIENT_TOOLS_PRESENCE_INDEX_H_
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include "ostree_hash.h"
+
+/**
+ * Local record of the OSTree objects that are known to be present on one
+ * Treehub server, so that later uploads to the same server can skip the HEAD
+ * request for them.
+ *
+ * The file starts with a header line naming the server and is followed by the
+ * object hashes, one per line, in sorted order. An index written for a
+ * different server is ignored and replaced on the next Save().
+ */
+class PresenceIndex {
+ public:
+  /**
+   * Load the index for server_url from path. A missing or unreadable file
+   * gives an empty index.
+   * \param verify_fraction Fraction of the objects found in the index that
+   *                        should still be checked on the server.
+   */
+  PresenceIndex(boost::filesystem::path path, std::string server_url, double verify_fraction = 0.0);
+
+  /** The object is recorded as present on the server. */
+  bool Contains(const OSTreeHash& hash) const;
+
+  /**
+   * Decide whether an object found in the index should be checked on the
+   * server anyway. Only meaningful in --verify-index mode.
+   */
+  bool ShouldVerify();
+
+  /** Record an object that the server has confirmed to have. */
+  void Insert(const OSTreeHash& hash);
+
+  /**
+   * Forget everything. Used when the server turns out not to have an object
+   * that the index claims it has.
+   */
+  void Clear();
+
+  /** Write the index back to disk. */
+  bool Save();
+
+  size_t size() const { return present_.size() + added_.size(); }
+
+ private:
+  static constexpr const char* kHeader = "garage-push presence index v1 ";
+
+  void Load();
+
+  const boost::filesystem::path path_;
+  const std::string server_url_;
+  // Objects loaded from disk, sorted. Kept as a flat vector since it can hold
+  // hundreds of thousands of entries.
+  std::vector<OSTreeHash> present_;
+  // Objects confirmed during this run.
+  std::set<OSTreeHash> added_;
+  std::mt19937 rng_;
+  std::bernoulli_distribution verify_;
+};
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
+#endif  // SOTA_CLIENT_TOOLS_PRESENCE_INDEX_H_
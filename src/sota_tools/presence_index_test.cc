@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "presence_index.h"
+#include "utilities/utils.h"
+
+static const OSTreeHash kFirst = OSTreeHash::Parse("16ef2f2629dc9263fdf3c0f032563a2d757623bbc11cf99df25c3c3f258dccbe");
+static const OSTreeHash kSecond = OSTreeHash::Parse("1f3378927c2d062e40a372414c920219e506afeb8ef25f9ff72a27b792cd093a");
+
+/* Objects recorded in the index are found again after reloading it. */
+TEST(presence_index, save_and_load) {
+  TemporaryDirectory temp_dir;
+  const auto path = temp_dir.Path() / "index";
+  {
+    PresenceIndex index(path, "https://treehub.example.com");
+    EXPECT_EQ(index.size(), 0U);
+    index.Insert(kSecond);
+    index.Insert(kFirst);
+    index.Insert(kFirst);
+    EXPECT_TRUE(index.Contains(kFirst));
+    EXPECT_TRUE(index.Save());
+  }
+
+  PresenceIndex index(path, "https://treehub.example.com");
+  EXPECT_EQ(index.size(), 2U);
+  EXPECT_TRUE(index.Contains(kFirst));
+  EXPECT_TRUE(index.Contains(kSecond));
+  EXPECT_FALSE(index.ShouldVerify());
+}
+
+/* An index written for another server is ignored. */
+TEST(presence_index, other_server) {
+  TemporaryDirectory temp_dir;
+  const auto path = temp_dir.Path() / "index";
+  {
+    PresenceIndex index(path, "https://treehub.example.com");
+    index.Insert(kFirst);
+    EXPECT_TRUE(index.Save());
+  }
+
+  PresenceIndex index(path, "https://other.example.com");
+  EXPECT_EQ(index.size(), 0U);
+  EXPECT_FALSE(index.Contains(kFirst));
+}
+
+/* A corrupt index is ignored. */
+TEST(presence_index, corrupt) {
+  TemporaryDirectory temp_dir;
+  const auto path = temp_dir.Path() / "index";
+  Utils::writeFile(path, std::string("garage-push presence index v1 https://treehub.example.com\n") + kFirst.string() +
+                             "\nnot a hash\n");
+
+  PresenceIndex index(path, "https://treehub.example.com");
+  EXPECT_FALSE(index.Contains(kFirst));
+}
+
+/* Clearing the index drops the saved objects as well. */
+TEST(presence_index, clear) {
+  TemporaryDirectory temp_dir;
+  const auto path = temp_dir.Path() / "index";
+  PresenceIndex index(path, "https://treehub.example.com", 1.0);
+  index.Insert(kFirst);
+  EXPECT_TRUE(index.ShouldVerify());
+  index.Clear();
+  EXPECT_TRUE(index.Save());
+
+  PresenceIndex reloaded(path, "https://treehub.example.com");
+  EXPECT_EQ(reloaded.size(), 0U);
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
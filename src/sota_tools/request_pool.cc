@@ -6,17 +6,27 @@
 #include <thread>
 
 #include "logging/logging.h"
+#include "utilities/utils.h"
 
-RequestPool::RequestPool(TreehubServer& server, const int max_curl_requests, const RunMode mode, bool fsck_on_upload)
+RequestPool::RequestPool(TreehubServer& server, const int max_curl_requests, const RunMode mode, bool fsck_on_upload,
+                         PresenceIndex* presence_index)
     : rate_controller_(max_curl_requests),
       running_requests_(0),
       server_(server),
       mode_(mode),
       fsck_on_upload_(fsck_on_upload),
+      presence_index_(presence_index),
       stopped_(false) {
   curl_global_init(CURL_GLOBAL_DEFAULT);
   multi_ = curl_multi_init();
   curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_HTTP1 | CURLPIPE_MULTIPLEX);
+  if (fsck_on_upload_) {
+#ifdef CURL_HAS_MULTI_POLL
+    fsck_pool_ = std_::make_unique<FsckPool>(0, [this]() { curl_multi_wakeup(multi_); });
+#else
+    fsck_pool_ = std_::make_unique<FsckPool>();
+#endif
+  }
 }
 
 RequestPool::~RequestPool() {
@@ -29,6 +39,8 @@ RequestPool::~RequestPool() {
     }
     LOG_INFO << "...done";
 
+    // The workers may still use multi_ to wake us up.
+    fsck_pool_.reset();
     curl_multi_cleanup(multi_);
     curl_global_cleanup();
   } catch (std::exception& ex) {
@@ -48,7 +60,60 @@ void RequestPool::AddQuery(const OSTreeObject::ptr& request) {
 void RequestPool::AddUpload(const OSTreeObject::ptr& request) {
   request->LaunchNotify();
   if (!stopped_) {
-    upload_queue_.push_back(request);
+    // Check object's integrity before uploading them, but after we know they
+    // are not present on the server
+    if (fsck_pool_ != nullptr) {
+      fsck_pool_->Add(request);
+    } else {
+      upload_queue_.push_back(request);
+    }
+  }
+}
+
+void RequestPool::CollectFsckResults() {
+  if (fsck_pool_ == nullptr) {
+    return;
+  }
+  for (const auto& result : fsck_pool_->TakeResults()) {
+    if (stopped_) {
+      continue;
+    }
+    if (!result.second) {
+      LOG_ERROR << "Local object " << result.first << " is corrupt. Aborting upload.";
+      Abort();
+      continue;
+    }
+    upload_queue_.push_back(result.first);
+  }
+}
+
+bool RequestPool::SkipQuery(const OSTreeObject::ptr& request) {
+  // Walking the tree needs the children of present objects too, so the index
+  // only helps when a present object ends the walk.
+  if (presence_index_ == nullptr || (mode_ != RunMode::kDefault && mode_ != RunMode::kDryRun)) {
+    return false;
+  }
+  if (!presence_index_->Contains(request->hash()) || presence_index_->ShouldVerify()) {
+    return false;
+  }
+  request->PresentInIndex(*this);
+  index_hits_++;
+  return true;
+}
+
+void RequestPool::UpdateIndex(const OSTreeObject::ptr& completed) {
+  if (presence_index_ == nullptr || completed->LastOperationResult() != ServerResponse::kOk) {
+    return;
+  }
+  if (completed->is_on_server() == PresenceOnServer::kObjectPresent) {
+    presence_index_->Insert(completed->hash());
+  } else if (completed->operation() == CurrentOp::kOstreeObjectPresenceCheck &&
+             presence_index_->Contains(completed->hash())) {
+    // Objects that were skipped earlier in this run may be missing as well,
+    // so nothing uploaded on top of them can be trusted.
+    LOG_ERROR << "Object " << completed << " is in the presence index but not on the server";
+    index_stale_ = true;
+    Abort();
   }
 }
 
@@ -61,15 +126,6 @@ void RequestPool::LoopLaunch() {
       // Uploads
       cur = upload_queue_.front();
       upload_queue_.pop_front();
-      // Check object's integrity before uploading them, but after we know they
-      // are not present on the server
-      if (fsck_on_upload_) {
-        if (!cur->Fsck()) {
-          LOG_ERROR << "Local object " << cur << " is corrupt. Aborting upload.";
-          Abort();
-          continue;
-        }
-      }
       cur->Upload(server_, multi_, mode_);
       put_requests_made_++;
       total_object_size_ += cur->GetSize();
@@ -82,6 +138,9 @@ void RequestPool::LoopLaunch() {
       // Queries
       cur = query_queue_.front();
       query_queue_.pop_front();
+      if (SkipQuery(cur)) {
+        continue;
+      }
       cur->MakeTestRequest(server_, multi_);
       head_requests_made_++;
     }
@@ -93,53 +152,54 @@ void RequestPool::LoopLaunch() {
 void RequestPool::LoopListen() {
   // For more information about the timeout logic, read these:
   // https://curl.haxx.se/libcurl/c/curl_multi_timeout.html
-  // https://curl.haxx.se/libcurl/c/curl_multi_fdset.html
+  // https://curl.haxx.se/libcurl/c/curl_multi_poll.html
   CURLMcode mc;
-  // Poll for IO
-  fd_set fdread;
-  fd_set fdwrite;
-  fd_set fdexcept;
-  int maxfd = 0;
-  FD_ZERO(&fdread);    // NOLINT(readability-isolate-declaration)
-  FD_ZERO(&fdwrite);   // NOLINT(readability-isolate-declaration)
-  FD_ZERO(&fdexcept);  // NOLINT(readability-isolate-declaration)
   long timeoutms = 0;  // NOLINT(google-runtime-int)
   mc = curl_multi_timeout(multi_, &timeoutms);
   if (mc != CURLM_OK) {
     throw std::runtime_error("curl_multi_timeout failed with error");
   }
+  // "You must not wait too long (more than a few seconds perhaps)".
+  if (timeoutms < 0 || timeoutms > kMaxWaitMs) {
+    timeoutms = kMaxWaitMs;
+  }
+  const bool fsck_pending = fsck_pool_ != nullptr && fsck_pool_->outstanding() > 0;
+
   // If timeoutms is 0, "it means you should proceed immediately without waiting
   // for anything".
-  if (timeoutms != 0) {
-    mc = curl_multi_fdset(multi_, &fdread, &fdwrite, &fdexcept, &maxfd);
+  if (timeoutms != 0 && (running_requests_ > 0 || fsck_pending)) {
+#ifdef CURL_HAS_MULTI_POLL
+    // Waits on curl's own sockets only, however many there are. Finished
+    // integrity checks interrupt the wait with curl_multi_wakeup().
+    mc = curl_multi_poll(multi_, nullptr, 0, static_cast<int>(timeoutms), nullptr);
     if (mc != CURLM_OK) {
-      throw std::runtime_error("curl_multi_fdset failed with error");
+      throw std::runtime_error(std::string("curl_multi_poll failed with error: ") + curl_multi_strerror(mc));
     }
-
-    struct timeval timeout {};
-    if (maxfd != -1) {
-      // "Wait for activities no longer than the set timeout."
-      if (timeoutms == -1) {
-        // "You must not wait too long (more than a few seconds perhaps)".
-        timeout.tv_sec = 3;
-        timeout.tv_usec = 0;
-      } else {
-        timeout.tv_sec = timeoutms / 1000;
-        timeout.tv_usec = 1000 * (timeoutms % 1000);
-      }
-      if (select(maxfd + 1, &fdread, &fdwrite, &fdexcept, &timeout) < 0) {
-        throw std::runtime_error(std::string("select failed with error: ") + std::strerror(errno));
+#else
+    // Without curl_multi_wakeup(), don't let objects that have passed their
+    // integrity check wait long for the next curl event.
+    if (fsck_pending) {
+      timeoutms = std::min(timeoutms, kFsckPollMs);
+    }
+    int numfds = 0;
+    if (running_requests_ > 0) {
+      mc = curl_multi_wait(multi_, nullptr, 0, static_cast<int>(timeoutms), &numfds);
+      if (mc != CURLM_OK) {
+        throw std::runtime_error(std::string("curl_multi_wait failed with error: ") + curl_multi_strerror(mc));
       }
-    } else if (timeoutms > 0) {
-      // If maxfd == -1, then wait the lesser of timeoutms and 100 ms.
+    }
+    if (numfds == 0) {
+      // curl_multi_wait() returns at once when curl has no sockets to wait on
+      // yet, so wait the lesser of timeoutms and 100 ms.
       long nofd_timeoutms = std::min(timeoutms, static_cast<long>(100));  // NOLINT(google-runtime-int)
-      LOG_DEBUG << "Waiting " << nofd_timeoutms << " ms for curl";
-      timeout.tv_sec = 0;
-      timeout.tv_usec = 1000 * (nofd_timeoutms % 1000);
-      if (select(0, nullptr, nullptr, nullptr, &timeout) < 0) {
-        throw std::runtime_error(std::string("select failed with error: ") + std::strerror(errno));
+      if (fsck_pending) {
+        fsck_pool_->WaitForResults(std::chrono::milliseconds(nofd_timeoutms));
+      } else {
+        LOG_DEBUG << "Waiting " << nofd_timeoutms << " ms for curl";
+        std::this_thread::sleep_for(std::chrono::milliseconds(nofd_timeoutms));
       }
     }
+#endif
   }
 
   // Ask curl to handle IO
@@ -156,6 +216,7 @@ void RequestPool::LoopListen() {
     if ((msg != nullptr) && msg->msg == CURLMSG_DONE) {
       OSTreeObject::ptr completed_object = ostree_object_from_curl(msg->easy_handle);
       completed_object->CurlDone(multi_, *this);
+      UpdateIndex(completed_object);
       auto start_time = completed_object->RequestStartTime();
       auto end_time = RateController::clock::now();
       bool server_responded_ok = completed_object->LastOperationResult() == ServerResponse::kOk;
@@ -173,6 +234,8 @@ void RequestPool::LoopListen() {
       }
     }
   } while (msgs_in_queue > 0);
+
+  CollectFsckResults();
 }
 
 void RequestPool::Loop() {
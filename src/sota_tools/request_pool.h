@@ -2,16 +2,20 @@
 #define SOTA_CLIENT_TOOLS_REQUEST_POOL_H_
 
 #include <list>
+#include <memory>
 
 #include <curl/curl.h>
 
+#include "fsck_pool.h"
 #include "garage_common.h"
 #include "ostree_object.h"
+#include "presence_index.h"
 #include "rate_controller.h"
 
 class RequestPool {
  public:
-  RequestPool(TreehubServer& server, int max_curl_requests, RunMode mode, bool fsck_on_upload);
+  RequestPool(TreehubServer& server, int max_curl_requests, RunMode mode, bool fsck_on_upload,
+              PresenceIndex* presence_index = nullptr);
   ~RequestPool();
   // Non-Copyable, Non-Movable
   RequestPool(const RequestPool&) = delete;
@@ -25,8 +29,14 @@ class RequestPool {
     stopped_ = true;
     query_queue_.clear();
     upload_queue_.clear();
+    if (fsck_pool_ != nullptr) {
+      fsck_pool_->Cancel();
+    }
   };
-  bool is_idle() const { return query_queue_.empty() && upload_queue_.empty() && running_requests_ == 0; }
+  bool is_idle() const {
+    return query_queue_.empty() && upload_queue_.empty() && running_requests_ == 0 &&
+           (fsck_pool_ == nullptr || fsck_pool_->outstanding() == 0);
+  }
   bool is_stopped() const { return stopped_; }
   RunMode run_mode() const { return mode_; }
 
@@ -42,22 +52,41 @@ class RequestPool {
   int put_requests_made() const { return put_requests_made_; }
   int head_requests_made() const { return head_requests_made_; }
   uintmax_t total_object_size() const { return total_object_size_; }
+  /** The number of presence checks that were answered from the presence index. */
+  int index_hits() const { return index_hits_; }
+  /** A sampled presence check found an object missing that the index claimed was present. */
+  bool index_stale() const { return index_stale_; }
 
  private:
+  // How long LoopListen() waits for curl at most.
+  static constexpr long kMaxWaitMs = 3000;  // NOLINT(google-runtime-int)
+  // Same, while integrity checks are running and curl_multi_wakeup() is not
+  // available to cut the wait short.
+  static constexpr long kFsckPollMs = 50;  // NOLINT(google-runtime-int)
+
   void LoopLaunch();  // launches multiple requests from the queues
   void LoopListen();  // listens to the result of launched requests
+  bool SkipQuery(const OSTreeObject::ptr& request);
+  void UpdateIndex(const OSTreeObject::ptr& completed);
+  void CollectFsckResults();  // moves checked objects to the upload queue
 
   RateController rate_controller_;
   int running_requests_;
   int head_requests_made_{0};
   int put_requests_made_{0};
   uintmax_t total_object_size_{0};
+  int index_hits_{0};
+  bool index_stale_{false};
   TreehubServer& server_;
   CURLM* multi_;
   std::list<OSTreeObject::ptr> query_queue_;
   std::list<OSTreeObject::ptr> upload_queue_;
+  // Objects are checked here before they join upload_queue_, if
+  // fsck_on_upload_ is set.
+  std::unique_ptr<FsckPool> fsck_pool_;
   RunMode mode_;
   bool fsck_on_upload_;
+  PresenceIndex* presence_index_;
   bool stopped_;
 };
 // vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -58,6 +58,7 @@ ManagedSecondary::ManagedSecondary(Primary::ManagedSecondaryConfig sconfig_in) :
 
   director_repo_ = std_::make_unique<Uptane::DirectorRepository>();
   image_repo_ = std_::make_unique<Uptane::ImageRepository>();
+  firmware_info_cache_ = std_::make_unique<Uptane::ImageFileInfoCache>(sconfig.firmware_path);
 
   try {
     director_repo_->checkMetaOffline(*storage_);
@@ -184,6 +185,9 @@ data::InstallationResult ManagedSecondary::install(const Uptane::Target &target,
   out_file.close();
 
   Utils::writeFile(sconfig.target_name_path, target.filename());
+  if (!target.sha256Hash().empty()) {
+    firmware_info_cache_->set(target.sha256Hash());
+  }
   return data::InstallationResult(data::ResultCode::Numeric::kOk, "");
 }
 
@@ -215,17 +219,18 @@ Uptane::Manifest ManagedSecondary::getManifest() const {
 }
 
 bool ManagedSecondary::getFirmwareInfo(Uptane::InstalledImageInfo &firmware_info) const {
-  std::string content;
+  uint64_t len = 0;
+  std::string hash;
 
-  if (!boost::filesystem::exists(sconfig.target_name_path) || !boost::filesystem::exists(sconfig.firmware_path)) {
+  if (!boost::filesystem::exists(sconfig.target_name_path) || !firmware_info_cache_->get(&len, &hash)) {
     firmware_info.name = std::string("noimage");
-    content = "";
+    firmware_info.hash = Uptane::ManifestIssuer::generateVersionHashStr("");
+    firmware_info.len = 0;
   } else {
     firmware_info.name = Utils::readFile(sconfig.target_name_path.string());
-    content = Utils::readFile(sconfig.firmware_path.string());
+    firmware_info.hash = hash;
+    firmware_info.len = len;
   }
-  firmware_info.hash = Uptane::ManifestIssuer::generateVersionHashStr(content);
-  firmware_info.len = content.size();
 
   return true;
 }
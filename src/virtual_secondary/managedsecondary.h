@@ -16,6 +16,7 @@
 namespace Uptane {
 class DirectorRepository;
 class ImageRepository;
+class ImageFileInfoCache;
 }  // namespace Uptane
 
 class INvStorage;
@@ -91,6 +92,7 @@ class ManagedSecondary : public SecondaryInterface {
   int did_store_keys{0};  // For testing
   std::unique_ptr<Uptane::DirectorRepository> director_repo_;
   std::unique_ptr<Uptane::ImageRepository> image_repo_;
+  std::unique_ptr<Uptane::ImageFileInfoCache> firmware_info_cache_;
   PublicKey public_key_;
   std::string private_key;
   StorageConfig storage_config_;
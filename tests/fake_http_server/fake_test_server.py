@@ -87,15 +87,17 @@ class Handler(SimpleHTTPRequestHandler):
                 if auth_list[0] == 'Bearer' and auth_list[1] == 'token':
                     self.wfile.write(b'{"status": "good"}')
             self.wfile.write(b'{}')
-        elif self.path.endswith('/large_file'):
+        elif self.path.endswith('/large_file') or self.path.endswith('/large_file_no_range'):
             chunk_size = 1 << 20
             response_size = 100 * chunk_size
-            if "Range" in self.headers:
+            if "Range" in self.headers and not self.path.endswith('_no_range'):
                 r = self.headers["Range"]
-                r_from = int(r.split("=")[1].split("-")[0])
+                r_from, r_to = r.split("=")[1].split("-")
+                r_from = int(r_from)
+                r_to = int(r_to) if r_to else response_size - 1
                 self.send_response(206)
-                self.send_header('Content-Range', 'bytes %d-%d/%d' % (r_from, response_size-1, response_size))
-                response_size = response_size - r_from
+                self.send_header('Content-Range', 'bytes %d-%d/%d' % (r_from, r_to, response_size))
+                response_size = r_to + 1 - r_from
             else:
                 self.send_response(200)
             self.send_header('Content-Type', 'application/json')